@@ -16,6 +16,7 @@
 #define MOTION_BRIDGE__GAIT_INTERFACE_HPP_
 
 // C++ headers
+#include <array>
 #include <map>
 #include <memory>
 #include <set>
@@ -66,7 +67,8 @@ private:
 class GaitInterface
 {
 public:
-  GaitInterface() {}
+  GaitInterface()
+  : init_(false), gait_bridges_max_(0), gait_table_dim_(0) {}
   ~GaitInterface() {}
   /**
    * @brief Get bridges list before checking gait
@@ -79,6 +81,23 @@ public:
     const uint8_t & goal_gait,
     const uint8_t & current_gait,
     std::vector<GaitMono> & bridges_list);
+  /**
+   * @brief Get bridges path from transition table, without allocation
+   * @param goal_gait goal gait to check
+   * @param curent_gait current running gait
+   * @param path_length gaits count of path to return, 0 if not reachable
+   * @return gait ids ordered from goal gait to the first gait to check, nullptr if not reachable
+   */
+  const uint8_t * get_bridges_path(
+    const uint8_t & goal_gait,
+    const uint8_t & current_gait,
+    uint8_t & path_length) const;
+  /**
+   * @brief Get name of gait defined in gait map
+   * @param gait_id gait id to search
+   * @return gait name, empty if not defined
+   */
+  std::string get_gait_name(const uint8_t & gait_id) const;
   /**
    * @brief Initialize gait map
    * @param toml_path toml file path of gait_bridges_map
@@ -86,27 +105,32 @@ public:
    */
   bool init_gait_map(const std::string & toml_path);
 
+  // Upper bound of gait_bridges_max and gait id supported by transition table
+  static constexpr uint8_t GAIT_BRIDGES_CAP = 8;
+  static constexpr uint8_t GAIT_ID_CAP = 64;
+
 private:
   /**
-   * @brief Get bridges list before checking gait
-   * @param goal_gait goal gait to check
-   * @param curent_gait current running gait
-   * @param bridges_list list to return
-   * @return true if got bridges list
+   * @brief Bridges path of one goal & current gait pair
    */
-  bool get_bridge_list_internal(
-    const uint8_t & bridges_max,
-    const uint8_t & goal_gait,
-    const uint8_t & current_gait,
-    const std::map<uint8_t, GaitMono> & gait_map,
-    std::vector<GaitMono> & bridges_list);
+  struct GaitPath
+  {
+    uint8_t length{0};
+    std::array<uint8_t, GAIT_BRIDGES_CAP> gaits{};
+  };
   /**
-   * @brief Auto test of gait map coherency
-   * @return true if test pass
+   * @brief Compile gait map into transition table, and test coherency of all pairs
+   * @param bridges_max max bridges length of gait map
+   * @param gait_map gait map to compile
+   * @param table_dim dimension of table to return
+   * @param gait_table table to return, indexed by goal_gait * table_dim + current_gait
+   * @return true if every gait in map can be reached from each other
    */
-  bool gait_coherency_test(
+  bool compile_gait_table(
     const uint8_t & bridges_max,
-    const std::map<uint8_t, GaitMono> & gait_map);
+    const std::map<uint8_t, GaitMono> & gait_map,
+    uint8_t & table_dim,
+    std::vector<GaitPath> & gait_table);
 
   // vars
   const std::string GAIT_INTERFACE = "[Gait_Interface] ";
@@ -122,8 +146,10 @@ private:
   const std::string _str_bridge_gait = "bridge_gait";
   const std::string _str_neib_gait = "neib_gait";
 
-  uint32_t init_;
+  bool init_;
   uint8_t gait_bridges_max_;
+  uint8_t gait_table_dim_;
+  std::vector<GaitPath> gait_table_;
   std::map<uint8_t, GaitMono> trans_gait_map_;
   std::map<uint8_t, GaitMono> gait_map_;
 };
@@ -94,41 +94,47 @@ bool GaitInterface::get_bridges_list(
       GAIT_INTERFACE +
       std::string("Got bridges list failed. Gait interface is not initialized yet."));
   } else {
-    rtn_ = get_bridge_list_internal(
-      gait_bridges_max_,
-      goal_gait,
-      current_gait,
-      gait_map_,
-      bridges_list);
+    uint8_t path_length(0);
+    auto path = get_bridges_path(goal_gait, current_gait, path_length);
+    if (path != nullptr) {
+      bridges_list.clear();
+      for (uint8_t i = 0; i < path_length; i++) {
+        bridges_list.push_back(gait_map_.at(path[i]));
+      }
+      rtn_ = true;
+    }
   }
   return rtn_;
 }
 
-bool GaitInterface::get_bridge_list_internal(
-  const uint8_t & bridges_max,
+const uint8_t * GaitInterface::get_bridges_path(
   const uint8_t & goal_gait,
   const uint8_t & current_gait,
-  const std::map<uint8_t, GaitMono> & gait_map,
-  std::vector<GaitMono> & bridges_list)
+  uint8_t & path_length) const
 {
-  bool rtn_(false);
-  uint8_t goal_(goal_gait);
-  std::vector<GaitMono> gait_list;
-  if (gait_map.size() == 0 || gait_map.find(goal_) == gait_map.end()) {
-    return rtn_;
+  path_length = 0;
+  if (!init_ || goal_gait >= gait_table_dim_ || current_gait >= gait_table_dim_) {
+    return nullptr;
   }
-  if (bridges_max == 0) {
-    return rtn_;
+  const auto & gait_path = gait_table_[goal_gait * gait_table_dim_ + current_gait];
+  if (gait_path.length == 0) {
+    return nullptr;
   }
-  while (!gait_map.at(goal_).find_neibor_gaits(current_gait)) {
-    gait_list.push_back(gait_map.at(goal_));
-    gait_map.at(goal_).get_bridge_gait(goal_);
-    if (gait_list.size() >= bridges_max) {return rtn_;}
+  path_length = gait_path.length;
+  return gait_path.gaits.data();
+}
+
+std::string GaitInterface::get_gait_name(const uint8_t & gait_id) const
+{
+  auto gait_iter = gait_map_.find(gait_id);
+  if (gait_iter != gait_map_.end()) {
+    return gait_iter->second.get_gait_name();
   }
-  gait_list.push_back(gait_map.at(goal_));
-  bridges_list = gait_list;
-  rtn_ = true;
-  return rtn_;
+  gait_iter = trans_gait_map_.find(gait_id);
+  if (gait_iter != trans_gait_map_.end()) {
+    return gait_iter->second.get_gait_name();
+  }
+  return std::string();
 }
 
 bool GaitInterface::init_gait_map(const std::string & toml_path)
@@ -160,6 +166,14 @@ bool GaitInterface::init_gait_map(const std::string & toml_path)
       std::string("Gait bridges / trans gait table length is zero. Check TOML file, please."));
     return rtn_;
   }
+  if (gait_bridges_max > GAIT_BRIDGES_CAP) {
+    util::message_info(
+      GAIT_INTERFACE +
+      std::string("Gait bridges max is bigger than ") +
+      std::to_string(GAIT_BRIDGES_CAP) +
+      std::string(". Check TOML file, please."));
+    return rtn_;
+  }
   for (const auto & gait_tab : gait_define_tab) {
     gait_str_to_id.insert(
       std::pair<std::string, uint8_t>(
@@ -217,10 +231,14 @@ bool GaitInterface::init_gait_map(const std::string & toml_path)
       std::string("Some configuration is missed. Check gait toml, please."));
     return rtn_;
   }
-  if (gait_coherency_test(gait_bridges_max, gait_map)) {
+  uint8_t gait_table_dim(0);
+  std::vector<GaitPath> gait_table;
+  if (compile_gait_table(gait_bridges_max, gait_map, gait_table_dim, gait_table)) {
     gait_map_ = std::move(gait_map);
     trans_gait_map_ = std::move(trans_gait_map);
     gait_bridges_max_ = std::move(gait_bridges_max);
+    gait_table_ = std::move(gait_table);
+    gait_table_dim_ = gait_table_dim;
     init_ = true;
     rtn_ = true;
   } else {
@@ -231,42 +249,66 @@ bool GaitInterface::init_gait_map(const std::string & toml_path)
   return rtn_;
 }
 
-bool GaitInterface::gait_coherency_test(
+bool GaitInterface::compile_gait_table(
   const uint8_t & bridges_max,
-  const std::map<uint8_t, GaitMono> & gait_map)
+  const std::map<uint8_t, GaitMono> & gait_map,
+  uint8_t & table_dim,
+  std::vector<GaitPath> & gait_table)
 {
   bool rtn_(false);
-  std::vector<uint8_t> id_list;
-  if (gait_map.size() == 0) {return rtn_;}
-  std::for_each(
-    gait_map.begin(),
-    gait_map.end(),
-    [&](std::pair<uint8_t, GaitMono> const & gait_mono) {
-      id_list.push_back(gait_mono.first);
-    });
-  uint8_t count_(0);
-  while (id_list.size() > 0 && count_ == 0) {
+  if (gait_map.size() == 0 || bridges_max == 0) {return rtn_;}
+  if (gait_map.rbegin()->first >= GAIT_ID_CAP) {
+    util::message_info(
+      GAIT_INTERFACE +
+      std::string("Gait id ") +
+      std::to_string(gait_map.rbegin()->first) +
+      std::string(" is out of transition table range"));
+    return rtn_;
+  }
+  table_dim = gait_map.rbegin()->first + 1;
+  gait_table.assign(table_dim * table_dim, GaitPath());
+
+  // Follow bridge gaits from goal until current gait is a neighbour, once per pair
+  for (const auto & goal_gait : gait_map) {
+    for (uint8_t current_gait = 0; current_gait < table_dim; current_gait++) {
+      auto & gait_path = gait_table[goal_gait.first * table_dim + current_gait];
+      uint8_t goal_(goal_gait.first);
+      GaitPath path;
+      while (true) {
+        auto gait_iter = gait_map.find(goal_);
+        if (gait_iter == gait_map.end()) {
+          path.length = 0;
+          break;
+        }
+        path.gaits[path.length++] = goal_;
+        if (gait_iter->second.find_neibor_gaits(current_gait)) {
+          break;
+        }
+        if (path.length >= bridges_max) {
+          path.length = 0;
+          break;
+        }
+        gait_iter->second.get_bridge_gait(goal_);
+      }
+      gait_path = path;
+    }
+  }
+
+  // Coherency test, every defined gait should be reachable from each other
+  for (const auto & goal_gait : gait_map) {
     for (const auto & current_gait : gait_map) {
-      std::vector<GaitMono> gait_list;
-      if (!get_bridge_list_internal(
-          bridges_max, id_list.back(),
-          current_gait.first,
-          gait_map,
-          gait_list))
-      {
+      if (gait_table[goal_gait.first * table_dim + current_gait.first].length == 0) {
         util::message_info(
           GAIT_INTERFACE +
           std::string("Failed when checking from ") +
           current_gait.second.get_gait_name() +
           std::string(" to ") +
-          gait_map.at(id_list.back()).get_gait_name());
-        count_++;
-        break;
+          goal_gait.second.get_gait_name());
+        return rtn_;
       }
     }
-    id_list.pop_back();
   }
-  if (count_ == 0) {rtn_ = true;}
+  rtn_ = true;
   return rtn_;
 }
 
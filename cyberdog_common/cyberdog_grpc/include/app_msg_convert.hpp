@@ -0,0 +1,108 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef APP_MSG_CONVERT_HPP_
+#define APP_MSG_CONVERT_HPP_
+#include <google/protobuf/arena.h>
+#include "./cyberdog_app.pb.h"
+#include "ception_msgs/msg/bms.hpp"
+#include "ception_msgs/msg/around.hpp"
+#include "ception_msgs/msg/bt_remote_event.hpp"
+#include "motion_msgs/msg/se3_velocity_cmd.hpp"
+#include "motion_msgs/msg/control_state.hpp"
+#include "motion_msgs/msg/se3_pose.hpp"
+#include "motion_msgs/msg/scene.hpp"
+#include "std_msgs/msg/header.hpp"
+#include "std_msgs/msg/string.hpp"
+#include "automation_msgs/msg/tracking_status.hpp"
+#include "automation_msgs/msg/caution.hpp"
+#include "interaction_msgs/msg/body_info.hpp"
+#include "interaction_msgs/msg/voiceprint_result.hpp"
+#include "interaction_msgs/msg/face_result.hpp"
+#include "interaction_msgs/msg/compressed_image.hpp"
+#include "cyberdog_utils/image_ring.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+#include "nav_msgs/msg/path.hpp"
+
+// Covers small messages without any allocation
+#define CONVERT_ARENA_BLOCK (64 * 1024)
+#define JPEG_DEFAULT_QUALITY 75
+
+/**
+ * @brief Arena of the calling thread for messages sent to the app. The first
+ * block is kept per thread, so converting small messages does not touch the
+ * heap, larger ones get blocks which are freed when the lease ends.
+ * One lease per thread at a time.
+ */
+class ConvertArena
+{
+public:
+  ConvertArena();
+  ~ConvertArena();
+
+  template<typename MessageT>
+  MessageT * create()
+  {
+    return google::protobuf::Arena::CreateMessage<MessageT>(&arena_);
+  }
+
+private:
+  google::protobuf::Arena & arena_;
+};
+
+/**
+ * @brief Fill messages sent to the app in place, sub-messages are filled
+ * through their mutable accessors and arrays are reserved before adding.
+ */
+namespace app_msg
+{
+void fill(const std_msgs::msg::Header & in, cyberdogapp::Header * out);
+void fill(const nav_msgs::msg::MapMetaData & in, cyberdogapp::MapMetaData * out);
+void fill(const ception_msgs::msg::Bms & in, cyberdogapp::Bms * out);
+void fill(const motion_msgs::msg::ControlState & in, cyberdogapp::StatusStamped * out);
+void fill(const std_msgs::msg::String & in, cyberdogapp::WifiRssi * out);
+void fill(const automation_msgs::msg::TrackingStatus & in, cyberdogapp::TrackingStatus * out);
+void fill(const automation_msgs::msg::Caution & in, cyberdogapp::Caution * out);
+void fill(const interaction_msgs::msg::BodyInfo & in, cyberdogapp::BodyInfo * out);
+void fill(const nav_msgs::msg::OccupancyGrid & in, cyberdogapp::OccupancyGrid * out);
+void fill(const motion_msgs::msg::SE3VelocityCMD & in, cyberdogapp::DecisionStamped * out);
+void fill(const interaction_msgs::msg::VoiceprintResult & in, cyberdogapp::VoiceprintResult * out);
+void fill(
+  const interaction_msgs::msg::FaceResult & in, cyberdogapp::FaceResult * out,
+  bool bytes_images = false);
+/**
+ * @param bytes_image Whole image into the image field, else one data element per byte
+ */
+void fill(
+  const interaction_msgs::msg::CompressedImage & in, cyberdogapp::CompressedImage * out,
+  bool bytes_image);
+/**
+ * @brief Image of a shared memory ring as jpeg into the image field, raw
+ * frames are encoded, jpeg ones are copied once
+ * @return False if format is not supported or encoding failed
+ */
+bool fill(
+  const cyberdog_utils::ImageFrame & frame, const uint8_t * data, int quality,
+  cyberdogapp::CompressedImage * out);
+void fill(const nav_msgs::msg::Odometry & in, cyberdogapp::Odometry * out);
+void fill(const ception_msgs::msg::Around & in, cyberdogapp::Around * out);
+void fill(const motion_msgs::msg::SE3Pose & in, cyberdogapp::DogPose * out);
+void fill(const motion_msgs::msg::Scene & in, cyberdogapp::Scene * out);
+void fill(const ception_msgs::msg::BtRemoteEvent & in, cyberdogapp::RemoteEvent * out);
+void fill(const nav_msgs::msg::Path & in, cyberdogapp::Path * out);
+}  // namespace app_msg
+
+#endif  // APP_MSG_CONVERT_HPP_
@@ -0,0 +1,149 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef ASYNC_APP_CALLER_HPP_
+#define ASYNC_APP_CALLER_HPP_
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include "./cyberdog_app.grpc.pb.h"
+
+// Same as the blocking calls
+#define ASYNC_CALL_DEADLINE_SECONDS 2
+// Calls of a kept topic waiting for its window, oldest dropped beyond it
+#define ASYNC_QUEUED_CALLS_MAX 64
+
+/**
+ * @brief Unary calls to the app on one CompletionQueue, completed by one
+ * poller thread, so the calling thread never waits for the app. Each topic
+ * has at most window calls in flight, calls beyond it are dropped since a
+ * newer message follows anyway. Calls of kept topics, one-shot results no
+ * newer message replaces, wait for a free slot instead.
+ */
+class AsyncAppCaller
+{
+public:
+  using DoneCallback = std::function<void (const std::string & topic,
+      std::chrono::steady_clock::duration elapsed, bool ok)>;
+  using StatusCallback = std::function<void (const grpc::Status & status)>;
+
+  AsyncAppCaller(cyberdogapp::CyberdogApp::Stub * stub, uint32_t window);
+  ~AsyncAppCaller();
+
+  /**
+   * @brief Called by poller thread on each completion, set before first call
+   */
+  void setDoneCallback(DoneCallback callback) {done_callback_ = std::move(callback);}
+
+  /**
+   * @brief Queue calls of topic beyond its window instead of dropping them,
+   * set before first call
+   */
+  void keepTopic(const std::string & topic) {keep_topics_.insert(topic);}
+
+  /**
+   * @brief Start a call, any thread
+   * @param topic Name of topic, calls of a topic share its window
+   * @param prepare PrepareAsync method of the stub for the call
+   * @param request Request, serialized before returning
+   * @param status_callback Called by poller thread when the call completes,
+   * not called if the request is dropped
+   * @return False if window of topic is full and request is dropped, or
+   * queued and oldest queued request of topic is dropped
+   */
+  template<typename RequestT>
+  bool call(
+    const std::string & topic,
+    std::unique_ptr<grpc::ClientAsyncResponseReader<cyberdogapp::Result>>(
+      cyberdogapp::CyberdogApp::Stub::* prepare)(
+      grpc::ClientContext *, const RequestT &, grpc::CompletionQueue *),
+    const RequestT & request, StatusCallback status_callback = StatusCallback())
+  {
+    if (keep_topics_.count(topic) != 0) {
+      return queue_(
+        topic, [this, prepare, request, status_callback](Pending * pending) {
+          pending->status_callback = status_callback;
+          start_call_(pending, prepare, request);
+        });
+    }
+    auto pending = start_(topic);
+    if (pending == nullptr) {
+      return false;
+    }
+    pending->status_callback = std::move(status_callback);
+    start_call_(pending, prepare, request);
+    return true;
+  }
+
+  /**
+   * @brief Cancel calls in flight, they complete as CANCELLED, and drop queued ones
+   */
+  void cancel();
+
+  uint64_t dropped() const {return dropped_;}
+
+private:
+  struct Pending
+  {
+    grpc::ClientContext context;
+    cyberdogapp::Result result;
+    grpc::Status status;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<cyberdogapp::Result>> reader;
+    std::string topic;
+    std::chrono::steady_clock::time_point start;
+    StatusCallback status_callback;
+  };
+  using Starter = std::function<void (Pending * pending)>;
+
+  template<typename PrepareT, typename RequestT>
+  void start_call_(Pending * pending, PrepareT prepare, const RequestT & request)
+  {
+    pending->reader = (stub_->*prepare)(&pending->context, request, &cq_);
+    pending->reader->StartCall();
+    pending->reader->Finish(&pending->result, &pending->status, pending);
+  }
+  Pending * start_(const std::string & topic);
+  bool queue_(const std::string & topic, Starter starter);
+  // Called with mutex_ held
+  Pending * new_pending_(const std::string & topic);
+  void poll_thread();
+
+  cyberdogapp::CyberdogApp::Stub * stub_;
+  uint32_t window_;
+  grpc::CompletionQueue cq_;
+  DoneCallback done_callback_;
+  // Written before first call only
+  std::set<std::string> keep_topics_;
+
+  std::mutex mutex_;
+  bool shutdown_;
+  std::map<std::string, uint32_t> in_flight_;
+  std::set<Pending *> pending_;
+  std::map<std::string, std::deque<Starter>> queued_;
+  std::atomic<uint64_t> dropped_;
+
+  std::thread thread_;
+};
+
+#endif  // ASYNC_APP_CALLER_HPP_
@@ -16,6 +16,7 @@
 #define CYBERDOG_APP_HPP_
 #include <rclcpp_action/rclcpp_action.hpp>
 #include <chrono>
+#include <atomic>
 #include <cmath>
 #include <condition_variable>
 #include <fstream>
@@ -52,7 +53,7 @@
 #include "motion_msgs/action/change_mode.hpp"
 #include "motion_msgs/action/change_gait.hpp"
 
-#include "threadsafe_queue.hpp"
+#include "response_queue.hpp"
 #include "ception_msgs/msg/around.hpp"
 #include "msgdispatcher.hpp"
 #include "lcm_translate_msgs/control_parameter_request_lcmt.hpp"
@@ -65,6 +66,7 @@
 #include "net_avalible.hpp"
 #include "ception_msgs/srv/bt_remote_command.hpp"
 #include "nav_msgs/msg/path.hpp"
+#include "cyberdog_utils/image_ring.hpp"
 
 using ControlState_T = motion_msgs::msg::ControlState;
 using SE3VelocityCMD_T = motion_msgs::msg::SE3VelocityCMD;
@@ -73,23 +75,38 @@ using GoalHandleChangeMode = rclcpp_action::ClientGoalHandle<ChangeMode>;
 using ChangeGait = motion_msgs::action::ChangeGait;
 using GoalHandleChangeGait = rclcpp_action::ClientGoalHandle<ChangeGait>;
 using string = std::string;
+using MODE_QUEUE_T = ResponseQueue<std::shared_ptr<::cyberdogapp::CheckoutMode_respond>>;
+using PATTERN_QUEUE_T = ResponseQueue<std::shared_ptr<::cyberdogapp::CheckoutPattern_respond>>;
+using EXTMONORDER_QUEUE_T = ResponseQueue<std::shared_ptr<::cyberdogapp::ExtMonOrder_Respond>>;
+using OFFSET_DATA_QUEUE_T = ResponseQueue<std::shared_ptr<::cyberdogapp::OffsetCalibationData>>;
+using OFFSET_RESULT_QUEUE_T = ResponseQueue<std::shared_ptr<::cyberdogapp::OffsetRequest_result>>;
 namespace cyberdog_cyberdog_app
 {
 class Cyberdog_app : public rclcpp::Node
 {
 public:
-  Cyberdog_app();
+  explicit Cyberdog_app(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+  // Reachability, round trip and loss of the app link
+  NetStats getLinkStats() {return net_checker.stats();}
   void publishMotion(const SE3VelocityCMD_T & decissage_out);
   void publishPattern(
+    ::grpc::ServerContext * context,
     const ::cyberdogapp::CheckoutPattern_request * request,
     ::grpc::ServerWriter<::cyberdogapp::CheckoutPattern_respond> * writer);
   void publishStatus(const ControlState_T & status_out);
   void publishMode(
+    ::grpc::ServerContext * context,
     const ::cyberdogapp::CheckoutMode_request * request,
     ::grpc::ServerWriter<::cyberdogapp::CheckoutMode_respond> * writer);
   void callCameraService(
     int command, std::string args,
     ::cyberdogapp::CameraService_respond * respond);
+  // Latest camera frame as jpeg, args of GET_IMAGE is the quality
+  void getCameraImage(
+    const std::string & args,
+    ::cyberdogapp::CameraService_respond * respond);
+  // Close camera ring when GET_IMAGE has not been called for a while
+  void releaseIdleCameraRing();
   void setFollowRegion(
     const ::cyberdogapp::BodyRegion_Request * request,
     ::cyberdogapp::BodyRegion_Respond * respond);
@@ -107,14 +124,17 @@ public:
     ::cyberdogapp::Voiceprint_Response * respond);
 
   void getOffsetData(
+    ::grpc::ServerContext * context,
     const ::cyberdogapp::OffsetRequest * request,
     ::grpc::ServerWriter< ::cyberdogapp::OffsetCalibationData> * writer);
 
   void setOffsetData(
+    ::grpc::ServerContext * context,
     const ::cyberdogapp::OffsetCalibationData * request,
     ::grpc::ServerWriter< ::cyberdogapp::OffsetRequest_result> * writer);
 
   void setExtmonOrder(
+    ::grpc::ServerContext * context,
     const ::cyberdogapp::ExtMonOrder_Request * request,
     ::grpc::ServerWriter< ::cyberdogapp::ExtMonOrder_Respond> * writer);
 
@@ -197,12 +217,9 @@ private:
   void destroyGrpcServer();
   std::string getDogIp(const string str, const string & split);
   std::string getPhoneIp(const string str, const string & split);
-  std::shared_ptr<threadsafe_queue<std::shared_ptr<::cyberdogapp::CheckoutMode_respond>>>
-  modeRespond_queue;
-  std::shared_ptr<threadsafe_queue<std::shared_ptr<::cyberdogapp::CheckoutPattern_respond>>>
-  patternRespond_queue;
-  std::shared_ptr<threadsafe_queue<std::shared_ptr<::cyberdogapp::ExtMonOrder_Respond>>>
-  extMonOrderRespond_queue;
+  std::shared_ptr<MODE_QUEUE_T> modeRespond_queue;
+  std::shared_ptr<PATTERN_QUEUE_T> patternRespond_queue;
+  std::shared_ptr<EXTMONORDER_QUEUE_T> extMonOrderRespond_queue;
   std::shared_ptr<Cyberdog_App_Client> app_stub;
   std::shared_ptr<std::string> server_ip;
   std::shared_ptr<grpc::Server> server_;
@@ -217,13 +234,23 @@ private:
   std::string getLcmUrl(int ttl);
   bool wait_for_offset_data;
   bool wait_for_set_data_result;
-  std::shared_ptr<threadsafe_queue<std::shared_ptr<::cyberdogapp::OffsetCalibationData>>>
-  offsetCalibationData_queue;
-  std::shared_ptr<threadsafe_queue<std::shared_ptr<::cyberdogapp::OffsetRequest_result>>>
-  offsetRequestResult_queue;
+  std::shared_ptr<OFFSET_DATA_QUEUE_T> offsetCalibationData_queue;
+  std::shared_ptr<OFFSET_RESULT_QUEUE_T> offsetRequestResult_queue;
   void recv_lcm_handle();
   std::shared_ptr<std::thread> lcm_handle_thread_;
   NetChecker net_checker;
+  int async_window;
+  // Port of the app, and of the server here for requests of the app
+  int app_port;
+  int server_port;
+  // Camera frames from "ros" service or "shm" ring of the camera
+  std::string image_transport;
+  // Camera ring is opened by GET_IMAGE and closed again when idle
+  std::mutex camera_ring_mutex;
+  std::unique_ptr<cyberdog_utils::ImageRing> camera_ring;
+  std::chrono::steady_clock::time_point camera_ring_used;
+  // App asked for face images in one bytes field
+  std::atomic_bool bytes_images;
   uint32_t heartbeat_err_cnt;
   bool app_disconnected;
   std::string local_ip;
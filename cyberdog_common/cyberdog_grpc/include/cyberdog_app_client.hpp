@@ -21,9 +21,13 @@
 #include <grpcpp/client_context.h>
 #include <grpcpp/create_channel.h>
 #include <grpcpp/security/credentials.h>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <string>
 #include <thread>
@@ -43,6 +47,11 @@
 #include "nav_msgs/msg/odometry.hpp"
 #include "nav_msgs/msg/path.hpp"
 #include "msgdispatcher.hpp"
+#include "telemetry_stream.hpp"
+#include "map_tiles.hpp"
+#include "link_rate_control.hpp"
+#include "async_app_caller.hpp"
+#include "app_msg_convert.hpp"
 #include "motion_msgs/msg/se3_pose.hpp"
 #include "motion_msgs/msg/scene.hpp"
 
@@ -65,7 +74,10 @@ using Parameters_T = motion_msgs::msg::Parameters;
 class Cyberdog_App_Client
 {
 public:
-  explicit Cyberdog_App_Client(std::shared_ptr<Channel> channel);
+  /**
+   * @param async_window Calls in flight per topic, 0 for blocking calls
+   */
+  explicit Cyberdog_App_Client(std::shared_ptr<Channel> channel, uint32_t async_window = 0);
   ~Cyberdog_App_Client();
   bool SetBms(const ception_msgs::msg::Bms::SharedPtr bms);
   bool SetStatus(const ControlState_T::SharedPtr status);
@@ -78,6 +90,8 @@ public:
   bool subscribePosition(const SE3VelocityCMD_T::SharedPtr msg);
   bool subscribeVoiceprintResult(const interaction_msgs::msg::VoiceprintResult::SharedPtr msg);
   bool subscribeFaceResult(const interaction_msgs::msg::FaceResult::SharedPtr msg);
+  // Face images in one bytes field instead of one data element per byte
+  void setBytesImages(bool bytes_images) {bytes_images_ = bytes_images;}
   bool SetHeartBeat(std::string ip);
   bool subscribeOdomOut(const nav_msgs::msg::Odometry::SharedPtr msg);
   bool subscribeObstacleDetection(const ception_msgs::msg::Around::SharedPtr msg);
@@ -85,55 +99,152 @@ public:
   bool subscribeGpsScene(const motion_msgs::msg::Scene::SharedPtr msg);
   bool subscribeRemoteEvent(const ception_msgs::msg::BtRemoteEvent::SharedPtr msg);
   bool subscribePath(const nav_msgs::msg::Path::SharedPtr msg);
+  // Adapt topic rates to the link, call it periodically
+  void updateLinkRate(const NetStats & link, bool heartbeat_ok);
+  LinkRateStats getLinkRateStats() {return rate_control_.stats();}
 
 private:
-  void set_bms_(const std::shared_ptr<ception_msgs::msg::Bms::SharedPtr> msg);
-  void SetStatus_(const std::shared_ptr<ControlState_T::SharedPtr> msg);
-  void set_rssi_(const std::shared_ptr<std_msgs::msg::String::SharedPtr> msg);
+  void set_bms_(const ception_msgs::msg::Bms::SharedPtr msg);
+  void SetStatus_(const ControlState_T::SharedPtr msg);
+  void set_rssi_(const std_msgs::msg::String::SharedPtr msg);
   void subscribeTrackingStatus_(
-    const std::shared_ptr<automation_msgs::msg::TrackingStatus::SharedPtr> msg);
-  void subscribeNavStatus_(const std::shared_ptr<automation_msgs::msg::Caution::SharedPtr> status);
-  void set_BodySelect_(const std::shared_ptr<interaction_msgs::msg::BodyInfo::SharedPtr> msg);
-  void set_Tracking_(const std::shared_ptr<interaction_msgs::msg::BodyInfo::SharedPtr> msg);
-  void subscribeMap_(const std::shared_ptr<nav_msgs::msg::OccupancyGrid::SharedPtr> occupancy_grid);
-  void subscribePosition_(const std::shared_ptr<SE3VelocityCMD_T::SharedPtr> msg);
+    const automation_msgs::msg::TrackingStatus::SharedPtr msg);
+  void subscribeNavStatus_(const automation_msgs::msg::Caution::SharedPtr status);
+  void set_BodySelect_(const interaction_msgs::msg::BodyInfo::SharedPtr msg);
+  void set_Tracking_(const interaction_msgs::msg::BodyInfo::SharedPtr msg);
+  void subscribeMap_(const nav_msgs::msg::OccupancyGrid::SharedPtr occupancy_grid);
+  bool subscribeMapTiles_(const nav_msgs::msg::OccupancyGrid::SharedPtr & msg);
+  void mapTilesDone_(const nav_msgs::msg::OccupancyGrid::SharedPtr & msg, const Status & status);
+  void subscribePosition_(const SE3VelocityCMD_T::SharedPtr msg);
   void subscribeVoiceprintResult_(
-    const std::shared_ptr<interaction_msgs::msg::VoiceprintResult::SharedPtr> msg);
+    const interaction_msgs::msg::VoiceprintResult::SharedPtr msg);
   void subscribeFaceResult_(
-    const std::shared_ptr<interaction_msgs::msg::FaceResult::SharedPtr> msg);
-  void subscribeOdomOut_(const std::shared_ptr<nav_msgs::msg::Odometry::SharedPtr> msg);
-  void subscribeObstacleDetection_(const std::shared_ptr<ception_msgs::msg::Around::SharedPtr> msg);
-  void subscribeDogPose_(const std::shared_ptr<motion_msgs::msg::SE3Pose::SharedPtr> msg);
-  void subscribeGpsScene_(const std::shared_ptr<motion_msgs::msg::Scene::SharedPtr> msg);
+    const interaction_msgs::msg::FaceResult::SharedPtr msg);
+  void subscribeOdomOut_(const nav_msgs::msg::Odometry::SharedPtr msg);
+  void subscribeObstacleDetection_(const ception_msgs::msg::Around::SharedPtr msg);
+  void subscribeDogPose_(const motion_msgs::msg::SE3Pose::SharedPtr msg);
+  void subscribeGpsScene_(const motion_msgs::msg::Scene::SharedPtr msg);
   void subscribeRemoteEvent_(
-    const std::shared_ptr<ception_msgs::msg::BtRemoteEvent::SharedPtr> msg);
-  void subscribePath_(const std::shared_ptr<nav_msgs::msg::Path::SharedPtr> msg);
-  void generate_grpc_Header(
-    cyberdogapp::Header & grpc_header,
-    const std_msgs::msg::Header & std_header);
+    const ception_msgs::msg::BtRemoteEvent::SharedPtr msg);
+  void subscribePath_(const nav_msgs::msg::Path::SharedPtr msg);
+  template<typename DispatcherT>
+  void addRateControl_(DispatcherT & dispatcher, const std::string & name, TopicPriority priority)
+  {
+    auto topic = rate_control_.add_topic(
+      name, priority, [&dispatcher](double rate_hz) {dispatcher.setRateLimit(rate_hz);});
+    rate_topics_[name] = topic;
+    if (async_caller_ != nullptr) {
+      // Dispatcher returns before the call is done, caller reports instead
+      return;
+    }
+    dispatcher.setSentCallback(
+      [this, topic](std::chrono::steady_clock::duration elapsed) {
+        rate_control_.on_sent(topic, elapsed);
+      });
+  }
+  bool write_telemetry(const TelemetryClass telemetry_class, const cyberdogapp::Telemetry & msg);
+  // Send by unary call a message written to a stream the app does not implement
+  void resend_(const cyberdogapp::Telemetry & telemetry);
+  /**
+   * @brief Send to the app through telemetry stream, async call or blocking call
+   */
+  template<typename RequestT>
+  void send_(
+    const TelemetryClass telemetry_class, const cyberdogapp::Telemetry & telemetry,
+    const std::string & topic,
+    Status (cyberdogapp::CyberdogApp::Stub::* call)(ClientContext *, const RequestT &, Result *),
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Result>>(
+      cyberdogapp::CyberdogApp::Stub::* prepare)(
+      ClientContext *, const RequestT &, grpc::CompletionQueue *),
+    const RequestT & request)
+  {
+    if (write_telemetry(telemetry_class, telemetry)) {
+      return;
+    }
+    unary_(topic, call, prepare, request);
+  }
+  /**
+   * @brief Send to the app by async call or blocking call
+   */
+  template<typename RequestT>
+  void unary_(
+    const std::string & topic,
+    Status (cyberdogapp::CyberdogApp::Stub::* call)(ClientContext *, const RequestT &, Result *),
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Result>>(
+      cyberdogapp::CyberdogApp::Stub::* prepare)(
+      ClientContext *, const RequestT &, grpc::CompletionQueue *),
+    const RequestT & request)
+  {
+    if (async_caller_ != nullptr) {
+      async_caller_->call(topic, prepare, request);
+      return;
+    }
+    ClientContext context;
+    gpr_timespec timespec;
+    timespec.tv_sec = 2;
+    timespec.tv_nsec = 0;
+    timespec.clock_type = GPR_TIMESPAN;
+    context.set_deadline(timespec);
+    Result result;
+    (stub_.get()->*call)(&context, request, &result);
+  }
 
 private:
   std::unique_ptr<cyberdogapp::CyberdogApp::Stub> stub_;
   std::shared_ptr<grpc::Channel> channel_;
-  LatestMsgDispather<std_msgs::msg::String::SharedPtr> rssi_dispatcher;
-  LatestMsgDispather<ception_msgs::msg::Bms::SharedPtr> bms_dispatcher;
-  LatestMsgDispather<ControlState_T::SharedPtr> status_dispatcher;
-  LatestMsgDispather<automation_msgs::msg::TrackingStatus::SharedPtr> TrackingStatus_dispatcher;
-  LatestMsgDispather<automation_msgs::msg::Caution::SharedPtr> NavStatus_dispatcher;
-  LatestMsgDispather<interaction_msgs::msg::BodyInfo::SharedPtr> bodySelect_dispatcher;
-  LatestMsgDispather<interaction_msgs::msg::BodyInfo::SharedPtr> Tracking_dispatcher;
-  LatestMsgDispather<nav_msgs::msg::OccupancyGrid::SharedPtr> map_dispatcher;
+  // Declared before dispatchers, so streams outlive dispatcher threads
+  std::array<std::unique_ptr<TelemetryStream>, TELEMETRY_CLASS_COUNT> streams_;
+  // Used by map dispatcher only
+  MapTileEncoder map_encoder_;
+  // Set when a tiles call failed, encoder is reset before the next map
+  std::atomic_bool map_tiles_reset_;
+  std::atomic_bool map_tiles_supported_;
+  // Async tiles call in flight, and the map taken meanwhile. It is pushed
+  // again when the call is done, unless a newer map was pushed since.
+  std::mutex map_mutex_;
+  bool map_tiles_busy_;
+  bool closing_;
+  nav_msgs::msg::OccupancyGrid::SharedPtr map_waiting_;
+  const nav_msgs::msg::OccupancyGrid * map_pushed_;
+  LinkRateControl rate_control_;
+  // Written in constructor only
+  std::map<std::string, size_t> rate_topics_;
+  std::unique_ptr<AsyncAppCaller> async_caller_;
+  std::atomic_bool bytes_images_;
+  // Workers of all dispatchers below, declared before them so they outlive them.
+  // Status and odometry have a worker each, a send blocked on another topic
+  // never holds them back.
+  DispatcherPool dispatcher_pool_;
+  DispatcherPool state_pool_{2};
+  LatestMsgDispather<std_msgs::msg::String::SharedPtr> rssi_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<ception_msgs::msg::Bms::SharedPtr> bms_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<ControlState_T::SharedPtr> status_dispatcher{state_pool_};
+  LatestMsgDispather<automation_msgs::msg::TrackingStatus::SharedPtr>
+  TrackingStatus_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<automation_msgs::msg::Caution::SharedPtr>
+  NavStatus_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<interaction_msgs::msg::BodyInfo::SharedPtr>
+  bodySelect_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<interaction_msgs::msg::BodyInfo::SharedPtr>
+  Tracking_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<nav_msgs::msg::OccupancyGrid::SharedPtr> map_dispatcher{dispatcher_pool_};
 
-  LatestMsgDispather<SE3VelocityCMD_T::SharedPtr> subscribePosition_dispatcher;
+  LatestMsgDispather<SE3VelocityCMD_T::SharedPtr> subscribePosition_dispatcher{dispatcher_pool_};
   LatestMsgDispather<interaction_msgs::msg::VoiceprintResult::SharedPtr>
-  subscribeVoiceprintResult_dispatcher;
-  LatestMsgDispather<interaction_msgs::msg::FaceResult::SharedPtr> subscribeFaceResult_dispatcher;
-  LatestMsgDispather<nav_msgs::msg::Odometry::SharedPtr> subscribeOdomOut_dispatcher;
-  LatestMsgDispather<ception_msgs::msg::Around::SharedPtr> subscribeObstacleDetection_dispatcher;
-  LatestMsgDispather<motion_msgs::msg::SE3Pose::SharedPtr> subscribeDogPose_dispatcher;
-  LatestMsgDispather<motion_msgs::msg::Scene::SharedPtr> subscribeGpsScene_dispatcher;
-  LatestMsgDispather<ception_msgs::msg::BtRemoteEvent::SharedPtr> remoteEvent_dispatcher;
-  LatestMsgDispather<nav_msgs::msg::Path::SharedPtr> path_dispatcher;
+  subscribeVoiceprintResult_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<interaction_msgs::msg::FaceResult::SharedPtr>
+  subscribeFaceResult_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<nav_msgs::msg::Odometry::SharedPtr>
+  subscribeOdomOut_dispatcher{state_pool_};
+  LatestMsgDispather<ception_msgs::msg::Around::SharedPtr>
+  subscribeObstacleDetection_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<motion_msgs::msg::SE3Pose::SharedPtr>
+  subscribeDogPose_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<motion_msgs::msg::Scene::SharedPtr>
+  subscribeGpsScene_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<ception_msgs::msg::BtRemoteEvent::SharedPtr>
+  remoteEvent_dispatcher{dispatcher_pool_};
+  LatestMsgDispather<nav_msgs::msg::Path::SharedPtr> path_dispatcher{dispatcher_pool_};
 };
 
 #endif  // CYBERDOG_APP_CLIENT_HPP_
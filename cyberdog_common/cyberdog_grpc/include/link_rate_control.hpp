@@ -0,0 +1,109 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef LINK_RATE_CONTROL_HPP_
+#define LINK_RATE_CONTROL_HPP_
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "net_avalible.hpp"
+
+/**
+ * @brief Priority of a topic sent to the app. Critical topics are never
+ * limited, normal ones are limited only after bulk ones are at their floor.
+ */
+enum TopicPriority
+{
+  PRIORITY_CRITICAL = 0,
+  PRIORITY_NORMAL = 1,
+  PRIORITY_BULK = 2,
+  PRIORITY_COUNT = 3
+};
+
+struct LinkRateStats
+{
+  bool congested = false;
+  // Minimal period between two messages of a topic, 0 for no limit
+  double period_s[PRIORITY_COUNT] = {0, 0, 0};
+  // Of the last update interval
+  double delivered_hz[PRIORITY_COUNT] = {0, 0, 0};
+  double latency_ms[PRIORITY_COUNT] = {0, 0, 0};
+};
+
+/**
+ * @brief Decimates normal and bulk topics when the app link can not keep up.
+ * Senders report how long each message took, update() compares that and the
+ * link statistics with the link round trip, backs off multiplicatively while
+ * congested and recovers slower when healthy. Limits are applied through the
+ * rate setter of each topic.
+ */
+class LinkRateControl
+{
+public:
+  using RateSetter = std::function<void (double rate_hz)>;
+
+  LinkRateControl();
+
+  /**
+   * @brief Register a topic, before any update
+   * @return Topic id for on_sent
+   */
+  size_t add_topic(const std::string & name, TopicPriority priority, RateSetter setter);
+
+  /**
+   * @brief Report one message handed to the app, any thread
+   * @param elapsed Time the send call took
+   */
+  void on_sent(size_t topic, std::chrono::steady_clock::duration elapsed);
+
+  /**
+   * @brief Recompute limits, call it periodically from one thread
+   * @param link Statistics of the link
+   * @param heartbeat_ok False if last heartbeat to the app failed
+   */
+  void update(const NetStats & link, bool heartbeat_ok);
+
+  LinkRateStats stats();
+
+private:
+  struct Topic
+  {
+    std::string name;
+    TopicPriority priority;
+    RateSetter setter;
+  };
+  struct Window
+  {
+    uint64_t count = 0;
+    uint64_t slow = 0;
+    double latency_ms_sum = 0;
+  };
+
+  void apply_(TopicPriority priority, double period_s);
+
+  std::vector<Topic> topics_;
+  std::chrono::steady_clock::time_point last_update_;
+
+  std::mutex window_mutex_;
+  Window window_[PRIORITY_COUNT];
+
+  std::mutex stats_mutex_;
+  LinkRateStats stats_;
+};
+
+#endif  // LINK_RATE_CONTROL_HPP_
@@ -0,0 +1,62 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef MAP_TILES_HPP_
+#define MAP_TILES_HPP_
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "./cyberdog_app.pb.h"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+#define MAP_TILE_SIZE 64
+
+/**
+ * @brief Cuts OccupancyGrid into run-length encoded tiles and remembers the
+ * hash of every tile sent, so the next map only carries changed tiles.
+ * Not thread safe, one encoder per map topic.
+ */
+class MapTileEncoder
+{
+public:
+  explicit MapTileEncoder(uint32_t tile_size = MAP_TILE_SIZE);
+
+  /**
+   * @brief Add changed tiles of grid, header and info are not touched
+   * @param grid Map to send
+   * @param tiles Message to fill, full is set if all tiles are added
+   * @return False if grid data does not match its size
+   */
+  bool encode(const nav_msgs::msg::OccupancyGrid & grid, cyberdogapp::MapTiles & tiles);
+
+  /**
+   * @brief Forget tiles sent, next encode is full. Call it when the app may
+   * have missed a message.
+   */
+  void reset();
+
+  static void rle_encode(const int8_t * cells, size_t count, std::string & out);
+  static bool rle_decode(const std::string & in, std::vector<int8_t> & cells);
+
+private:
+  bool same_geometry_(const nav_msgs::msg::MapMetaData & info) const;
+
+  uint32_t tile_size_;
+  bool sent_;
+  nav_msgs::msg::MapMetaData info_;
+  std::vector<uint64_t> hashes_;
+};
+
+#endif  // MAP_TILES_HPP_
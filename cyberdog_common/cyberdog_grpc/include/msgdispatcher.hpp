@@ -15,82 +15,251 @@
 
 #ifndef MSGDISPATCHER_HPP_
 #define MSGDISPATCHER_HPP_
-#include <queue>
-#include <mutex>
-#include <memory>
-#include <condition_variable>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <utility>
-template<typename MessageT>
-class LatestMsgDispather
+#include <vector>
+
+#define DISPATCHER_POOL_THREADS 4
+
+class DispatcherPool;
+
+/**
+ * @brief Topic serviced by DispatcherPool, one worker at a time
+ */
+class DispatchSlot
 {
-  using SharedPtrCallback = std::function<void (std::shared_ptr<MessageT>)>;
+public:
+  virtual ~DispatchSlot() {}
+
+protected:
+  friend class DispatcherPool;
+  enum State {IDLE = 0, QUEUED = 1, RUNNING = 2};
+
+  // Take latest value and call back, false if there is none
+  virtual bool process() = 0;
+  virtual bool pending() const = 0;
+
+  std::chrono::steady_clock::duration min_period() const
+  {
+    return std::chrono::steady_clock::duration(min_period_.load());
+  }
+
+  std::atomic_int state_{IDLE};
+  // Set under pool lock once removing starts, a removed slot is never queued
+  bool removed_{false};
+  // Changed by rate control while workers run
+  std::atomic<std::chrono::steady_clock::duration::rep> min_period_{0};
+  std::chrono::steady_clock::time_point last_run_;
+};
 
+/**
+ * @brief Small set of workers shared by topics sent to the app.
+ * A topic is queued when it gets a new value and is never run by two
+ * workers at once, so its callbacks keep their order. A callback blocks its
+ * worker while it sends, topics which must not wait behind others get a pool
+ * with a worker for each of them.
+ */
+class DispatcherPool
+{
 public:
-  LatestMsgDispather()
-  : callback_(nullptr), need_run_(true)
+  explicit DispatcherPool(size_t threads = DISPATCHER_POOL_THREADS)
+  : need_run_(true)
   {
+    for (size_t i = 0; i < std::max<size_t>(1, threads); i++) {
+      threads_.emplace_back(&DispatcherPool::process_thread, this);
+    }
   }
-  ~LatestMsgDispather()
+  ~DispatcherPool()
   {
-    need_run_ = false;
+    {
+      std::lock_guard<std::mutex> lk(mut);
+      need_run_ = false;
+    }
     cond.notify_all();
-    thread_->join();
+    for (auto & thread : threads_) {
+      thread.join();
+    }
   }
-  void push(MessageT msg)
+
+  /**
+   * @brief Queue slot if it is idle, any thread
+   */
+  void schedule(DispatchSlot * slot)
   {
-    std::lock_guard<std::mutex> lk(mut);
-    if (!need_run_) {
+    int idle = DispatchSlot::IDLE;
+    if (!slot->state_.compare_exchange_strong(idle, DispatchSlot::QUEUED)) {
+      // Queued already, or the running worker sees the new value when done
       return;
     }
-    while (!queue_.empty()) {
-      queue_.pop();
+    {
+      std::lock_guard<std::mutex> lk(mut);
+      // Push racing with destruction, slot stays QUEUED and is never run
+      if (slot->removed_) {
+        return;
+      }
+      ready_.emplace(slot->last_run_ + slot->min_period(), slot);
     }
-    queue_.push(std::move(msg));
-    cond.notify_all();
+    cond.notify_one();
   }
-  std::shared_ptr<MessageT> get()
+
+  /**
+   * @brief Drop slot from queue and wait until no worker runs it
+   */
+  void remove(DispatchSlot * slot)
   {
     std::unique_lock<std::mutex> ulk(mut);
-    cond.wait(
-      ulk, [this]
-      {return !need_run_ || !this->queue_.empty();});
-    if (!need_run_) {
-      return NULL;
+    slot->removed_ = true;
+    // Queued before removing started, erase after the running worker is done
+    done_cond.wait(ulk, [this, slot] {return running_.count(slot) == 0;});
+    for (auto it = ready_.begin(); it != ready_.end(); ) {
+      it = it->second == slot ? ready_.erase(it) : std::next(it);
+    }
+  }
+
+private:
+  void process_thread()
+  {
+    std::unique_lock<std::mutex> ulk(mut);
+    while (need_run_) {
+      if (ready_.empty()) {
+        cond.wait(ulk);
+        continue;
+      }
+      auto first = ready_.begin();
+      if (first->first > std::chrono::steady_clock::now()) {
+        // Rate limited, wait for it or for an earlier one
+        cond.wait_until(ulk, first->first);
+        continue;
+      }
+      auto slot = first->second;
+      ready_.erase(first);
+      running_.insert(slot);
+      slot->state_ = DispatchSlot::RUNNING;
+      ulk.unlock();
+
+      auto processed = slot->process();
+
+      ulk.lock();
+      if (processed) {
+        slot->last_run_ = std::chrono::steady_clock::now();
+      }
+      running_.erase(slot);
+      slot->state_ = DispatchSlot::IDLE;
+      // Value pushed while running, its push did not queue the slot
+      int idle = DispatchSlot::IDLE;
+      if (!slot->removed_ && slot->pending() && slot->state_.compare_exchange_strong(idle, DispatchSlot::QUEUED)) {
+        ready_.emplace(slot->last_run_ + slot->min_period(), slot);
+      }
+      done_cond.notify_all();
+    }
+  }
+
+  bool need_run_;
+  std::multimap<std::chrono::steady_clock::time_point, DispatchSlot *> ready_;
+  std::set<DispatchSlot *> running_;
+  std::mutex mut;
+  std::condition_variable cond;
+  std::condition_variable done_cond;
+  std::vector<std::thread> threads_;
+};
+
+/**
+ * @brief Latest value of one topic sent by a DispatcherPool worker.
+ * MessageT is the shared pointer of the message as it comes from the
+ * subscription. Push swaps it into the slot, nothing is allocated or copied,
+ * older values not taken yet are dropped.
+ */
+template<typename MessageT>
+class LatestMsgDispather : public DispatchSlot
+{
+  using SharedPtrCallback = std::function<void (MessageT)>;
+  using SentCallback = std::function<void (std::chrono::steady_clock::duration)>;
+
+public:
+  explicit LatestMsgDispather(DispatcherPool & pool)
+  : pool_(pool), callback_(nullptr)
+  {
+  }
+  ~LatestMsgDispather()
+  {
+    pool_.remove(this);
+  }
+  void push(MessageT msg)
+  {
+    {
+      std::lock_guard<std::mutex> lk(latest_mutex_);
+      latest_.swap(msg);
+    }
+    // Value replaced is released out of the lock
+    msg.reset();
+    if (callback_ != nullptr) {
+      pool_.schedule(this);
     }
-    std::shared_ptr<MessageT> val(std::make_shared<MessageT>(std::move(queue_.front())));
-    queue_.pop();
-    return val;
   }
   template<typename CallbackT>
   void setCallback(CallbackT && callback)
   {
     callback_ = std::forward<CallbackT>(callback);
-    run();
   }
 
-  void run()
+  /**
+   * @brief Call back at most rate_hz times per second, newer values replace
+   * the waiting one. Zero for no limit.
+   */
+  void setRateLimit(double rate_hz)
   {
-    thread_ = std::make_shared<std::thread>(&LatestMsgDispather::process_thread, this);
+    min_period_ = rate_hz > 0 ?
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / rate_hz)).count() : 0;
   }
-  void process_thread()
+
+  /**
+   * @brief Called after each callback with the time it took, set before pushing
+   */
+  template<typename CallbackT>
+  void setSentCallback(CallbackT && callback)
   {
-    while (need_run_) {
-      if (callback_ != nullptr) {
-        auto msg = get();
-        if (msg != NULL) {
-          callback_(msg);
-        }
-      }
-    }
+    sent_callback_ = std::forward<CallbackT>(callback);
   }
 
 private:
-  bool need_run_;
-  std::queue<MessageT> queue_;
-  std::mutex mut;
-  std::condition_variable cond;
+  bool process() override
+  {
+    MessageT msg;
+    {
+      std::lock_guard<std::mutex> lk(latest_mutex_);
+      msg.swap(latest_);
+    }
+    if (msg == nullptr) {
+      return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    callback_(std::move(msg));
+    if (sent_callback_ != nullptr) {
+      sent_callback_(std::chrono::steady_clock::now() - start);
+    }
+    return true;
+  }
+  bool pending() const override
+  {
+    std::lock_guard<std::mutex> lk(latest_mutex_);
+    return latest_ != nullptr;
+  }
+
+  DispatcherPool & pool_;
   SharedPtrCallback callback_;
-  std::shared_ptr<std::thread> thread_;
+  SentCallback sent_callback_;
+  // Held only to swap the pointer, never while calling back
+  mutable std::mutex latest_mutex_;
+  MessageT latest_;
 };
 #endif  // MSGDISPATCHER_HPP_
@@ -14,72 +14,86 @@
 
 #ifndef NET_AVALIBLE_HPP_
 #define NET_AVALIBLE_HPP_
-#include <stdio.h>
-#include <unistd.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
-#include <iostream>
 #include <thread>
 
+/**
+ * @brief Link statistics of the app, from the probes of last few seconds
+ */
+struct NetStats
+{
+  bool reachable = false;
+  // Last and smoothed round trip, valid once received is not zero
+  double rtt_ms = 0;
+  double rtt_avg_ms = 0;
+  // Lost fraction of the probes in the window
+  double loss = 0;
+  uint64_t sent = 0;
+  uint64_t received = 0;
+};
+
+/**
+ * @brief Probes the app once a second from one thread, without forking.
+ * ICMP echo on a datagram socket is used if the kernel allows it, a raw
+ * socket if running as root, otherwise a TCP connect to the app port where
+ * a refused connection counts as reachable. Probes not answered by the next
+ * one are lost.
+ */
 class NetChecker
 {
 public:
-  NetChecker()
-  : need_run_(true), thread_(NULL), need_ping(true)
-  {}
-  ~NetChecker()
-  {
-    need_run_ = false;
-    if (thread_ != NULL) {
-      thread_->join();
-    }
-  }
-  void pause()
-  {
-    need_ping = false;
-    ip_ = "";
-  }
-  void set_ip(std::string ip)
-  {
-    if (ip != ip_) {
-      ip_ = ip;
-      need_ping = true;
-      run();
-    }
-  }
+  NetChecker();
+  ~NetChecker();
+  void pause();
+  /**
+   * @param tcp_port Port of the app, probed when ICMP is not allowed
+   */
+  void set_ip(std::string ip, uint16_t tcp_port);
+  NetStats stats();
 
 private:
-  void run()
-  {
-    if (thread_ == NULL) {
-      thread_ = std::make_shared<std::thread>(&NetChecker::run_, this);
-    }
-  }
+  enum ProbeType {PROBE_ICMP_DGRAM, PROBE_ICMP_RAW, PROBE_TCP};
 
-  void run_()
-  {
-    FILE * fp;
-    char buf[128];
-    while (need_run_) {
-      if (need_ping) {
-        std::string cmd = "ping -c 1 -w 2 " + ip_;
-        if ((fp = popen(cmd.c_str(), "r")) == NULL) {
-          std::cout << "failed to popen" << std::endl;
-          return;
-        }
+  void run();
+  void run_();
+  bool open_icmp_();
+  void send_probe_();
+  void on_probe_event_();
+  void finish_probe_(bool answered);
+  void close_probe_fd_();
 
-        while (fgets(buf, sizeof(buf), fp) != NULL) {
-          std::cout << buf << std::endl;
-        }
-        pclose(fp);
-      }
-      sleep(1);
-    }
-  }
   std::shared_ptr<std::thread> thread_;
+  std::atomic_bool need_run_;
+  int epoll_fd_;
+  int timer_fd_;
+  int wake_fd_;
+
+  // Set by callers, taken by checker thread on wake up
+  std::mutex ip_mutex_;
   std::string ip_;
-  bool need_run_;
+  uint16_t port_;
+  bool ip_changed_;
+
+  // Checker thread only
+  struct sockaddr_in target_;
+  uint16_t tcp_port_;
   bool need_ping;
+  ProbeType type_;
+  int probe_fd_;
+  uint16_t seq_;
+  bool probe_pending_;
+  std::chrono::steady_clock::time_point probe_time_;
+  std::deque<bool> window_;
+
+  std::mutex stats_mutex_;
+  NetStats stats_;
 };
 
 #endif  // NET_AVALIBLE_HPP_
@@ -0,0 +1,264 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef RESPONSE_QUEUE_HPP_
+#define RESPONSE_QUEUE_HPP_
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+// Cancellation of the waiting RPC is checked at least this often
+#define RESPONSE_CANCEL_POLL_MS 100
+
+/**
+ * @brief Bounded queue of responses from ROS callbacks to the thread of a
+ * server-streaming RPC. Pushing never blocks: when the ring is full the
+ * oldest response is dropped, and responses marked coalescable (progress
+ * feedback) only keep the latest one. Waiting sleeps on an eventfd and
+ * returns early when the RPC is cancelled.
+ */
+template<typename T>
+class ResponseQueue
+{
+public:
+  using Coalescable = std::function<bool (const T & value)>;
+  enum PopResult {POPPED = 0, TIMEOUT = 1, CANCELLED = 2};
+
+  /**
+   * @param capacity Responses kept besides the coalesced one, rounded up to a power of 2
+   * @param coalescable Responses for which only the latest is kept, none if empty
+   */
+  explicit ResponseQueue(size_t capacity, Coalescable coalescable = Coalescable())
+  : coalescable_(std::move(coalescable)), stamp_(0), dropped_(0), waiting_(0),
+    enqueue_pos_(0), dequeue_pos_(0)
+  {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  }
+  ~ResponseQueue()
+  {
+    if (event_fd_ >= 0) {
+      close(event_fd_);
+    }
+  }
+  ResponseQueue(const ResponseQueue &) = delete;
+  ResponseQueue & operator=(const ResponseQueue &) = delete;
+
+  /**
+   * @brief Add a response, any thread, never blocks
+   */
+  void push(T value)
+  {
+    auto stamp = stamp_.fetch_add(1);
+    if (coalescable_ && coalescable_(value)) {
+      auto item = std::make_shared<Item>();
+      item->stamp = stamp;
+      item->value = std::move(value);
+      if (std::atomic_exchange(&latest_, item) != nullptr) {
+        dropped_++;
+      }
+    } else {
+      Item item;
+      item.stamp = stamp;
+      item.value = std::move(value);
+      while (!enqueue_(item)) {
+        Item oldest;
+        if (dequeue_(oldest)) {
+          dropped_++;
+        }
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load() > 0) {
+      uint64_t one = 1;
+      ssize_t ret = write(event_fd_, &one, sizeof(one));
+      (void)ret;
+    }
+  }
+
+  /**
+   * @brief Take oldest response without waiting
+   */
+  bool try_pop(T & value)
+  {
+    auto peek = std::atomic_load(&latest_);
+    if (peek != nullptr) {
+      // Queued responses before the latest feedback go first
+      uint64_t head_stamp(0);
+      if (!head_stamp_(head_stamp) || peek->stamp < head_stamp) {
+        auto latest = std::atomic_exchange(&latest_, std::shared_ptr<Item>());
+        if (latest != nullptr) {
+          value = std::move(latest->value);
+          return true;
+        }
+      }
+    }
+    Item item;
+    if (dequeue_(item)) {
+      value = std::move(item.value);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Wait for a response until timeout, or until cancelled returns true
+   */
+  PopResult wait_and_pop(
+    T & value, std::chrono::milliseconds timeout,
+    const std::function<bool()> & cancelled = std::function<bool()>())
+  {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+      if (try_pop(value)) {
+        return POPPED;
+      }
+      if (cancelled && cancelled()) {
+        return CANCELLED;
+      }
+      auto left = deadline - std::chrono::steady_clock::now();
+      if (left.count() <= 0) {
+        return TIMEOUT;
+      }
+      // Rounded up, poll must not wake before the deadline
+      auto left_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        left + std::chrono::milliseconds(1) - std::chrono::nanoseconds(1)).count();
+      waiting_++;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (try_pop(value)) {
+        waiting_--;
+        return POPPED;
+      }
+      struct pollfd pfd = {event_fd_, POLLIN, 0};
+      poll(&pfd, 1, std::min<int64_t>(left_ms, RESPONSE_CANCEL_POLL_MS));
+      uint64_t count;
+      ssize_t ret = read(event_fd_, &count, sizeof(count));
+      (void)ret;
+      waiting_--;
+    }
+  }
+
+  void clear()
+  {
+    T value;
+    while (try_pop(value)) {
+    }
+  }
+
+  // Responses dropped by overflow or coalescing
+  uint64_t dropped() const {return dropped_;}
+
+private:
+  struct Item
+  {
+    uint64_t stamp;
+    T value;
+  };
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    std::atomic<uint64_t> stamp;
+    Item item;
+  };
+
+  // Bounded ring after D. Vyukov, safe for any number of producers and consumers
+  bool enqueue_(Item & item)
+  {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell * cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->stamp.store(item.stamp, std::memory_order_relaxed);
+    cell->item = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool dequeue_(Item & item)
+  {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell * cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    item = std::move(cell->item);
+    cell->item = Item();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Stamp of the oldest queued response, may be stale while others pop
+  bool head_stamp_(uint64_t & stamp)
+  {
+    size_t pos = dequeue_pos_.load(std::memory_order_acquire);
+    Cell & cell = cells_[pos & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+      return false;
+    }
+    stamp = cell.stamp.load(std::memory_order_relaxed);
+    return true;
+  }
+
+  Coalescable coalescable_;
+  std::shared_ptr<Item> latest_;
+  std::atomic<uint64_t> stamp_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic_int waiting_;
+  int event_fd_;
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+#endif  // RESPONSE_QUEUE_HPP_
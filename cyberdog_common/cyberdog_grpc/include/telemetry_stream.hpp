@@ -0,0 +1,117 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TELEMETRY_STREAM_HPP_
+#define TELEMETRY_STREAM_HPP_
+#include <grpcpp/client_context.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./cyberdog_app.grpc.pb.h"
+
+// Same as the deadline of the unary calls
+#define STREAM_WRITE_TIMEOUT_MS 2000
+
+/**
+ * @brief Topic classes, each class has its own stream so a large map never
+ * holds back status.
+ */
+enum TelemetryClass
+{
+  TELEMETRY_STATE = 0,
+  TELEMETRY_EVENT = 1,
+  TELEMETRY_MAP = 2,
+  TELEMETRY_CLASS_COUNT = 3
+};
+
+/**
+ * @brief One long lived streamTelemetry call to the app. Stream is opened on
+ * first write and reopened after a failure. Write blocks while the app does
+ * not keep up, which is the flow control of the stream, but at most
+ * STREAM_WRITE_TIMEOUT_MS, then the stream is cancelled. If the app does not
+ * implement streamTelemetry, the stream is disabled and callers fall back to
+ * the unary subscribe* calls.
+ * A written message is only buffered, the app confirms nothing before the
+ * stream ends. Until a stream has stayed up for STREAM_WRITE_TIMEOUT_MS the
+ * latest message of each payload is kept, and handed back to be sent by
+ * unary calls if the app answers UNIMPLEMENTED, as it then took none of
+ * them. Once a stream stayed up nothing is kept or handed back, the app may
+ * have taken any message before a later failure.
+ */
+class TelemetryStream
+{
+public:
+  explicit TelemetryStream(cyberdogapp::CyberdogApp::Stub * stub);
+  ~TelemetryStream();
+
+  /**
+   * @brief Write one message, any thread
+   * @param unconfirmed Filled when the app does not implement the stream, with
+   * the latest earlier message of every other payload written on it
+   * @return False if message is not taken by the stream, send it and unconfirmed
+   * by unary calls instead
+   */
+  bool write(
+    const cyberdogapp::Telemetry & msg, std::vector<cyberdogapp::Telemetry> & unconfirmed);
+
+  /**
+   * @brief Abort stream and any blocked write, no more stream after it
+   */
+  void cancel();
+
+  bool supported() const {return supported_;}
+  uint64_t written() const {return written_;}
+  // Writes cancelled by the write timeout
+  uint64_t timeouts() const {return timeouts_;}
+
+private:
+  bool open_();
+  void close_();
+  void watchdog_();
+
+  cyberdogapp::CyberdogApp::Stub * stub_;
+  std::mutex write_mutex_;
+  std::unique_ptr<grpc::ClientWriter<cyberdogapp::Telemetry>> writer_;
+  cyberdogapp::Result result_;
+  std::chrono::steady_clock::time_point retry_time_;
+  std::chrono::steady_clock::time_point open_time_;
+  // Set once a stream stayed up, nothing is kept after it
+  bool confirmed_;
+  // Latest message by payload case since the stream was opened, until confirmed
+  std::map<int, cyberdogapp::Telemetry> unconfirmed_;
+
+  // Cancel may come from another thread while a write is blocked
+  std::mutex context_mutex_;
+  std::shared_ptr<grpc::ClientContext> context_;
+
+  // Cancels the stream when a write is blocked beyond its deadline
+  std::mutex watchdog_mutex_;
+  std::condition_variable watchdog_cv_;
+  std::chrono::steady_clock::time_point write_deadline_;
+  bool watchdog_stop_;
+  std::thread watchdog_thread_;
+
+  std::atomic_bool supported_;
+  std::atomic_bool canceled_;
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> timeouts_;
+};
+
+#endif  // TELEMETRY_STREAM_HPP_
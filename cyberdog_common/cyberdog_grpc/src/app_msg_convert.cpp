@@ -0,0 +1,428 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "app_msg_convert.hpp"
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+google::protobuf::Arena & local_arena()
+{
+  thread_local std::unique_ptr<char[]> block(new char[CONVERT_ARENA_BLOCK]);
+  thread_local google::protobuf::Arena arena(
+    [] {
+      google::protobuf::ArenaOptions options;
+      options.initial_block = block.get();
+      options.initial_block_size = CONVERT_ARENA_BLOCK;
+      return options;
+    } ());
+  return arena;
+}
+
+template<typename FieldT, typename ContainerT>
+void fill_repeated(google::protobuf::RepeatedField<FieldT> * out, const ContainerT & in)
+{
+  out->Reserve(out->size() + in.size());
+  for (const auto & value : in) {
+    out->AddAlreadyReserved(static_cast<FieldT>(value));
+  }
+}
+
+template<typename PointT>
+void fill_point(const PointT & in, cyberdogapp::Point * out)
+{
+  out->set_x(in.x);
+  out->set_y(in.y);
+  out->set_z(in.z);
+}
+
+template<typename QuaternionT>
+void fill_quaternion(const QuaternionT & in, cyberdogapp::Quaternion * out)
+{
+  out->set_w(in.w);
+  out->set_x(in.x);
+  out->set_y(in.y);
+  out->set_z(in.z);
+}
+
+template<typename Vector3T>
+void fill_vector3(const Vector3T & in, cyberdogapp::Vector3 * out)
+{
+  out->set_x(in.x);
+  out->set_y(in.y);
+  out->set_z(in.z);
+}
+
+// libjpeg output straight into the bytes field
+struct StringDestination
+{
+  jpeg_destination_mgr pub;
+  std::string * out;
+};
+
+void string_init_destination(j_compress_ptr cinfo)
+{
+  auto dest = reinterpret_cast<StringDestination *>(cinfo->dest);
+  dest->out->resize(std::max<size_t>(dest->out->capacity(), 64 * 1024));
+  dest->pub.next_output_byte = reinterpret_cast<JOCTET *>(&(*dest->out)[0]);
+  dest->pub.free_in_buffer = dest->out->size();
+}
+
+boolean string_empty_output_buffer(j_compress_ptr cinfo)
+{
+  auto dest = reinterpret_cast<StringDestination *>(cinfo->dest);
+  size_t used = dest->out->size();
+  dest->out->resize(used * 2);
+  dest->pub.next_output_byte = reinterpret_cast<JOCTET *>(&(*dest->out)[used]);
+  dest->pub.free_in_buffer = dest->out->size() - used;
+  return TRUE;
+}
+
+void string_term_destination(j_compress_ptr cinfo)
+{
+  auto dest = reinterpret_cast<StringDestination *>(cinfo->dest);
+  dest->out->resize(dest->out->size() - dest->pub.free_in_buffer);
+}
+
+// Default handler of libjpeg exits the process
+struct JumpError
+{
+  jpeg_error_mgr pub;
+  jmp_buf jump;
+};
+
+void jump_error_exit(j_common_ptr cinfo)
+{
+  longjmp(reinterpret_cast<JumpError *>(cinfo->err)->jump, 1);
+}
+
+bool encode_jpeg(
+  const cyberdog_utils::ImageFrame & frame, const uint8_t * data, int quality,
+  std::string * out)
+{
+  jpeg_compress_struct cinfo;
+  JumpError error;
+  cinfo.err = jpeg_std_error(&error.pub);
+  error.pub.error_exit = jump_error_exit;
+  // Only touched before setjmp, so still valid after longjmp
+  std::vector<JSAMPLE> row;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_compress(&cinfo);
+    return false;
+  }
+  jpeg_create_compress(&cinfo);
+  StringDestination dest;
+  dest.pub.init_destination = string_init_destination;
+  dest.pub.empty_output_buffer = string_empty_output_buffer;
+  dest.pub.term_destination = string_term_destination;
+  dest.out = out;
+  cinfo.dest = &dest.pub;
+  cinfo.image_width = frame.width;
+  cinfo.image_height = frame.height;
+  bool swap_bgr(false);
+  if (frame.format == cyberdog_utils::IMAGE_MONO8) {
+    cinfo.input_components = 1;
+    cinfo.in_color_space = JCS_GRAYSCALE;
+  } else {
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+#ifdef JCS_EXTENSIONS
+    if (frame.format == cyberdog_utils::IMAGE_BGR8) {
+      cinfo.in_color_space = JCS_EXT_BGR;
+    }
+#else
+    swap_bgr = frame.format == cyberdog_utils::IMAGE_BGR8;
+#endif
+  }
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  if (swap_bgr) {
+    row.resize(frame.width * 3);
+  }
+  while (cinfo.next_scanline < cinfo.image_height) {
+    auto line = const_cast<JSAMPLE *>(data + cinfo.next_scanline * frame.step);
+    if (swap_bgr) {
+      for (uint32_t i = 0; i < frame.width * 3; i += 3) {
+        row[i] = line[i + 2];
+        row[i + 1] = line[i + 1];
+        row[i + 2] = line[i];
+      }
+      line = row.data();
+    }
+    jpeg_write_scanlines(&cinfo, &line, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return true;
+}
+}  // namespace
+
+ConvertArena::ConvertArena()
+: arena_(local_arena())
+{
+}
+
+ConvertArena::~ConvertArena()
+{
+  arena_.Reset();
+}
+
+namespace app_msg
+{
+void fill(const std_msgs::msg::Header & in, cyberdogapp::Header * out)
+{
+  out->mutable_stamp()->set_sec(in.stamp.sec);
+  out->mutable_stamp()->set_nanosec(in.stamp.nanosec);
+  out->set_frame_id(in.frame_id);
+}
+
+void fill(const nav_msgs::msg::MapMetaData & in, cyberdogapp::MapMetaData * out)
+{
+  out->mutable_map_load_time()->set_sec(in.map_load_time.sec);
+  out->mutable_map_load_time()->set_nanosec(in.map_load_time.nanosec);
+  out->set_resolution(in.resolution);
+  out->set_width(in.width);
+  out->set_height(in.height);
+  fill_point(in.origin.position, out->mutable_origin()->mutable_position());
+  fill_quaternion(in.origin.orientation, out->mutable_origin()->mutable_orientation());
+}
+
+void fill(const ception_msgs::msg::Bms & in, cyberdogapp::Bms * out)
+{
+  out->set_batt_soc(in.batt_soc);
+  out->set_status(in.status);
+}
+
+void fill(const motion_msgs::msg::ControlState & in, cyberdogapp::StatusStamped * out)
+{
+  auto rawstatus = out->mutable_status();
+  rawstatus->mutable_mode()->set_control_mode(in.modestamped.control_mode);
+  rawstatus->mutable_mode()->set_mode_type(in.modestamped.mode_type);
+  rawstatus->mutable_pattern()->set_gait_pattern(in.gaitstamped.gait);
+  rawstatus->mutable_cached_pattern()->set_gait_pattern(in.cached_gait.gait);
+
+  auto twist = rawstatus->mutable_twist()->mutable_twist();
+  twist->mutable_angular()->set_x(in.velocitystamped.angular_x);
+  twist->mutable_angular()->set_y(in.velocitystamped.angular_y);
+  twist->mutable_angular()->set_z(in.velocitystamped.angular_z);
+  twist->mutable_linear()->set_x(in.velocitystamped.linear_x);
+  twist->mutable_linear()->set_y(in.velocitystamped.linear_y);
+  twist->mutable_linear()->set_z(in.velocitystamped.linear_z);
+
+  auto pose = rawstatus->mutable_pose()->mutable_pose();
+  pose->mutable_position()->set_x(in.posestamped.position_x);
+  pose->mutable_position()->set_y(in.posestamped.position_y);
+  pose->mutable_position()->set_z(in.posestamped.position_z);
+  pose->mutable_orientation()->set_w(in.posestamped.rotation_w);
+  pose->mutable_orientation()->set_x(in.posestamped.rotation_x);
+  pose->mutable_orientation()->set_y(in.posestamped.rotation_y);
+  pose->mutable_orientation()->set_z(in.posestamped.rotation_z);
+
+  rawstatus->mutable_para()->set_body_height(in.parastamped.body_height);
+  rawstatus->mutable_para()->set_gait_height(in.parastamped.gait_height);
+  rawstatus->mutable_safety()->set_status(in.safety.status);
+  rawstatus->mutable_scene()->set_lat(in.scene.lat);
+  rawstatus->mutable_scene()->set_lon(in.scene.lon);
+  rawstatus->mutable_scene()->set_type(in.scene.type);
+  rawstatus->mutable_order()->set_id(in.orderstamped.id);
+  rawstatus->mutable_order()->set_para(in.orderstamped.para);
+  rawstatus->set_foot_contact(in.foot_contact);
+
+  auto error_flag = rawstatus->mutable_error_flag();
+  error_flag->set_exist_error(in.error_flag.exist_error);
+  error_flag->set_ori_error(in.error_flag.ori_error);
+  error_flag->set_footpos_error(in.error_flag.footpos_error);
+  fill_repeated(error_flag->mutable_motor_error(), in.error_flag.motor_error);
+}
+
+void fill(const std_msgs::msg::String & in, cyberdogapp::WifiRssi * out)
+{
+  out->set_rssi(in.data);
+}
+
+void fill(const automation_msgs::msg::TrackingStatus & in, cyberdogapp::TrackingStatus * out)
+{
+  out->set_status(in.status);
+}
+
+void fill(const automation_msgs::msg::Caution & in, cyberdogapp::Caution * out)
+{
+  out->set_error_type(in.error_type);
+  out->set_robot_mode(in.robot_mode);
+}
+
+void fill(const interaction_msgs::msg::BodyInfo & in, cyberdogapp::BodyInfo * out)
+{
+  out->set_count(in.count);
+  auto cnt = std::min<size_t>(std::max<int64_t>(0, in.count), in.infos.size());
+  out->mutable_infos()->Reserve(cnt);
+  for (size_t i = 0; i < cnt; ++i) {
+    auto roi = out->add_infos()->mutable_roi();
+    roi->set_height(in.infos[i].roi.height);
+    roi->set_width(in.infos[i].roi.width);
+    roi->set_x_offset(in.infos[i].roi.x_offset);
+    roi->set_y_offset(in.infos[i].roi.y_offset);
+    roi->set_do_rectify(in.infos[i].roi.do_rectify);
+  }
+}
+
+void fill(const nav_msgs::msg::OccupancyGrid & in, cyberdogapp::OccupancyGrid * out)
+{
+  fill(in.header, out->mutable_header());
+  fill(in.info, out->mutable_info());
+  fill_repeated(out->mutable_data(), in.data);
+}
+
+void fill(const motion_msgs::msg::SE3VelocityCMD & in, cyberdogapp::DecisionStamped * out)
+{
+  // Only twist is known by the app
+  auto twist = out->mutable_decissage()->mutable_twist();
+  twist->mutable_linear()->set_x(in.velocity.linear_x);
+  twist->mutable_linear()->set_y(in.velocity.linear_y);
+  twist->mutable_linear()->set_z(in.velocity.linear_z);
+  twist->mutable_angular()->set_x(in.velocity.angular_x);
+  twist->mutable_angular()->set_y(in.velocity.angular_y);
+  twist->mutable_angular()->set_z(in.velocity.angular_z);
+}
+
+void fill(const interaction_msgs::msg::VoiceprintResult & in, cyberdogapp::VoiceprintResult * out)
+{
+  fill(in.header, out->mutable_header());
+  out->set_error(in.error);
+  out->set_succeed(in.succeed);
+  out->set_type(in.type);
+}
+
+void fill(
+  const interaction_msgs::msg::FaceResult & in, cyberdogapp::FaceResult * out,
+  bool bytes_images)
+{
+  out->set_msg(in.msg);
+  out->set_result(in.result);
+  out->mutable_face_images()->Reserve(in.face_images.size());
+  for (const auto & face_image : in.face_images) {
+    fill(face_image, out->add_face_images(), bytes_images);
+  }
+}
+
+void fill(
+  const interaction_msgs::msg::CompressedImage & in, cyberdogapp::CompressedImage * out,
+  bool bytes_image)
+{
+  out->set_format(in.format);
+  fill(in.header, out->mutable_header());
+  if (bytes_image) {
+    out->set_image(reinterpret_cast<const char *>(in.data.data()), in.data.size());
+  } else {
+    fill_repeated(out->mutable_data(), in.data);
+  }
+}
+
+bool fill(
+  const cyberdog_utils::ImageFrame & frame, const uint8_t * data, int quality,
+  cyberdogapp::CompressedImage * out)
+{
+  out->set_format("jpeg");
+  out->mutable_header()->set_frame_id(frame.frame_id);
+  out->mutable_header()->mutable_stamp()->set_sec(frame.sec);
+  out->mutable_header()->mutable_stamp()->set_nanosec(frame.nanosec);
+  switch (frame.format) {
+    case cyberdog_utils::IMAGE_JPEG:
+      out->set_image(reinterpret_cast<const char *>(data), frame.size);
+      return true;
+    case cyberdog_utils::IMAGE_BGR8:
+    case cyberdog_utils::IMAGE_RGB8:
+    case cyberdog_utils::IMAGE_MONO8:
+      return encode_jpeg(frame, data, quality, out->mutable_image());
+    default:
+      return false;
+  }
+}
+
+void fill(const nav_msgs::msg::Odometry & in, cyberdogapp::Odometry * out)
+{
+  fill(in.header, out->mutable_header());
+  out->set_child_frame_id(in.child_frame_id);
+  auto pose = out->mutable_pose();
+  fill_point(in.pose.pose.position, pose->mutable_pose()->mutable_position());
+  fill_quaternion(in.pose.pose.orientation, pose->mutable_pose()->mutable_orientation());
+  fill_repeated(pose->mutable_covariance(), in.pose.covariance);
+  auto twist = out->mutable_twist();
+  fill_vector3(in.twist.twist.angular, twist->mutable_twist()->mutable_angular());
+  fill_vector3(in.twist.twist.linear, twist->mutable_twist()->mutable_linear());
+  fill_repeated(twist->mutable_covariance(), in.twist.covariance);
+}
+
+void fill(const ception_msgs::msg::Around & in, cyberdogapp::Around * out)
+{
+  const auto & range_info = in.front_distance.range_info;
+  auto range = out->mutable_front_distance()->mutable_range_info();
+  fill(range_info.header, range->mutable_header());
+  range->set_radiation_type(range_info.radiation_type);
+  range->set_field_of_view(range_info.field_of_view);
+  range->set_min_range(range_info.min_range);
+  range->set_max_range(range_info.max_range);
+  range->set_range(range_info.range);
+}
+
+void fill(const motion_msgs::msg::SE3Pose & in, cyberdogapp::DogPose * out)
+{
+  out->mutable_frameid()->set_id(in.frameid.id);
+  out->mutable_timestamp()->set_sec(in.timestamp.sec);
+  out->mutable_timestamp()->set_nanosec(in.timestamp.nanosec);
+  out->set_position_x(in.position_x);
+  out->set_position_y(in.position_y);
+  out->set_position_z(in.position_z);
+  out->set_rotation_w(in.rotation_w);
+  out->set_rotation_x(in.rotation_x);
+  out->set_rotation_y(in.rotation_y);
+  out->set_rotation_z(in.rotation_z);
+}
+
+void fill(const motion_msgs::msg::Scene & in, cyberdogapp::Scene * out)
+{
+  out->set_type(in.type);
+  out->set_lat(in.lat);
+  out->set_lon(in.lon);
+  out->set_if_danger(in.if_danger);
+}
+
+void fill(const ception_msgs::msg::BtRemoteEvent & in, cyberdogapp::RemoteEvent * out)
+{
+  out->set_scan_status(in.scan_status);
+  out->set_remote_status(in.remote_status);
+  out->set_address(in.address);
+  out->set_scan_device_info(in.scan_device_info);
+  out->set_error(in.error);
+}
+
+void fill(const nav_msgs::msg::Path & in, cyberdogapp::Path * out)
+{
+  fill(in.header, out->mutable_header());
+  out->mutable_posestamped()->Reserve(in.poses.size());
+  for (const auto & pose_stamped : in.poses) {
+    auto out_pose = out->add_posestamped();
+    fill(pose_stamped.header, out_pose->mutable_header());
+    fill_point(pose_stamped.pose.position, out_pose->mutable_pose()->mutable_position());
+    fill_quaternion(pose_stamped.pose.orientation, out_pose->mutable_pose()->mutable_orientation());
+  }
+}
+}  // namespace app_msg
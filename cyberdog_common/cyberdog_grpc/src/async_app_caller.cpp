@@ -0,0 +1,126 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "async_app_caller.hpp"
+#include <algorithm>
+#include <string>
+
+AsyncAppCaller::AsyncAppCaller(cyberdogapp::CyberdogApp::Stub * stub, uint32_t window)
+: stub_(stub), window_(std::max<uint32_t>(1, window)), shutdown_(false), dropped_(0)
+{
+  thread_ = std::thread(&AsyncAppCaller::poll_thread, this);
+}
+
+AsyncAppCaller::~AsyncAppCaller()
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    shutdown_ = true;
+  }
+  cancel();
+  // Calls cancelled above still come out of the queue before it reports shutdown
+  cq_.Shutdown();
+  thread_.join();
+}
+
+void AsyncAppCaller::cancel()
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (auto pending : pending_) {
+    pending->context.TryCancel();
+  }
+  for (auto & queued : queued_) {
+    dropped_ += queued.second.size();
+    queued.second.clear();
+  }
+}
+
+AsyncAppCaller::Pending * AsyncAppCaller::start_(const std::string & topic)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto & in_flight = in_flight_[topic];
+  if (shutdown_ || in_flight >= window_) {
+    dropped_++;
+    return nullptr;
+  }
+  return new_pending_(topic);
+}
+
+bool AsyncAppCaller::queue_(const std::string & topic, Starter starter)
+{
+  Pending * pending;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (shutdown_) {
+      dropped_++;
+      return false;
+    }
+    auto & queued = queued_[topic];
+    // Behind the queued ones, so calls of topic keep their order
+    if (!queued.empty() || in_flight_[topic] >= window_) {
+      bool dropped = false;
+      if (queued.size() >= ASYNC_QUEUED_CALLS_MAX) {
+        queued.pop_front();
+        dropped_++;
+        dropped = true;
+      }
+      queued.push_back(std::move(starter));
+      return !dropped;
+    }
+    pending = new_pending_(topic);
+  }
+  starter(pending);
+  return true;
+}
+
+AsyncAppCaller::Pending * AsyncAppCaller::new_pending_(const std::string & topic)
+{
+  in_flight_[topic]++;
+  auto pending = new Pending;
+  pending->topic = topic;
+  pending->start = std::chrono::steady_clock::now();
+  pending->context.set_deadline(
+    std::chrono::system_clock::now() + std::chrono::seconds(ASYNC_CALL_DEADLINE_SECONDS));
+  pending_.insert(pending);
+  return pending;
+}
+
+void AsyncAppCaller::poll_thread()
+{
+  void * tag;
+  bool ok;
+  while (cq_.Next(&tag, &ok)) {
+    auto pending = static_cast<Pending *>(tag);
+    auto elapsed = std::chrono::steady_clock::now() - pending->start;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      in_flight_[pending->topic]--;
+      pending_.erase(pending);
+      auto queued = queued_.find(pending->topic);
+      if (!shutdown_ && queued != queued_.end() && !queued->second.empty()) {
+        // Started under the lock, so never on a queue already shut down
+        queued->second.front()(new_pending_(pending->topic));
+        queued->second.pop_front();
+      }
+    }
+    if (done_callback_ != nullptr) {
+      done_callback_(pending->topic, elapsed, ok && pending->status.ok());
+    }
+    if (pending->status_callback != nullptr) {
+      pending->status_callback(pending->status);
+    }
+    delete pending;
+  }
+}
@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -52,6 +53,18 @@ using grpc::ServerWriter;
 #define SEND_CMD_TTL 2
 #define RECV_CMD_TTL 12
 #define APP_CONNECTED_FAIL_CNT 3
+// Responses kept per queue, feedback beyond the latest one is coalesced
+#define RESPONSE_QUEUE_CAPACITY 16
+// Wait for action result when app gives no timeout
+#define ACTION_RESULT_TIMEOUT_SECONDS 35
+#define OFFSET_RESULT_TIMEOUT_SECONDS 3
+// Reads of the camera ring for one GET_IMAGE
+#define CAMERA_IMAGE_RETRY 3
+// Frame period of the camera at its lowest rate, wait for a fresh frame
+// after opening the ring at most this long
+#define CAMERA_FRAME_WAIT_MS 100
+// Camera stops copying frames once the ring is closed
+#define CAMERA_RING_IDLE_SECONDS 10
 using std::placeholders::_1;
 using namespace std::chrono_literals;
 using SE3VelocityCMD_T = motion_msgs::msg::SE3VelocityCMD;
@@ -59,30 +72,39 @@ using SE3VelocityCMD_T = motion_msgs::msg::SE3VelocityCMD;
 namespace cyberdog_cyberdog_app
 {
 static int64_t requestNumber;
-Cyberdog_app::Cyberdog_app()
-: Node("motion_test_server"), is_mode_check(false), patternCheckout_client_(NULL),
+Cyberdog_app::Cyberdog_app(const rclcpp::NodeOptions & options)
+: Node("motion_test_server", options), is_mode_check(false), patternCheckout_client_(NULL),
   ModeCheckout_client_(NULL), ticks_(0),
   can_process_messages(false), wait_for_set_data_result(false), wait_for_offset_data(false),
   heartbeat_err_cnt(0), heart_beat_thread_(nullptr), app_server_thread_(nullptr), server_(nullptr),
   app_stub(nullptr), app_disconnected(false), destory_grpc_server_thread_(nullptr),
-  change_mode_id(0), change_gait_id(0), ext_mon_id(0)
+  change_mode_id(0), change_gait_id(0), ext_mon_id(0), bytes_images(false)
 {
   RCLCPP_INFO(get_logger(), "Cyberdog_app Configuring");
+  // Calls to app in flight per topic, 0 for blocking calls
+  async_window = this->declare_parameter("async_window", 0);
+  app_port = this->declare_parameter("app_port", 8980);
+  server_port = this->declare_parameter("server_port", 50051);
+  image_transport = this->declare_parameter("image_transport", std::string("ros"));
   server_ip = std::make_shared<std::string>("0.0.0.0");
   callback_group_ = this->create_callback_group(rclcpp::CallbackGroupType::Reentrant);
+  auto is_feedback = [](const auto & respond) {return respond->is_feedback();};
   modeRespond_queue =
-    std::make_shared<threadsafe_queue<std::shared_ptr<::cyberdogapp::CheckoutMode_respond>>>();
+    std::make_shared<ResponseQueue<std::shared_ptr<::cyberdogapp::CheckoutMode_respond>>>(
+    RESPONSE_QUEUE_CAPACITY, is_feedback);
   patternRespond_queue =
-    std::make_shared<threadsafe_queue<std::shared_ptr<::cyberdogapp::CheckoutPattern_respond>>>();
+    std::make_shared<ResponseQueue<std::shared_ptr<::cyberdogapp::CheckoutPattern_respond>>>(
+    RESPONSE_QUEUE_CAPACITY, is_feedback);
   extMonOrderRespond_queue =
-    std::make_shared<threadsafe_queue<std::shared_ptr<::cyberdogapp::ExtMonOrder_Respond>>>();
+    std::make_shared<ResponseQueue<std::shared_ptr<::cyberdogapp::ExtMonOrder_Respond>>>(
+    RESPONSE_QUEUE_CAPACITY, is_feedback);
 
   offsetCalibationData_queue =
-    std::make_shared<threadsafe_queue<std::shared_ptr<::cyberdogapp::OffsetCalibationData>>>();
+    std::make_shared<ResponseQueue<std::shared_ptr<::cyberdogapp::OffsetCalibationData>>>(
+    RESPONSE_QUEUE_CAPACITY);
   offsetRequestResult_queue =
-    std::make_shared<threadsafe_queue<std::shared_ptr<::cyberdogapp::OffsetRequest_result>>>();
-  offsetCalibationData_queue->set_time_out(3);
-  offsetRequestResult_queue->set_time_out(3);
+    std::make_shared<ResponseQueue<std::shared_ptr<::cyberdogapp::OffsetRequest_result>>>(
+    RESPONSE_QUEUE_CAPACITY);
 
   camera_client_ = this->create_client<interaction_msgs::srv::CameraService>(
     "camera_service",
@@ -207,7 +229,13 @@ void Cyberdog_app::HeartBeat()
   std::string ipv4;
   while (true) {
     if (can_process_messages && app_stub) {
-      if (!app_stub->SetHeartBeat(local_ip)) {
+      bool heartbeat_ok = app_stub->SetHeartBeat(local_ip);
+      auto link = getLinkStats();
+      app_stub->updateLinkRate(link, heartbeat_ok);
+      if (!heartbeat_ok) {
+        RCLCPP_INFO(
+          get_logger(), "heartbeat failed, app reachable: %d rtt: %.1f ms loss: %.0f%%",
+          link.reachable, link.rtt_avg_ms, link.loss * 100);
         if (heartbeat_err_cnt++ >= APP_CONNECTED_FAIL_CNT) {
           if (!app_disconnected) {
             destroyGrpc();
@@ -216,13 +244,14 @@ void Cyberdog_app::HeartBeat()
         }
       }
     }
+    releaseIdleCameraRing();
     r.sleep();
   }
 }
 void Cyberdog_app::RunServer()
 {
   RCLCPP_INFO(get_logger(), "run_server thread id is %d", gettid());
-  std::string server_address("0.0.0.0:50051");
+  std::string server_address("0.0.0.0:" + std::to_string(server_port));
   CyberdogAppImpl service(server_address);
   service.SetRequesProcess(this);
   ServerBuilder builder;
@@ -240,6 +269,7 @@ void Cyberdog_app::RunServer()
 }
 
 void Cyberdog_app::publishPattern(
+  ::grpc::ServerContext * context,
   const ::cyberdogapp::CheckoutPattern_request * request,
   ::grpc::ServerWriter<::cyberdogapp::CheckoutPattern_respond> * writer)
 {
@@ -253,37 +283,39 @@ void Cyberdog_app::publishPattern(
   request_.timeout = request->timeout();
   action_request_pub->publish(request_);
   RCLCPP_INFO(get_logger(), "get check Pattern timeout seconds: %d", request->timeout());
-  if (request->timeout() > 0) {
-    patternRespond_queue->set_time_out(request->timeout());
-  } else {
-    patternRespond_queue->set_time_out(35);
-  }
+  auto timeout = std::chrono::seconds(
+    request->timeout() > 0 ? request->timeout() : ACTION_RESULT_TIMEOUT_SECONDS);
+  auto cancelled = [context] {return context->IsCancelled();};
   while (true) {
-    RCLCPP_INFO(get_logger(), "get check Pattern respond1");
-    std::shared_ptr<std::shared_ptr<cyberdogapp::CheckoutPattern_respond>> respond =
-      patternRespond_queue->wait_and_pop();
-    RCLCPP_INFO(get_logger(), "get check Pattern respond2");
-    if (respond == NULL) {
+    std::shared_ptr<cyberdogapp::CheckoutPattern_respond> respond;
+    auto result = patternRespond_queue->wait_and_pop(respond, timeout, cancelled);
+    if (result == PATTERN_QUEUE_T::CANCELLED) {
+      RCLCPP_INFO(get_logger(), "get check Pattern cancelled");
+      return;
+    } else if (result == PATTERN_QUEUE_T::TIMEOUT) {
       RCLCPP_INFO(get_logger(), "get check Pattern timeout");
       return;
     }
 
-    if (respond->get()->request_id() != request_.request_id) {
+    if (respond->request_id() != request_.request_id) {
       RCLCPP_INFO(get_logger(), "get check Pattern invalid id");
       continue;
     }
 
-    respond->get()->mutable_patternstamped()->CopyFrom(request->patternstamped());
-    writer->Write(*(respond->get()));
-    if (!respond->get()->is_feedback()) {
+    respond->mutable_patternstamped()->CopyFrom(request->patternstamped());
+    if (!writer->Write(*respond)) {
+      RCLCPP_INFO(get_logger(), "get check Pattern stream closed");
+      return;
+    }
+    if (!respond->is_feedback()) {
       RCLCPP_INFO(get_logger(), "get check Pattern result");
-      patternRespond_queue->empty();
       return;
     }
   }
 }
 
 void Cyberdog_app::publishMode(
+  ::grpc::ServerContext * context,
   const ::cyberdogapp::CheckoutMode_request * request,
   ::grpc::ServerWriter<::cyberdogapp::CheckoutMode_respond> * writer)
 {
@@ -298,32 +330,35 @@ void Cyberdog_app::publishMode(
   request_.timeout = request->timeout();
   action_request_pub->publish(request_);
   RCLCPP_INFO(get_logger(), "get check mode timeout seconds: %d", request->timeout());
-  if (request->timeout() > 0) {
-    modeRespond_queue->set_time_out(request->timeout());
-  } else {
-    modeRespond_queue->set_time_out(35);
-  }
+  auto timeout = std::chrono::seconds(
+    request->timeout() > 0 ? request->timeout() : ACTION_RESULT_TIMEOUT_SECONDS);
+  auto cancelled = [context] {return context->IsCancelled();};
   while (true) {
-    RCLCPP_INFO(get_logger(), "get check mode respond1");
-    std::shared_ptr<std::shared_ptr<::cyberdogapp::CheckoutMode_respond>> respond =
-      modeRespond_queue->wait_and_pop();
-    RCLCPP_INFO(get_logger(), "get check mode respond2");
-    if (respond == NULL) {
+    std::shared_ptr<::cyberdogapp::CheckoutMode_respond> respond;
+    auto result = modeRespond_queue->wait_and_pop(respond, timeout, cancelled);
+    if (result == MODE_QUEUE_T::CANCELLED) {
+      RCLCPP_INFO(get_logger(), "get check mode cancelled");
+      is_mode_check = false;
+      return;
+    } else if (result == MODE_QUEUE_T::TIMEOUT) {
       RCLCPP_INFO(get_logger(), "get check mode timeout");
       is_mode_check = false;
       return;
     }
 
-    if (respond->get()->request_id() != request_.request_id) {
+    if (respond->request_id() != request_.request_id) {
       RCLCPP_INFO(get_logger(), "get check mode invalid id");
       continue;
     }
 
-    respond->get()->mutable_next_mode()->CopyFrom(request->next_mode().mode());
-    writer->Write(*(respond->get()));
-    if (!respond->get()->is_feedback()) {
+    respond->mutable_next_mode()->CopyFrom(request->next_mode().mode());
+    if (!writer->Write(*respond)) {
+      RCLCPP_INFO(get_logger(), "get check mode stream closed");
+      is_mode_check = false;
+      return;
+    }
+    if (!respond->is_feedback()) {
       RCLCPP_INFO(get_logger(), "get check mode result");
-      modeRespond_queue->empty();
       is_mode_check = false;
       return;
     }
@@ -365,6 +400,74 @@ void Cyberdog_app::callCameraService(
   response->set_result(future_result.get()->result);
   response->set_msg(future_result.get()->msg);
 }
+
+void Cyberdog_app::getCameraImage(
+  const std::string & args,
+  ::cyberdogapp::CameraService_respond * respond)
+{
+  int quality = args.empty() ? JPEG_DEFAULT_QUALITY : std::atoi(args.c_str());
+  quality = std::min(100, std::max(1, quality));
+  if (image_transport != "shm") {
+    respond->set_result(interaction_msgs::srv::CameraService_Response::RESULT_UNSUPPORTED);
+    respond->set_msg("image_transport is not shm");
+    return;
+  }
+  std::lock_guard<std::mutex> lock(camera_ring_mutex);
+  camera_ring_used = std::chrono::steady_clock::now();
+  if (camera_ring != nullptr && camera_ring->stale()) {
+    camera_ring.reset();
+  }
+  if (camera_ring == nullptr) {
+    // Camera only fills the ring while a reader has it open, what is in it
+    // now may be from long ago
+    camera_ring = cyberdog_utils::ImageRing::open(cyberdog_utils::CAMERA_RGB_RING);
+    if (camera_ring == nullptr) {
+      respond->set_result(interaction_msgs::srv::CameraService_Response::RESULT_INVALID_STATE);
+      respond->set_msg("camera is not running");
+      return;
+    }
+    auto written = camera_ring->written();
+    auto deadline = camera_ring_used + std::chrono::milliseconds(CAMERA_FRAME_WAIT_MS);
+    while (camera_ring->written() == written && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    if (camera_ring->written() == written) {
+      respond->set_result(interaction_msgs::srv::CameraService_Response::RESULT_BUSY);
+      respond->set_msg("no camera image");
+      return;
+    }
+  }
+  bool encoded(false);
+  // Producer overwriting the slot while encoding is rare, take the next one then
+  for (int i = 0; i < CAMERA_IMAGE_RETRY && !encoded; i++) {
+    bool read = camera_ring->read_latest(
+      [&encoded, quality, respond](const cyberdog_utils::ImageFrame & frame, const uint8_t * data) {
+        encoded = app_msg::fill(frame, data, quality, respond->mutable_image());
+      });
+    encoded = encoded && read;
+    if (!read && camera_ring->written() == 0) {
+      break;
+    }
+  }
+  if (encoded) {
+    respond->set_result(interaction_msgs::srv::CameraService_Response::RESULT_SUCCESS);
+  } else {
+    respond->clear_image();
+    respond->set_result(interaction_msgs::srv::CameraService_Response::RESULT_BUSY);
+    respond->set_msg("no camera image");
+  }
+}
+void Cyberdog_app::releaseIdleCameraRing()
+{
+  std::lock_guard<std::mutex> lock(camera_ring_mutex);
+  if (camera_ring != nullptr &&
+    std::chrono::steady_clock::now() - camera_ring_used >
+    std::chrono::seconds(CAMERA_RING_IDLE_SECONDS))
+  {
+    RCLCPP_INFO(get_logger(), "camera ring idle, close it");
+    camera_ring.reset();
+  }
+}
 void Cyberdog_app::requestVoice(
   const ::cyberdogapp::Voiceprint_Request * request,
   ::cyberdogapp::Voiceprint_Response * respond)
@@ -484,14 +587,15 @@ void Cyberdog_app::createGrpc()
     app_server_thread_ = std::make_shared<std::thread>(&Cyberdog_app::RunServer, this);
   }
   RCLCPP_INFO(get_logger(), "Create client");
-  grpc::string ip = *server_ip + std::string(":8980");
+  grpc::string ip = *server_ip + ":" + std::to_string(app_port);
   can_process_messages = false;
   heartbeat_err_cnt = 0;
-  net_checker.set_ip(*server_ip);
+  net_checker.set_ip(*server_ip, app_port);
   RCLCPP_INFO(get_logger(), "before channel");
   auto channel_ = grpc::CreateChannel(ip, grpc::InsecureChannelCredentials());
   RCLCPP_INFO(get_logger(), "after channel");
-  app_stub = std::make_shared<Cyberdog_App_Client>(channel_);
+  app_stub = std::make_shared<Cyberdog_App_Client>(channel_, std::max(0, async_window));
+  app_stub->setBytesImages(bytes_images);
   RCLCPP_INFO(get_logger(), "end channel");
   can_process_messages = true;
   if (app_disconnected) {
@@ -584,6 +688,13 @@ void Cyberdog_app::requestFaceManager(
   request_->command = request->command();
   request_->args = request->args();
   RCLCPP_INFO(get_logger(), "requestFaceManager.");
+  if (request->bytes_images()) {
+    // Sticks for the FaceResult pushes of this app too
+    bytes_images = true;
+    if (app_stub) {
+      app_stub->setBytesImages(true);
+    }
+  }
 
   if (!face_manager_client_->wait_for_service()) {
     RCLCPP_INFO(get_logger(), "requestFaceManager server not avalible");
@@ -596,28 +707,10 @@ void Cyberdog_app::requestFaceManager(
       interaction_msgs::srv::FaceManager::Response::RESULT_SUCCESS)
     {
       RCLCPP_INFO(get_logger(), "Succeed changed requestFaceManager.");
-      std::vector<interaction_msgs::msg::CompressedImage> face_images =
-        future_result.get()->face_images;
-      int cnt = face_images.size();
-      for (int i = 0; i < cnt; ++i) {
-        ::cyberdogapp::CompressedImage * img = respond->add_face_images();
-        ::cyberdogapp::Header header;
-        ::cyberdogapp::Timestamp time;
-
-        // construct format
-        img->set_format(face_images[i].format);
-
-        // construct header
-        time.set_sec(face_images[i].header.stamp.sec);
-        time.set_nanosec(face_images[i].header.stamp.nanosec);
-        header.set_frame_id(face_images[i].header.frame_id);
-        header.mutable_stamp()->CopyFrom(time);
-        img->mutable_header()->CopyFrom(header);
-
-        // construct data
-        for (int j = 0; j < face_images[i].data.size(); j++) {
-          img->add_data(face_images[i].data[j]);
-        }
+      const auto & face_images = future_result.get()->face_images;
+      respond->mutable_face_images()->Reserve(face_images.size());
+      for (const auto & face_image : face_images) {
+        app_msg::fill(face_image, respond->add_face_images(), request->bytes_images());
       }
     } else {
       RCLCPP_INFO(get_logger(), "Failed to changed requestFaceManager.");
@@ -825,6 +918,7 @@ std_msgs::msg::Header Cyberdog_app::returnHeader()
 #define OFFSET_SLOW_TROT "speed_offset_slow_trot"
 
 void Cyberdog_app::getOffsetData(
+  ::grpc::ServerContext * context,
   const ::cyberdogapp::OffsetRequest * request,
   ::grpc::ServerWriter<::cyberdogapp::OffsetCalibationData> * writer)
 {
@@ -854,19 +948,22 @@ void Cyberdog_app::getOffsetData(
   offset_request->publish("interface_request", &request_);
 
   wait_for_offset_data = true;
-  std::shared_ptr<std::shared_ptr<cyberdogapp::OffsetCalibationData>> respond =
-    offsetCalibationData_queue->wait_and_pop();
-  if (respond == NULL) {
-    RCLCPP_INFO(get_logger(), "get getOffsetData timeout");
+  std::shared_ptr<cyberdogapp::OffsetCalibationData> respond;
+  if (offsetCalibationData_queue->wait_and_pop(
+      respond, std::chrono::seconds(OFFSET_RESULT_TIMEOUT_SECONDS),
+      [context] {return context->IsCancelled();}) != OFFSET_DATA_QUEUE_T::POPPED)
+  {
+    RCLCPP_INFO(get_logger(), "get getOffsetData timeout or cancelled");
     wait_for_offset_data = false;
     return;
   }
-  writer->Write(*(respond->get()));
+  writer->Write(*respond);
   wait_for_offset_data = false;
   offsetCalibationData_queue->clear();
 }
 
 void Cyberdog_app::setOffsetData(
+  ::grpc::ServerContext * context,
   const ::cyberdogapp::OffsetCalibationData * request,
   ::grpc::ServerWriter<::cyberdogapp::OffsetRequest_result> * writer)
 {
@@ -907,18 +1004,21 @@ void Cyberdog_app::setOffsetData(
 
   offset_request->publish("interface_request", &request_);
   wait_for_set_data_result = true;
-  std::shared_ptr<std::shared_ptr<cyberdogapp::OffsetRequest_result>> respond =
-    offsetRequestResult_queue->wait_and_pop();
-  if (respond == NULL) {
-    RCLCPP_INFO(get_logger(), "get setOffsetData timeout");
+  std::shared_ptr<cyberdogapp::OffsetRequest_result> respond;
+  if (offsetRequestResult_queue->wait_and_pop(
+      respond, std::chrono::seconds(OFFSET_RESULT_TIMEOUT_SECONDS),
+      [context] {return context->IsCancelled();}) != OFFSET_RESULT_QUEUE_T::POPPED)
+  {
+    RCLCPP_INFO(get_logger(), "get setOffsetData timeout or cancelled");
     wait_for_set_data_result = false;
     return;
   }
-  writer->Write(*(respond->get()));
+  writer->Write(*respond);
   wait_for_set_data_result = false;
   offsetRequestResult_queue->clear();
 }
 void Cyberdog_app::setExtmonOrder(
+  ::grpc::ServerContext * context,
   const ::cyberdogapp::ExtMonOrder_Request * request,
   ::grpc::ServerWriter< ::cyberdogapp::ExtMonOrder_Respond> * writer)
 {
@@ -932,29 +1032,32 @@ void Cyberdog_app::setExtmonOrder(
   request_.timeout = request->timeout();
   action_request_pub->publish(request_);
   RCLCPP_INFO(get_logger(), "get check extmonorder timeout seconds: %d", request->timeout());
-  if (request->timeout() > 0) {
-    extMonOrderRespond_queue->set_time_out(request->timeout());
-  } else {
-    extMonOrderRespond_queue->set_time_out(35);
-  }
+  auto timeout = std::chrono::seconds(
+    request->timeout() > 0 ? request->timeout() : ACTION_RESULT_TIMEOUT_SECONDS);
+  auto cancelled = [context] {return context->IsCancelled();};
   while (true) {
-    std::shared_ptr<std::shared_ptr<cyberdogapp::ExtMonOrder_Respond>> respond =
-      extMonOrderRespond_queue->wait_and_pop();
-    if (respond == NULL) {
+    std::shared_ptr<cyberdogapp::ExtMonOrder_Respond> respond;
+    auto result = extMonOrderRespond_queue->wait_and_pop(respond, timeout, cancelled);
+    if (result == EXTMONORDER_QUEUE_T::CANCELLED) {
+      RCLCPP_INFO(get_logger(), "get check extmonorder cancelled");
+      return;
+    } else if (result == EXTMONORDER_QUEUE_T::TIMEOUT) {
       RCLCPP_INFO(get_logger(), "get check extmonorder timeout");
       return;
     }
 
-    if (respond->get()->request_id() != request_.request_id) {
+    if (respond->request_id() != request_.request_id) {
       RCLCPP_INFO(get_logger(), "get check extmonorder invalid id");
       continue;
     }
 
-    respond->get()->mutable_order()->CopyFrom(request->order());
-    writer->Write(*(respond->get()));
-    if (!respond->get()->is_feedback()) {
+    respond->mutable_order()->CopyFrom(request->order());
+    if (!writer->Write(*respond)) {
+      RCLCPP_INFO(get_logger(), "get check extmonorder stream closed");
+      return;
+    }
+    if (!respond->is_feedback()) {
       RCLCPP_INFO(get_logger(), "get check extmonorder result");
-      extMonOrderRespond_queue->empty();
       return;
     }
   }
@@ -29,7 +29,7 @@ CyberdogAppImpl::CyberdogAppImpl(const std::string & db)
 {
   std::cout << "Server get mode: " << request->next_mode().mode().control_mode() << std::endl;
   if (decision_) {
-    decision_->publishMode(request, writer);
+    decision_->publishMode(context, request, writer);
   }
   return Status::OK;
 }
@@ -41,7 +41,7 @@ CyberdogAppImpl::CyberdogAppImpl(const std::string & db)
   std::cout << "Server get pattern: " << request->patternstamped().pattern().gait_pattern() <<
     std::endl;
   if (decision_) {
-    decision_->publishPattern(request, writer);
+    decision_->publishPattern(context, request, writer);
   }
   return Status::OK;
 }
@@ -55,7 +55,11 @@ Status CyberdogAppImpl::requestCamera(
   std::string args = request->args();
   ::cyberdogapp::CameraService_respond respond;
   if (decision_) {
-    decision_->callCameraService(command, args, &respond);
+    if (command == ::cyberdogapp::CameraService_request::GET_IMAGE) {
+      decision_->getCameraImage(args, &respond);
+    } else {
+      decision_->callCameraService(command, args, &respond);
+    }
     respond.set_command(command);
     writer->Write(respond);
   }
@@ -258,7 +262,7 @@ Status CyberdogAppImpl::sendMotionTestRequest(
 {
   RCLCPP_INFO(decision_->get_logger(), "getOffsetData");
   if (decision_) {
-    decision_->getOffsetData(request, writer);
+    decision_->getOffsetData(context, request, writer);
   }
   return Status::OK;
 }
@@ -270,7 +274,7 @@ Status CyberdogAppImpl::sendMotionTestRequest(
 {
   RCLCPP_INFO(decision_->get_logger(), "setOffsetData");
   if (decision_) {
-    decision_->setOffsetData(request, writer);
+    decision_->setOffsetData(context, request, writer);
   }
   return Status::OK;
 }
@@ -282,7 +286,7 @@ Status CyberdogAppImpl::sendMotionTestRequest(
 {
   RCLCPP_INFO(decision_->get_logger(), "setExtmonOrder");
   if (decision_) {
-    decision_->setExtmonOrder(request, writer);
+    decision_->setExtmonOrder(context, request, writer);
   }
   return Status::OK;
 }
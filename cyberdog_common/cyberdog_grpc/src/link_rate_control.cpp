@@ -0,0 +1,127 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "link_rate_control.hpp"
+#include <algorithm>
+#include <string>
+
+// Send slower than this is congestion whatever the round trip is
+#define LATENCY_FLOOR_MS 200.0
+#define LATENCY_RTT_FACTOR 4.0
+// Close to the 2 s deadline of the calls
+#define SLOW_SEND_MS 1000.0
+#define LOSS_LIMIT 0.2
+#define BULK_START_S 0.5
+#define BULK_MAX_S 8.0
+#define NORMAL_START_S 0.2
+#define NORMAL_MAX_S 2.0
+#define BACKOFF 2.0
+#define RECOVER 0.8
+
+LinkRateControl::LinkRateControl()
+: last_update_(std::chrono::steady_clock::now())
+{
+}
+
+size_t LinkRateControl::add_topic(
+  const std::string & name, TopicPriority priority,
+  RateSetter setter)
+{
+  topics_.push_back(Topic{name, priority, std::move(setter)});
+  return topics_.size() - 1;
+}
+
+void LinkRateControl::on_sent(size_t topic, std::chrono::steady_clock::duration elapsed)
+{
+  if (topic >= topics_.size()) {
+    return;
+  }
+  double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+  std::lock_guard<std::mutex> lk(window_mutex_);
+  auto & window = window_[topics_[topic].priority];
+  window.count++;
+  window.latency_ms_sum += ms;
+  if (ms >= SLOW_SEND_MS) {
+    window.slow++;
+  }
+}
+
+void LinkRateControl::update(const NetStats & link, bool heartbeat_ok)
+{
+  auto now = std::chrono::steady_clock::now();
+  double interval_s = std::max(
+    1e-3, std::chrono::duration<double>(now - last_update_).count());
+  last_update_ = now;
+  Window window[PRIORITY_COUNT];
+  {
+    std::lock_guard<std::mutex> lk(window_mutex_);
+    std::copy(window_, window_ + PRIORITY_COUNT, window);
+    std::fill(window_, window_ + PRIORITY_COUNT, Window());
+  }
+
+  double target_ms = LATENCY_FLOOR_MS;
+  if (link.received > 0) {
+    target_ms = std::max(target_ms, LATENCY_RTT_FACTOR * link.rtt_avg_ms);
+  }
+  bool congested = !heartbeat_ok || link.loss > LOSS_LIMIT;
+  const LinkRateStats old_stats = this->stats();
+  LinkRateStats stats = old_stats;
+  for (int i = 0; i < PRIORITY_COUNT; i++) {
+    stats.delivered_hz[i] = window[i].count / interval_s;
+    stats.latency_ms[i] = window[i].count ? window[i].latency_ms_sum / window[i].count : 0;
+    congested = congested || window[i].slow > 0 || stats.latency_ms[i] > target_ms;
+  }
+  stats.congested = congested;
+
+  double & bulk = stats.period_s[PRIORITY_BULK];
+  double & normal = stats.period_s[PRIORITY_NORMAL];
+  if (congested) {
+    // Bulk topics first, normal ones once bulk ones are at their floor
+    if (bulk < BULK_MAX_S) {
+      bulk = bulk > 0 ? std::min(bulk * BACKOFF, BULK_MAX_S) : BULK_START_S;
+    } else {
+      normal = normal > 0 ? std::min(normal * BACKOFF, NORMAL_MAX_S) : NORMAL_START_S;
+    }
+  } else if (normal > 0) {
+    normal = normal * RECOVER < NORMAL_START_S / 2 ? 0 : normal * RECOVER;
+  } else if (bulk > 0) {
+    bulk = bulk * RECOVER < BULK_START_S / 2 ? 0 : bulk * RECOVER;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(stats_mutex_);
+    stats_ = stats;
+  }
+  for (int i = PRIORITY_NORMAL; i < PRIORITY_COUNT; i++) {
+    if (stats.period_s[i] != old_stats.period_s[i]) {
+      apply_(static_cast<TopicPriority>(i), stats.period_s[i]);
+    }
+  }
+}
+
+LinkRateStats LinkRateControl::stats()
+{
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  return stats_;
+}
+
+void LinkRateControl::apply_(TopicPriority priority, double period_s)
+{
+  for (auto & topic : topics_) {
+    if (topic.priority == priority && topic.setter != nullptr) {
+      topic.setter(period_s > 0 ? 1.0 / period_s : 0);
+    }
+  }
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "map_tiles.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define RLE_MAX_RUN 255
+
+MapTileEncoder::MapTileEncoder(uint32_t tile_size)
+: tile_size_(std::max<uint32_t>(1, tile_size)), sent_(false)
+{
+}
+
+void MapTileEncoder::reset()
+{
+  sent_ = false;
+  hashes_.clear();
+}
+
+bool MapTileEncoder::same_geometry_(const nav_msgs::msg::MapMetaData & info) const
+{
+  return info.width == info_.width && info.height == info_.height &&
+         info.resolution == info_.resolution && info.origin == info_.origin;
+}
+
+bool MapTileEncoder::encode(
+  const nav_msgs::msg::OccupancyGrid & grid,
+  cyberdogapp::MapTiles & tiles)
+{
+  const uint32_t width = grid.info.width;
+  const uint32_t height = grid.info.height;
+  if (grid.data.size() != static_cast<size_t>(width) * height) {
+    return false;
+  }
+  const uint32_t tiles_x = (width + tile_size_ - 1) / tile_size_;
+  const uint32_t tiles_y = (height + tile_size_ - 1) / tile_size_;
+  const bool full = !sent_ || !same_geometry_(grid.info);
+  if (full) {
+    info_ = grid.info;
+    hashes_.assign(static_cast<size_t>(tiles_x) * tiles_y, 0);
+  }
+  tiles.set_tile_size(tile_size_);
+  tiles.set_full(full);
+
+  std::vector<int8_t> cells;
+  cells.reserve(static_cast<size_t>(tile_size_) * tile_size_);
+  for (uint32_t ty = 0; ty < tiles_y; ty++) {
+    for (uint32_t tx = 0; tx < tiles_x; tx++) {
+      const uint32_t x0 = tx * tile_size_;
+      const uint32_t y0 = ty * tile_size_;
+      const uint32_t w = std::min(tile_size_, width - x0);
+      const uint32_t h = std::min(tile_size_, height - y0);
+      cells.clear();
+      uint64_t hash = FNV_OFFSET;
+      for (uint32_t y = y0; y < y0 + h; y++) {
+        auto row = grid.data.data() + static_cast<size_t>(y) * width + x0;
+        cells.insert(cells.end(), row, row + w);
+        for (uint32_t x = 0; x < w; x++) {
+          hash = (hash ^ static_cast<uint8_t>(row[x])) * FNV_PRIME;
+        }
+      }
+      const uint32_t index = ty * tiles_x + tx;
+      if (!full && hashes_[index] == hash) {
+        continue;
+      }
+      hashes_[index] = hash;
+      auto tile = tiles.add_tiles();
+      tile->set_index(index);
+      tile->set_hash(hash);
+      rle_encode(cells.data(), cells.size(), *tile->mutable_data());
+    }
+  }
+  sent_ = true;
+  return true;
+}
+
+void MapTileEncoder::rle_encode(const int8_t * cells, size_t count, std::string & out)
+{
+  out.clear();
+  size_t i = 0;
+  while (i < count) {
+    const int8_t value = cells[i];
+    size_t run = 1;
+    while (i + run < count && run < RLE_MAX_RUN && cells[i + run] == value) {
+      run++;
+    }
+    out.push_back(static_cast<char>(run));
+    out.push_back(static_cast<char>(value));
+    i += run;
+  }
+}
+
+bool MapTileEncoder::rle_decode(const std::string & in, std::vector<int8_t> & cells)
+{
+  cells.clear();
+  if (in.size() % 2) {
+    return false;
+  }
+  for (size_t i = 0; i < in.size(); i += 2) {
+    const auto run = static_cast<uint8_t>(in[i]);
+    if (run == 0) {
+      return false;
+    }
+    cells.insert(cells.end(), run, static_cast<int8_t>(in[i + 1]));
+  }
+  return true;
+}
@@ -0,0 +1,324 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "net_avalible.hpp"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#define PROBE_PERIOD_SECONDS 1
+#define PROBE_WINDOW 10
+#define RTT_SMOOTHING 0.2
+
+namespace
+{
+uint16_t icmp_checksum(const void * data, size_t len)
+{
+  auto bytes = static_cast<const uint8_t *>(data);
+  uint32_t sum = 0;
+  for (size_t i = 0; i + 1 < len; i += 2) {
+    sum += (bytes[i] << 8) | bytes[i + 1];
+  }
+  if (len % 2) {
+    sum += bytes[len - 1] << 8;
+  }
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return htons(static_cast<uint16_t>(~sum));
+}
+}  // namespace
+
+NetChecker::NetChecker()
+: thread_(nullptr), need_run_(true), port_(0), ip_changed_(false), tcp_port_(0),
+  need_ping(false), type_(PROBE_TCP), probe_fd_(-1), seq_(0), probe_pending_(false)
+{
+  std::memset(&target_, 0, sizeof(target_));
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = timer_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event);
+  event.data.fd = wake_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+}
+
+NetChecker::~NetChecker()
+{
+  need_run_ = false;
+  uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0) {
+    std::cout << "NetChecker failed to wake checker" << std::endl;
+  }
+  if (thread_ != nullptr) {
+    thread_->join();
+  }
+  close_probe_fd_();
+  close(wake_fd_);
+  close(timer_fd_);
+  close(epoll_fd_);
+}
+
+void NetChecker::pause()
+{
+  set_ip("", 0);
+}
+
+void NetChecker::set_ip(std::string ip, uint16_t tcp_port)
+{
+  {
+    std::lock_guard<std::mutex> lk(ip_mutex_);
+    if (ip == ip_ && tcp_port == port_) {
+      return;
+    }
+    ip_ = ip;
+    port_ = tcp_port;
+    ip_changed_ = true;
+  }
+  run();
+  uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0) {
+    std::cout << "NetChecker failed to wake checker" << std::endl;
+  }
+}
+
+NetStats NetChecker::stats()
+{
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  return stats_;
+}
+
+void NetChecker::run()
+{
+  if (thread_ == nullptr) {
+    thread_ = std::make_shared<std::thread>(&NetChecker::run_, this);
+  }
+}
+
+void NetChecker::run_()
+{
+  struct epoll_event events[4];
+  while (need_run_) {
+    int count = epoll_wait(epoll_fd_, events, 4, -1);
+    if (count < 0 && errno != EINTR) {
+      std::cout << "NetChecker epoll_wait failed: " << strerror(errno) << std::endl;
+      return;
+    }
+    for (int i = 0; i < count && need_run_; i++) {
+      uint64_t value;
+      if (events[i].data.fd == wake_fd_) {
+        if (read(wake_fd_, &value, sizeof(value)) < 0) {
+          continue;
+        }
+        std::string ip;
+        {
+          std::lock_guard<std::mutex> lk(ip_mutex_);
+          if (!ip_changed_) {
+            continue;
+          }
+          ip_changed_ = false;
+          ip = ip_;
+          tcp_port_ = port_;
+        }
+        close_probe_fd_();
+        probe_pending_ = false;
+        window_.clear();
+        {
+          std::lock_guard<std::mutex> lk(stats_mutex_);
+          stats_ = NetStats();
+        }
+        target_.sin_family = AF_INET;
+        need_ping = !ip.empty() && inet_pton(AF_INET, ip.c_str(), &target_.sin_addr) == 1;
+        if (!ip.empty() && !need_ping) {
+          std::cout << "NetChecker invalid ip: " << ip << std::endl;
+        }
+        if (need_ping) {
+          open_icmp_();
+        }
+        // First probe right away, then every period; all zero disarms
+        struct itimerspec spec;
+        std::memset(&spec, 0, sizeof(spec));
+        if (need_ping) {
+          spec.it_value.tv_nsec = 1;
+          spec.it_interval.tv_sec = PROBE_PERIOD_SECONDS;
+        }
+        timerfd_settime(timer_fd_, 0, &spec, nullptr);
+      } else if (events[i].data.fd == timer_fd_) {
+        if (read(timer_fd_, &value, sizeof(value)) < 0 || !need_ping) {
+          continue;
+        }
+        if (probe_pending_) {
+          finish_probe_(false);
+        }
+        send_probe_();
+      } else if (events[i].data.fd == probe_fd_) {
+        on_probe_event_();
+      }
+    }
+  }
+}
+
+bool NetChecker::open_icmp_()
+{
+  // Datagram ICMP needs the group in net.ipv4.ping_group_range, raw needs root
+  probe_fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+  type_ = PROBE_ICMP_DGRAM;
+  if (probe_fd_ < 0) {
+    probe_fd_ = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+    type_ = PROBE_ICMP_RAW;
+  }
+  if (probe_fd_ < 0) {
+    type_ = PROBE_TCP;
+    return false;
+  }
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = probe_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, probe_fd_, &event);
+  return true;
+}
+
+void NetChecker::send_probe_()
+{
+  probe_pending_ = true;
+  probe_time_ = std::chrono::steady_clock::now();
+  seq_++;
+  if (type_ != PROBE_TCP) {
+    struct icmphdr request;
+    std::memset(&request, 0, sizeof(request));
+    request.type = ICMP_ECHO;
+    request.un.echo.id = htons(static_cast<uint16_t>(getpid()));
+    request.un.echo.sequence = htons(seq_);
+    request.checksum = icmp_checksum(&request, sizeof(request));
+    if (sendto(
+        probe_fd_, &request, sizeof(request), 0,
+        reinterpret_cast<struct sockaddr *>(&target_), sizeof(target_)) < 0)
+    {
+      finish_probe_(false);
+    }
+    return;
+  }
+  struct sockaddr_in address = target_;
+  address.sin_port = htons(tcp_port_);
+  probe_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (probe_fd_ < 0) {
+    finish_probe_(false);
+    return;
+  }
+  if (connect(probe_fd_, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0 ||
+    errno == ECONNREFUSED)
+  {
+    finish_probe_(true);
+    return;
+  }
+  if (errno != EINPROGRESS) {
+    finish_probe_(false);
+    return;
+  }
+  struct epoll_event event;
+  event.events = EPOLLOUT;
+  event.data.fd = probe_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, probe_fd_, &event);
+}
+
+void NetChecker::on_probe_event_()
+{
+  if (type_ == PROBE_TCP) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    getsockopt(probe_fd_, SOL_SOCKET, SO_ERROR, &error, &len);
+    // Refused still means the app host answered
+    finish_probe_(error == 0 || error == ECONNREFUSED);
+    return;
+  }
+  uint8_t buf[1500];
+  struct sockaddr_in from;
+  socklen_t from_len = sizeof(from);
+  ssize_t len;
+  while ((len = recvfrom(
+      probe_fd_, buf, sizeof(buf), 0,
+      reinterpret_cast<struct sockaddr *>(&from), &from_len)) > 0)
+  {
+    size_t offset = 0;
+    if (type_ == PROBE_ICMP_RAW) {
+      // Raw socket gets the IP header too, and replies to every process
+      offset = (buf[0] & 0x0f) * 4;
+    }
+    if (static_cast<size_t>(len) < offset + sizeof(struct icmphdr) ||
+      from.sin_addr.s_addr != target_.sin_addr.s_addr)
+    {
+      continue;
+    }
+    struct icmphdr reply;
+    std::memcpy(&reply, buf + offset, sizeof(reply));
+    if (reply.type != ICMP_ECHOREPLY || ntohs(reply.un.echo.sequence) != seq_ ||
+      (type_ == PROBE_ICMP_RAW && reply.un.echo.id != htons(static_cast<uint16_t>(getpid()))))
+    {
+      continue;
+    }
+    if (probe_pending_) {
+      finish_probe_(true);
+    }
+  }
+}
+
+void NetChecker::finish_probe_(bool answered)
+{
+  probe_pending_ = false;
+  if (type_ == PROBE_TCP) {
+    close_probe_fd_();
+  }
+  window_.push_back(answered);
+  if (window_.size() > PROBE_WINDOW) {
+    window_.pop_front();
+  }
+  size_t lost = 0;
+  for (auto ok : window_) {
+    lost += ok ? 0 : 1;
+  }
+  double rtt_ms = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - probe_time_).count();
+
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  stats_.sent++;
+  stats_.reachable = answered;
+  stats_.loss = static_cast<double>(lost) / window_.size();
+  if (answered) {
+    stats_.rtt_avg_ms = stats_.received == 0 ? rtt_ms :
+      stats_.rtt_avg_ms + RTT_SMOOTHING * (rtt_ms - stats_.rtt_avg_ms);
+    stats_.rtt_ms = rtt_ms;
+    stats_.received++;
+  }
+}
+
+void NetChecker::close_probe_fd_()
+{
+  if (probe_fd_ >= 0) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, probe_fd_, nullptr);
+    close(probe_fd_);
+    probe_fd_ = -1;
+  }
+}
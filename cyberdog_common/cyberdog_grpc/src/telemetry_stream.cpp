@@ -0,0 +1,167 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "telemetry_stream.hpp"
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Unary calls are used meanwhile
+#define STREAM_RETRY_SECONDS 1
+
+TelemetryStream::TelemetryStream(cyberdogapp::CyberdogApp::Stub * stub)
+: stub_(stub), confirmed_(false),
+  write_deadline_(std::chrono::steady_clock::time_point::max()), watchdog_stop_(false),
+  supported_(true), canceled_(false), written_(0), timeouts_(0)
+{
+  watchdog_thread_ = std::thread(&TelemetryStream::watchdog_, this);
+}
+
+TelemetryStream::~TelemetryStream()
+{
+  cancel();
+  {
+    std::lock_guard<std::mutex> lk(watchdog_mutex_);
+    watchdog_stop_ = true;
+  }
+  watchdog_cv_.notify_all();
+  watchdog_thread_.join();
+  std::lock_guard<std::mutex> lk(write_mutex_);
+  close_();
+}
+
+bool TelemetryStream::write(
+  const cyberdogapp::Telemetry & msg, std::vector<cyberdogapp::Telemetry> & unconfirmed)
+{
+  if (!supported_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(write_mutex_);
+  if (canceled_) {
+    // Client is going away, drop it
+    return true;
+  }
+  if (writer_ == nullptr && !open_()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> watchdog_lk(watchdog_mutex_);
+    write_deadline_ = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(STREAM_WRITE_TIMEOUT_MS);
+  }
+  watchdog_cv_.notify_all();
+  bool written = writer_->Write(msg);
+  {
+    std::lock_guard<std::mutex> watchdog_lk(watchdog_mutex_);
+    write_deadline_ = std::chrono::steady_clock::time_point::max();
+  }
+  if (written) {
+    written_++;
+    if (!confirmed_) {
+      // App not implementing streamTelemetry answers within a round trip
+      if (std::chrono::steady_clock::now() - open_time_ >=
+        std::chrono::milliseconds(STREAM_WRITE_TIMEOUT_MS))
+      {
+        confirmed_ = true;
+        unconfirmed_.clear();
+      } else {
+        unconfirmed_[msg.payload_case()] = msg;
+      }
+    }
+    return true;
+  }
+  // App not implementing streamTelemetry may take the first messages before
+  // the stream ends, it processed none of them, they come back as unconfirmed.
+  // On any other failure the app may have them already, resending would repeat
+  // events and put older state after newer.
+  close_();
+  if (!supported_) {
+    for (auto & pending : unconfirmed_) {
+      if (pending.first != msg.payload_case()) {
+        unconfirmed.push_back(std::move(pending.second));
+      }
+    }
+  }
+  unconfirmed_.clear();
+  return false;
+}
+
+void TelemetryStream::cancel()
+{
+  canceled_ = true;
+  std::lock_guard<std::mutex> lk(context_mutex_);
+  if (context_ != nullptr) {
+    context_->TryCancel();
+  }
+}
+
+bool TelemetryStream::open_()
+{
+  if (std::chrono::steady_clock::now() < retry_time_) {
+    return false;
+  }
+  // No deadline, stream lives until app or client goes away
+  auto context = std::make_shared<grpc::ClientContext>();
+  {
+    std::lock_guard<std::mutex> lk(context_mutex_);
+    if (canceled_) {
+      return false;
+    }
+    context_ = context;
+  }
+  unconfirmed_.clear();
+  open_time_ = std::chrono::steady_clock::now();
+  writer_ = stub_->streamTelemetry(context.get(), &result_);
+  return writer_ != nullptr;
+}
+
+void TelemetryStream::close_()
+{
+  if (writer_ != nullptr) {
+    writer_->WritesDone();
+    grpc::Status status = writer_->Finish();
+    writer_.reset();
+    if (status.error_code() == grpc::StatusCode::UNIMPLEMENTED) {
+      supported_ = false;
+      std::cout << "streamTelemetry is not implemented by app, use unary calls" << std::endl;
+    } else if (!canceled_) {
+      std::cout << "streamTelemetry closed, error code: " << status.error_code() << std::endl;
+    }
+    retry_time_ = std::chrono::steady_clock::now() + std::chrono::seconds(STREAM_RETRY_SECONDS);
+  }
+  std::lock_guard<std::mutex> lk(context_mutex_);
+  context_.reset();
+}
+
+void TelemetryStream::watchdog_()
+{
+  std::unique_lock<std::mutex> lk(watchdog_mutex_);
+  while (!watchdog_stop_) {
+    if (write_deadline_ == std::chrono::steady_clock::time_point::max()) {
+      watchdog_cv_.wait(lk);
+    } else if (std::chrono::steady_clock::now() >= write_deadline_) {
+      // Blocked write returns false and the stream is reopened later
+      write_deadline_ = std::chrono::steady_clock::time_point::max();
+      timeouts_++;
+      std::cout << "streamTelemetry write timed out, app does not read" << std::endl;
+      std::lock_guard<std::mutex> context_lk(context_mutex_);
+      if (context_ != nullptr) {
+        context_->TryCancel();
+      }
+    } else {
+      watchdog_cv_.wait_until(lk, write_deadline_);
+    }
+  }
+}
@@ -0,0 +1,586 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Load and latency of the app bridge without a phone. Cyberdog_app runs in
+// this process and connects to a fake app on a local port, while synthetic
+// status, odometry, map, path and bms are published at the given rates.
+// Each message carries its sequence number, latency is publish -> fake app
+// received. Published minus received counts the messages the node filters
+// on purpose as well as those dropped on the way. CPU is per thread of the
+// process over the load phase, in percent of one core.
+// Transport stream uses streamTelemetry, unary makes the fake app refuse it
+// so the bridge falls back to the subscribe* calls. App delay makes the fake
+// app slow down every message it takes.
+//
+// Usage: app_bridge_bench [seconds] [stream|unary] [status_hz] [odom_hz] [map_hz]
+//   [path_hz] [bms_hz] [app_delay_ms] [--ros-args -p async_window:=4]
+
+#include <dirent.h>
+#include <grpcpp/server_builder.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cyberdog_app.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Sizes as seen on the robot
+#define BENCH_MAP_WIDTH 400
+#define BENCH_MAP_HEIGHT 400
+#define BENCH_PATH_POSES 500
+// Bms carries only the low byte of its sequence number
+#define BENCH_BMS_SEQ_MASK 0xff
+#define BENCH_CONNECT_TIMEOUT_SECONDS 10
+
+enum Topic
+{
+  TOPIC_STATUS = 0,
+  TOPIC_ODOM = 1,
+  TOPIC_MAP = 2,
+  TOPIC_PATH = 3,
+  TOPIC_BMS = 4,
+  TOPIC_COUNT = 5
+};
+
+const char * TOPIC_NAMES[TOPIC_COUNT] = {"status", "odometry", "map", "path", "bms"};
+
+int64_t steady_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Publish time of every message of a topic and latency of the
+ * received ones, received may be called from any thread
+ */
+class TopicRecord
+{
+public:
+  void reset(int rate_hz, int seconds)
+  {
+    rate_hz_ = rate_hz;
+    capacity_ = static_cast<uint64_t>(rate_hz) * seconds + 1;
+    sent_ns_.reset(new std::atomic<int64_t>[capacity_]);
+    for (uint64_t i = 0; i < capacity_; i++) {
+      sent_ns_[i].store(0);
+    }
+    published_ = 0;
+  }
+
+  // Next sequence number, or false when the run is over for the topic
+  bool next(uint64_t & seq)
+  {
+    seq = published_.load();
+    return seq < capacity_;
+  }
+
+  void sent(uint64_t seq)
+  {
+    sent_ns_[seq].store(steady_ns());
+    published_ = seq + 1;
+  }
+
+  void received(uint64_t seq)
+  {
+    auto now = steady_ns();
+    if (seq >= capacity_ || sent_ns_[seq].load() == 0) {
+      unknown_++;
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    latency_us_.push_back((now - sent_ns_[seq].load()) * 1e-3);
+  }
+
+  // Latest sequence number with the given low bits
+  uint64_t expand(uint64_t low, uint64_t mask) const
+  {
+    uint64_t published = published_.load();
+    if (published == 0) {
+      return capacity_;
+    }
+    return (published - 1) - (((published - 1) - low) & mask);
+  }
+
+  int rate_hz() const {return rate_hz_;}
+  uint64_t published() const {return published_;}
+  uint64_t unknown() const {return unknown_;}
+  std::vector<double> latency()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latency_us_;
+  }
+
+private:
+  int rate_hz_;
+  uint64_t capacity_;
+  std::unique_ptr<std::atomic<int64_t>[]> sent_ns_;
+  std::atomic<uint64_t> published_;
+  std::atomic<uint64_t> unknown_{0};
+  std::mutex mutex_;
+  std::vector<double> latency_us_;
+};
+
+TopicRecord records[TOPIC_COUNT];
+
+/**
+ * @brief Phone side of the bridge, takes telemetry and heartbeats only
+ */
+class FakeApp final : public cyberdogapp::CyberdogApp::Service
+{
+public:
+  FakeApp(bool stream, int delay_ms)
+  : stream_(stream), delay_(delay_ms), heartbeats_(0) {}
+
+  uint64_t heartbeats() const {return heartbeats_;}
+
+  grpc::Status heartbeat(
+    grpc::ServerContext *, const cyberdogapp::Ticks *, cyberdogapp::Result *) override
+  {
+    heartbeats_++;
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribeStatus(
+    grpc::ServerContext *, const cyberdogapp::StatusStamped * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribeOdomOut(
+    grpc::ServerContext *, const cyberdogapp::Odometry * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribeMap(
+    grpc::ServerContext *, const cyberdogapp::OccupancyGrid * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribeMapTiles(
+    grpc::ServerContext *, const cyberdogapp::MapTiles * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribePath(
+    grpc::ServerContext *, const cyberdogapp::Path * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribeBms(
+    grpc::ServerContext *, const cyberdogapp::Bms * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status streamTelemetry(
+    grpc::ServerContext *, grpc::ServerReader<cyberdogapp::Telemetry> * reader,
+    cyberdogapp::Result *) override
+  {
+    if (!stream_) {
+      return grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "unary only");
+    }
+    cyberdogapp::Telemetry telemetry;
+    while (reader->Read(&telemetry)) {
+      switch (telemetry.payload_case()) {
+        case cyberdogapp::Telemetry::kStatus:
+          take_(telemetry.status());
+          break;
+        case cyberdogapp::Telemetry::kOdomOut:
+          take_(telemetry.odom_out());
+          break;
+        case cyberdogapp::Telemetry::kMap:
+          take_(telemetry.map());
+          break;
+        case cyberdogapp::Telemetry::kPath:
+          take_(telemetry.path());
+          break;
+        case cyberdogapp::Telemetry::kBms:
+          take_(telemetry.bms());
+          break;
+        default:
+          break;
+      }
+    }
+    return grpc::Status::OK;
+  }
+
+private:
+  void take_(const cyberdogapp::StatusStamped & msg)
+  {
+    received_(TOPIC_STATUS, msg.status().pose().pose().position().x());
+  }
+  void take_(const cyberdogapp::Odometry & msg)
+  {
+    received_(TOPIC_ODOM, msg.header().stamp().sec());
+  }
+  void take_(const cyberdogapp::OccupancyGrid & msg)
+  {
+    received_(TOPIC_MAP, msg.header().stamp().sec());
+  }
+  void take_(const cyberdogapp::MapTiles & msg)
+  {
+    received_(TOPIC_MAP, msg.header().stamp().sec());
+  }
+  void take_(const cyberdogapp::Path & msg)
+  {
+    received_(TOPIC_PATH, msg.header().stamp().sec());
+  }
+  void take_(const cyberdogapp::Bms & msg)
+  {
+    received_(TOPIC_BMS, records[TOPIC_BMS].expand(msg.status(), BENCH_BMS_SEQ_MASK));
+  }
+
+  void received_(Topic topic, uint64_t seq)
+  {
+    records[topic].received(seq);
+    if (delay_.count() > 0) {
+      std::this_thread::sleep_for(delay_);
+    }
+  }
+
+  bool stream_;
+  std::chrono::milliseconds delay_;
+  std::atomic<uint64_t> heartbeats_;
+};
+
+/**
+ * @brief Publishes all topics at their rates until each has sent its share
+ */
+class LoadNode : public rclcpp::Node
+{
+public:
+  LoadNode()
+  : Node("app_bridge_bench")
+  {
+    ip_pub_ = create_publisher<std_msgs::msg::String>("ip_notify", rclcpp::SystemDefaultsQoS());
+    status_pub_ = create_publisher<ControlState_T>("status_out", rclcpp::SystemDefaultsQoS());
+    odom_pub_ = create_publisher<nav_msgs::msg::Odometry>("odom_out", rclcpp::SystemDefaultsQoS());
+    map_pub_ = create_publisher<nav_msgs::msg::OccupancyGrid>("map", 1);
+    path_pub_ = create_publisher<nav_msgs::msg::Path>("plan", rclcpp::SystemDefaultsQoS());
+    bms_pub_ = create_publisher<ception_msgs::msg::Bms>("bms_recv", rclcpp::SystemDefaultsQoS());
+
+    odom_.header.frame_id = "odom";
+    odom_.child_frame_id = "base_link";
+    odom_.pose.pose.orientation.w = 1.0;
+    map_.header.frame_id = "map";
+    map_.info.resolution = 0.05f;
+    map_.info.width = BENCH_MAP_WIDTH;
+    map_.info.height = BENCH_MAP_HEIGHT;
+    map_.data.assign(BENCH_MAP_WIDTH * BENCH_MAP_HEIGHT, -1);
+    path_.header.frame_id = "map";
+    path_.poses.resize(BENCH_PATH_POSES);
+    for (size_t i = 0; i < path_.poses.size(); i++) {
+      path_.poses[i].header.frame_id = "map";
+      path_.poses[i].pose.position.x = 0.1 * i;
+      path_.poses[i].pose.orientation.w = 1.0;
+    }
+    bms_.batt_soc = 80;
+  }
+
+  void notify_ip(const std::string & ip)
+  {
+    std_msgs::msg::String msg;
+    // phone ip:dog ip
+    msg.data = ip + ":" + ip;
+    ip_pub_->publish(msg);
+  }
+
+  void run()
+  {
+    Clock::time_point next[TOPIC_COUNT];
+    std::chrono::nanoseconds period[TOPIC_COUNT];
+    auto start = Clock::now();
+    for (int i = 0; i < TOPIC_COUNT; i++) {
+      next[i] = start;
+      period[i] = std::chrono::nanoseconds(1000000000 / std::max(1, records[i].rate_hz()));
+    }
+    while (rclcpp::ok()) {
+      int topic(-1);
+      uint64_t seq(0);
+      for (int i = 0; i < TOPIC_COUNT; i++) {
+        uint64_t candidate;
+        if (records[i].rate_hz() > 0 && records[i].next(candidate) &&
+          (topic < 0 || next[i] < next[topic]))
+        {
+          topic = i;
+          seq = candidate;
+        }
+      }
+      if (topic < 0) {
+        return;
+      }
+      std::this_thread::sleep_until(next[topic]);
+      next[topic] += period[topic];
+      publish_(static_cast<Topic>(topic), seq);
+    }
+  }
+
+private:
+  void publish_(Topic topic, uint64_t seq)
+  {
+    records[topic].sent(seq);
+    switch (topic) {
+      case TOPIC_STATUS:
+        status_.posestamped.position_x = seq;
+        status_pub_->publish(status_);
+        break;
+      case TOPIC_ODOM:
+        odom_.header.stamp.sec = seq;
+        odom_.pose.pose.position.x = 0.01 * seq;
+        odom_pub_->publish(odom_);
+        break;
+      case TOPIC_MAP:
+        {
+          // Mapping uncovers a few rows per update
+          map_.header.stamp.sec = seq;
+          auto row = (seq % BENCH_MAP_HEIGHT) * BENCH_MAP_WIDTH;
+          for (size_t i = 0; i < BENCH_MAP_WIDTH; i++) {
+            map_.data[row + i] = i % 7 == 0 ? 100 : 0;
+          }
+          map_pub_->publish(map_);
+          break;
+        }
+      case TOPIC_PATH:
+        path_.header.stamp.sec = seq;
+        path_pub_->publish(path_);
+        break;
+      case TOPIC_BMS:
+        bms_.status = seq & BENCH_BMS_SEQ_MASK;
+        bms_pub_->publish(bms_);
+        break;
+      default:
+        break;
+    }
+  }
+
+  rclcpp::Publisher<std_msgs::msg::String>::SharedPtr ip_pub_;
+  rclcpp::Publisher<ControlState_T>::SharedPtr status_pub_;
+  rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr odom_pub_;
+  rclcpp::Publisher<nav_msgs::msg::OccupancyGrid>::SharedPtr map_pub_;
+  rclcpp::Publisher<nav_msgs::msg::Path>::SharedPtr path_pub_;
+  rclcpp::Publisher<ception_msgs::msg::Bms>::SharedPtr bms_pub_;
+  ControlState_T status_;
+  nav_msgs::msg::Odometry odom_;
+  nav_msgs::msg::OccupancyGrid map_;
+  nav_msgs::msg::Path path_;
+  ception_msgs::msg::Bms bms_;
+};
+
+struct ThreadCpu
+{
+  std::string name;
+  double seconds;
+};
+
+/**
+ * @brief User + system time of every thread of the process, by thread id
+ */
+std::map<int, ThreadCpu> thread_cpu()
+{
+  std::map<int, ThreadCpu> threads;
+  auto ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+  DIR * dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return threads;
+  }
+  while (auto entry = readdir(dir)) {
+    int tid = std::atoi(entry->d_name);
+    if (tid <= 0) {
+      continue;
+    }
+    std::ifstream stat_file("/proc/self/task/" + std::string(entry->d_name) + "/stat");
+    std::string line;
+    if (!std::getline(stat_file, line)) {
+      continue;
+    }
+    // Name may hold spaces, fields after it start with state
+    auto open = line.find('(');
+    auto close = line.rfind(')');
+    if (open == std::string::npos || close == std::string::npos) {
+      continue;
+    }
+    std::istringstream fields(line.substr(close + 2));
+    std::vector<std::string> values;
+    std::string value;
+    while (fields >> value && values.size() < 13) {
+      values.push_back(value);
+    }
+    if (values.size() < 13) {
+      continue;
+    }
+    threads[tid] = ThreadCpu{line.substr(open + 1, close - open - 1),
+      (std::atof(values[11].c_str()) + std::atof(values[12].c_str())) / ticks};
+  }
+  closedir(dir);
+  return threads;
+}
+
+void report_topic(Topic topic, double seconds)
+{
+  auto & record = records[topic];
+  if (record.rate_hz() <= 0) {
+    return;
+  }
+  auto latency = record.latency();
+  std::printf(
+    "== %s, %d Hz\n  published %lu, received %zu (%.1f Hz), not received %lu\n",
+    TOPIC_NAMES[topic], record.rate_hz(), record.published(), latency.size(),
+    latency.size() / seconds,
+    record.published() - std::min<uint64_t>(record.published(), latency.size()));
+  if (record.unknown() > 0) {
+    std::printf("  %lu received with unknown sequence\n", record.unknown());
+  }
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    auto pick = [&latency](double q) {
+        return latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+      };
+    std::printf(
+      "  latency publish -> app ms: p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+      pick(0.5) * 1e-3, pick(0.9) * 1e-3, pick(0.99) * 1e-3, latency.back() * 1e-3);
+  }
+}
+
+void report_cpu(
+  const std::map<int, ThreadCpu> & start, const std::map<int, ThreadCpu> & end, double seconds)
+{
+  std::vector<std::pair<double, std::string>> used;
+  double total(0);
+  for (const auto & thread : end) {
+    auto found = start.find(thread.first);
+    auto delta = thread.second.seconds - (found == start.end() ? 0 : found->second.seconds);
+    total += delta;
+    if (delta > 0) {
+      used.emplace_back(
+        delta, std::to_string(thread.first) + " " + thread.second.name);
+    }
+  }
+  std::sort(used.rbegin(), used.rend());
+  std::printf("== cpu %% of one core, %.1f total\n", total * 100 / seconds);
+  for (const auto & thread : used) {
+    std::printf("  %6.1f  %s\n", thread.first * 100 / seconds, thread.second.c_str());
+  }
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  auto args = rclcpp::init_and_remove_ros_arguments(argc, argv);
+  auto arg = [&args](size_t i, int fallback) {
+      return args.size() > i ? std::max(0, std::atoi(args[i].c_str())) : fallback;
+    };
+  auto seconds = std::max(1, arg(1, 10));
+  bool stream = args.size() <= 2 || args[2] != "unary";
+  int rates[TOPIC_COUNT] = {arg(3, 50), arg(4, 50), arg(5, 1), arg(6, 2), arg(7, 1)};
+  auto delay_ms = arg(8, 0);
+  for (int i = 0; i < TOPIC_COUNT; i++) {
+    records[i].reset(rates[i], seconds);
+  }
+
+  FakeApp app(stream, delay_ms);
+  int app_port(0);
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &app_port);
+  builder.RegisterService(&app);
+  auto server = builder.BuildAndStart();
+  if (server == nullptr || app_port == 0) {
+    std::printf("can not start fake app\n");
+    return 1;
+  }
+
+  rclcpp::NodeOptions options;
+  options.parameter_overrides(
+    {rclcpp::Parameter("app_port", app_port), rclcpp::Parameter("server_port", 0)});
+  auto bridge = std::make_shared<cyberdog_cyberdog_app::Cyberdog_app>(options);
+  auto load = std::make_shared<LoadNode>();
+  rclcpp::executors::MultiThreadedExecutor exec;
+  exec.add_node(bridge);
+  exec.add_node(load);
+  std::thread spin([&exec]() {exec.spin();});
+
+  // Bridge is connected once the fake app gets its heartbeat
+  auto connect_deadline = Clock::now() + std::chrono::seconds(BENCH_CONNECT_TIMEOUT_SECONDS);
+  while (app.heartbeats() == 0 && Clock::now() < connect_deadline && rclcpp::ok()) {
+    load->notify_ip("127.0.0.1");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  if (app.heartbeats() == 0) {
+    std::printf("bridge did not connect to fake app on port %d\n", app_port);
+    std::fflush(stdout);
+    std::_Exit(1);
+  }
+
+  std::printf(
+    "%d s, %s, fake app on port %d, app delay %d ms\n", seconds,
+    stream ? "stream" : "unary", app_port, delay_ms);
+  auto cpu_start = thread_cpu();
+  auto start = Clock::now();
+  std::thread publisher(
+    [&load]() {
+      pthread_setname_np(pthread_self(), "bench_publish");
+      load->run();
+    });
+  publisher.join();
+  // Let queued messages drain before collecting
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  auto cpu_end = thread_cpu();
+
+  for (int i = 0; i < TOPIC_COUNT; i++) {
+    report_topic(static_cast<Topic>(i), elapsed);
+  }
+  report_cpu(cpu_start, cpu_end, elapsed);
+  std::fflush(stdout);
+
+  // Threads of the bridge node never end, leave without destructors
+  exec.cancel();
+  spin.join();
+  server->Shutdown();
+  rclcpp::shutdown();
+  std::_Exit(0);
+}
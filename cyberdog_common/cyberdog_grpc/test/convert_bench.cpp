@@ -0,0 +1,627 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cost of forwarding one message to the app, for every message type the
+// client sends. Each round converts a ROS message into Telemetry and
+// serializes it, the legacy rounds build sub-messages on their own and copy
+// them in as the client used to, the arena rounds fill in place through
+// app_msg::fill. Heap allocations are
+// counted by replacing global operator new.
+//
+// Usage: convert_bench [rounds]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "app_msg_convert.hpp"
+
+namespace
+{
+std::atomic<uint64_t> allocations(0);
+}  // namespace
+
+void * operator new(size_t size)
+{
+  allocations++;
+  void * ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void * ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Sizes as seen on the robot
+#define BENCH_MAP_WIDTH 400
+#define BENCH_MAP_HEIGHT 400
+#define BENCH_PATH_POSES 500
+#define BENCH_BODIES 3
+#define BENCH_FACE_JPEG_BYTES (60 * 1024)
+
+void legacy_header(cyberdogapp::Header & grpc_header, const std_msgs::msg::Header & std_header)
+{
+  cyberdogapp::Timestamp stamp;
+  stamp.set_sec(std_header.stamp.sec);
+  stamp.set_nanosec(std_header.stamp.nanosec);
+  grpc_header.mutable_stamp()->CopyFrom(stamp);
+  grpc_header.set_frame_id(std_header.frame_id);
+}
+
+void legacy_bms(const ception_msgs::msg::Bms & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Bms bms_send;
+  bms_send.set_batt_soc(msg.batt_soc);
+  bms_send.set_status(msg.status);
+  telemetry.mutable_bms()->Swap(&bms_send);
+}
+
+void legacy_rssi(const std_msgs::msg::String & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::WifiRssi rssi;
+  rssi.set_rssi(msg.data);
+  telemetry.mutable_wifi_rssi()->Swap(&rssi);
+}
+
+void legacy_status(const motion_msgs::msg::ControlState & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::StatusStamped status_send;
+  cyberdogapp::RawStatus rawstatus;
+  cyberdogapp::Mode mode;
+  cyberdogapp::Pattern pattern;
+  cyberdogapp::Pattern cached_pattern;
+  cyberdogapp::TwistWithCovariance twistC;
+  cyberdogapp::Twist twist;
+  cyberdogapp::Vector3 liner;
+  cyberdogapp::Vector3 anger;
+  cyberdogapp::PoseWithCovariance poseC;
+  cyberdogapp::Pose pose;
+  cyberdogapp::Point point;
+  cyberdogapp::Quaternion orientation;
+  cyberdogapp::Parameters parameter;
+  cyberdogapp::Safety safety;
+  cyberdogapp::Scene scene;
+  cyberdogapp::MonOrder order;
+  cyberdogapp::ErrorFlag error_flag;
+  mode.set_control_mode(msg.modestamped.control_mode);
+  mode.set_mode_type(msg.modestamped.mode_type);
+  rawstatus.mutable_mode()->CopyFrom(mode);
+  pattern.set_gait_pattern(msg.gaitstamped.gait);
+  cached_pattern.set_gait_pattern(msg.cached_gait.gait);
+  rawstatus.mutable_pattern()->CopyFrom(pattern);
+  rawstatus.mutable_cached_pattern()->CopyFrom(cached_pattern);
+  anger.set_x(msg.velocitystamped.angular_x);
+  anger.set_y(msg.velocitystamped.angular_y);
+  anger.set_z(msg.velocitystamped.angular_z);
+  liner.set_x(msg.velocitystamped.linear_x);
+  liner.set_y(msg.velocitystamped.linear_y);
+  liner.set_z(msg.velocitystamped.linear_z);
+  twist.mutable_angular()->CopyFrom(anger);
+  twist.mutable_linear()->CopyFrom(liner);
+  twistC.mutable_twist()->CopyFrom(twist);
+  rawstatus.mutable_twist()->CopyFrom(twistC);
+  point.set_x(msg.posestamped.position_x);
+  point.set_y(msg.posestamped.position_y);
+  point.set_z(msg.posestamped.position_z);
+  orientation.set_w(msg.posestamped.rotation_w);
+  orientation.set_x(msg.posestamped.rotation_x);
+  orientation.set_y(msg.posestamped.rotation_y);
+  orientation.set_z(msg.posestamped.rotation_z);
+  pose.mutable_position()->CopyFrom(point);
+  pose.mutable_orientation()->CopyFrom(orientation);
+  poseC.mutable_pose()->CopyFrom(pose);
+  rawstatus.mutable_pose()->CopyFrom(poseC);
+  parameter.set_body_height(msg.parastamped.body_height);
+  parameter.set_gait_height(msg.parastamped.gait_height);
+  rawstatus.mutable_para()->CopyFrom(parameter);
+  safety.set_status(msg.safety.status);
+  rawstatus.mutable_safety()->CopyFrom(safety);
+  scene.set_lat(msg.scene.lat);
+  scene.set_lon(msg.scene.lon);
+  scene.set_type(msg.scene.type);
+  rawstatus.mutable_scene()->CopyFrom(scene);
+  order.set_id(msg.orderstamped.id);
+  order.set_para(msg.orderstamped.para);
+  rawstatus.set_foot_contact(msg.foot_contact);
+  rawstatus.mutable_order()->CopyFrom(order);
+  error_flag.set_exist_error(msg.error_flag.exist_error);
+  error_flag.set_ori_error(msg.error_flag.ori_error);
+  error_flag.set_footpos_error(msg.error_flag.footpos_error);
+  int cnt = msg.error_flag.motor_error.size();
+  for (int i = 0; i < cnt; i++) {
+    error_flag.add_motor_error(msg.error_flag.motor_error[i]);
+  }
+  rawstatus.mutable_error_flag()->CopyFrom(error_flag);
+  status_send.mutable_status()->CopyFrom(rawstatus);
+  telemetry.mutable_status()->Swap(&status_send);
+}
+
+void legacy_tracking_status(
+  const automation_msgs::msg::TrackingStatus & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::TrackingStatus trackingstate;
+  trackingstate.set_status(msg.status);
+  telemetry.mutable_tracking_status()->Swap(&trackingstate);
+}
+
+void legacy_nav_status(const automation_msgs::msg::Caution & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Caution caution;
+  caution.set_error_type(msg.error_type);
+  caution.set_robot_mode(msg.robot_mode);
+  telemetry.mutable_nav_status()->Swap(&caution);
+}
+
+void legacy_body_info(const interaction_msgs::msg::BodyInfo & msg, cyberdogapp::BodyInfo & bodyinfo)
+{
+  bodyinfo.set_count(msg.count);
+  for (uint32_t i = 0; i < msg.count; ++i) {
+    cyberdogapp::Body * body = bodyinfo.add_infos();
+    cyberdogapp::RegionOfInterest roi;
+    roi.set_height(msg.infos[i].roi.height);
+    roi.set_width(msg.infos[i].roi.width);
+    roi.set_x_offset(msg.infos[i].roi.x_offset);
+    roi.set_y_offset(msg.infos[i].roi.y_offset);
+    roi.set_do_rectify(msg.infos[i].roi.do_rectify);
+    body->mutable_roi()->CopyFrom(roi);
+  }
+}
+
+void legacy_body_select(
+  const interaction_msgs::msg::BodyInfo & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::BodyInfo bodyinfo;
+  legacy_body_info(msg, bodyinfo);
+  telemetry.mutable_body_select()->Swap(&bodyinfo);
+}
+
+void legacy_tracking(const interaction_msgs::msg::BodyInfo & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::BodyInfo bodyinfo;
+  legacy_body_info(msg, bodyinfo);
+  telemetry.mutable_tracking()->Swap(&bodyinfo);
+}
+
+void legacy_position(
+  const motion_msgs::msg::SE3VelocityCMD & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::DecisionStamped decision_stamped;
+  cyberdogapp::Decissage decissage;
+  cyberdogapp::Twist twist;
+  cyberdogapp::Vector3 linear;
+  cyberdogapp::Vector3 angular;
+  linear.set_x(msg.velocity.linear_x);
+  linear.set_y(msg.velocity.linear_y);
+  linear.set_z(msg.velocity.linear_z);
+  angular.set_x(msg.velocity.angular_x);
+  angular.set_y(msg.velocity.angular_y);
+  angular.set_z(msg.velocity.angular_z);
+  twist.mutable_linear()->CopyFrom(linear);
+  twist.mutable_angular()->CopyFrom(angular);
+  decissage.mutable_twist()->CopyFrom(twist);
+  decision_stamped.mutable_decissage()->CopyFrom(decissage);
+  telemetry.mutable_position()->Swap(&decision_stamped);
+}
+
+void legacy_voiceprint(
+  const interaction_msgs::msg::VoiceprintResult & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Header header;
+  cyberdogapp::VoiceprintResult vpr;
+  legacy_header(header, msg.header);
+  vpr.mutable_header()->CopyFrom(header);
+  vpr.set_error(msg.error);
+  vpr.set_succeed(msg.succeed);
+  vpr.set_type(msg.type);
+  telemetry.mutable_voiceprint_result()->Swap(&vpr);
+}
+
+void legacy_face_result(
+  const interaction_msgs::msg::FaceResult & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::FaceResult faceresult;
+  faceresult.set_msg(msg.msg);
+  faceresult.set_result(msg.result);
+  std::vector<interaction_msgs::msg::CompressedImage> face_images = msg.face_images;
+  int cnt = face_images.size();
+  for (int i = 0; i < cnt; ++i) {
+    cyberdogapp::CompressedImage * img = faceresult.add_face_images();
+    cyberdogapp::Header header;
+    cyberdogapp::Timestamp time;
+    img->set_format(face_images[i].format);
+    time.set_sec(face_images[i].header.stamp.sec);
+    time.set_nanosec(face_images[i].header.stamp.nanosec);
+    header.set_frame_id(face_images[i].header.frame_id);
+    header.mutable_stamp()->CopyFrom(time);
+    img->mutable_header()->CopyFrom(header);
+    for (size_t j = 0; j < face_images[i].data.size(); j++) {
+      img->add_data(face_images[i].data[j]);
+    }
+  }
+  telemetry.mutable_face_result()->Swap(&faceresult);
+}
+
+void legacy_odometry(const nav_msgs::msg::Odometry & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Header header;
+  cyberdogapp::Odometry odo;
+  legacy_header(header, msg.header);
+  odo.set_child_frame_id(msg.child_frame_id);
+  odo.mutable_header()->CopyFrom(header);
+  cyberdogapp::PoseWithCovariance poseC;
+  cyberdogapp::Pose pose;
+  cyberdogapp::Quaternion orientation;
+  cyberdogapp::Point point;
+  point.set_x(msg.pose.pose.position.x);
+  point.set_y(msg.pose.pose.position.y);
+  point.set_z(msg.pose.pose.position.z);
+  orientation.set_w(msg.pose.pose.orientation.w);
+  orientation.set_x(msg.pose.pose.orientation.x);
+  orientation.set_y(msg.pose.pose.orientation.y);
+  orientation.set_z(msg.pose.pose.orientation.z);
+  pose.mutable_position()->CopyFrom(point);
+  pose.mutable_orientation()->CopyFrom(orientation);
+  poseC.mutable_pose()->CopyFrom(pose);
+  for (size_t i = 0; i < msg.pose.covariance.size(); i++) {
+    poseC.add_covariance(msg.pose.covariance[i]);
+  }
+  odo.mutable_pose()->CopyFrom(poseC);
+  cyberdogapp::TwistWithCovariance twistC;
+  cyberdogapp::Twist twist;
+  cyberdogapp::Vector3 liner;
+  cyberdogapp::Vector3 anger;
+  anger.set_x(msg.twist.twist.angular.x);
+  anger.set_y(msg.twist.twist.angular.y);
+  anger.set_z(msg.twist.twist.angular.z);
+  liner.set_x(msg.twist.twist.linear.x);
+  liner.set_y(msg.twist.twist.linear.y);
+  liner.set_z(msg.twist.twist.linear.z);
+  twist.mutable_angular()->CopyFrom(anger);
+  twist.mutable_linear()->CopyFrom(liner);
+  twistC.mutable_twist()->CopyFrom(twist);
+  for (size_t i = 0; i < msg.twist.covariance.size(); i++) {
+    twistC.add_covariance(msg.twist.covariance[i]);
+  }
+  odo.mutable_twist()->CopyFrom(twistC);
+  telemetry.mutable_odom_out()->Swap(&odo);
+}
+
+void legacy_obstacle(const ception_msgs::msg::Around & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Around around;
+  cyberdogapp::Ultrasonic ultrasoinc;
+  cyberdogapp::Range range;
+  cyberdogapp::Header header;
+  legacy_header(header, msg.front_distance.range_info.header);
+  range.mutable_header()->CopyFrom(header);
+  range.set_radiation_type(msg.front_distance.range_info.radiation_type);
+  range.set_field_of_view(msg.front_distance.range_info.field_of_view);
+  range.set_min_range(msg.front_distance.range_info.min_range);
+  range.set_max_range(msg.front_distance.range_info.max_range);
+  range.set_range(msg.front_distance.range_info.range);
+  ultrasoinc.mutable_range_info()->CopyFrom(range);
+  around.mutable_front_distance()->CopyFrom(ultrasoinc);
+  telemetry.mutable_obstacle_detection()->Swap(&around);
+}
+
+void legacy_dog_pose(const motion_msgs::msg::SE3Pose & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Freameid freameid;
+  cyberdogapp::DogPose dog_pose;
+  cyberdogapp::Timestamp timestamp;
+  freameid.set_id(msg.frameid.id);
+  timestamp.set_sec(msg.timestamp.sec);
+  timestamp.set_nanosec(msg.timestamp.nanosec);
+  dog_pose.set_position_x(msg.position_x);
+  dog_pose.set_position_y(msg.position_y);
+  dog_pose.set_position_z(msg.position_z);
+  dog_pose.set_rotation_w(msg.rotation_w);
+  dog_pose.set_rotation_x(msg.rotation_x);
+  dog_pose.set_rotation_y(msg.rotation_y);
+  dog_pose.set_rotation_z(msg.rotation_z);
+  dog_pose.mutable_timestamp()->CopyFrom(timestamp);
+  dog_pose.mutable_frameid()->CopyFrom(freameid);
+  telemetry.mutable_dog_pose()->Swap(&dog_pose);
+}
+
+void legacy_gps_scene(const motion_msgs::msg::Scene & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Scene scene;
+  scene.set_type(msg.type);
+  scene.set_lat(msg.lat);
+  scene.set_lon(msg.lon);
+  scene.set_if_danger(msg.if_danger);
+  telemetry.mutable_gps_scene()->Swap(&scene);
+}
+
+void legacy_remote_event(
+  const ception_msgs::msg::BtRemoteEvent & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::RemoteEvent event;
+  event.set_scan_status(msg.scan_status);
+  event.set_remote_status(msg.remote_status);
+  event.set_address(msg.address);
+  event.set_scan_device_info(msg.scan_device_info);
+  event.set_error(msg.error);
+  telemetry.mutable_remote_event()->Swap(&event);
+}
+
+void legacy_map(const nav_msgs::msg::OccupancyGrid & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::OccupancyGrid occupacy;
+  legacy_header(*occupacy.mutable_header(), msg.header);
+  auto info = occupacy.mutable_info();
+  info->set_resolution(msg.info.resolution);
+  info->set_width(msg.info.width);
+  info->set_height(msg.info.height);
+  int cnt = msg.data.size();
+  for (int i = 0; i < cnt; i++) {
+    occupacy.add_data(msg.data[i]);
+  }
+  telemetry.mutable_map()->Swap(&occupacy);
+}
+
+void legacy_path(const nav_msgs::msg::Path & msg, cyberdogapp::Telemetry & telemetry)
+{
+  cyberdogapp::Path path;
+  int cnt = msg.poses.size();
+  for (int i = 0; i < cnt; i++) {
+    cyberdogapp::Header header;
+    cyberdogapp::Point position;
+    cyberdogapp::Quaternion orientation;
+    cyberdogapp::Pose pose;
+    cyberdogapp::PoseStamped * posestamped = path.add_posestamped();
+    legacy_header(header, msg.poses[i].header);
+    position.set_x(msg.poses[i].pose.position.x);
+    position.set_y(msg.poses[i].pose.position.y);
+    position.set_z(msg.poses[i].pose.position.z);
+    orientation.set_w(msg.poses[i].pose.orientation.w);
+    orientation.set_x(msg.poses[i].pose.orientation.x);
+    orientation.set_y(msg.poses[i].pose.orientation.y);
+    orientation.set_z(msg.poses[i].pose.orientation.z);
+    pose.mutable_position()->CopyFrom(position);
+    pose.mutable_orientation()->CopyFrom(orientation);
+    posestamped->mutable_pose()->CopyFrom(pose);
+    posestamped->mutable_header()->CopyFrom(header);
+  }
+  telemetry.mutable_path()->Swap(&path);
+}
+
+/**
+ * @brief Run one conversion rounds times and print cost per message
+ */
+void run(
+  const std::string & name, const int rounds,
+  const std::function<void(std::string & out)> & convert)
+{
+  std::string out;
+  convert(out);  // warm up thread local arena and output buffer
+  auto allocations_start = allocations.load();
+  auto start = Clock::now();
+  size_t bytes(0);
+  for (int i = 0; i < rounds; i++) {
+    convert(out);
+    bytes += out.size();
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  std::printf(
+    "  %-20s %9.2f us/msg %8.1f allocs/msg %9zu bytes/msg\n", name.c_str(),
+    elapsed / rounds, double(allocations.load() - allocations_start) / rounds, bytes / rounds);
+}
+
+template<typename RosT, typename ProtoT>
+void run_arena(
+  const std::string & name, const int rounds, const RosT & msg,
+  ProtoT * (cyberdogapp::Telemetry::* mutable_field)())
+{
+  run(
+    name, rounds, [&msg, mutable_field](std::string & out) {
+      ConvertArena arena;
+      auto telemetry = arena.create<cyberdogapp::Telemetry>();
+      app_msg::fill(msg, (telemetry->*mutable_field)());
+      telemetry->SerializeToString(&out);
+    });
+}
+
+template<typename RosT>
+void run_legacy(
+  const std::string & name, const int rounds, const RosT & msg,
+  void (* legacy)(const RosT &, cyberdogapp::Telemetry &))
+{
+  run(
+    name, rounds, [&msg, legacy](std::string & out) {
+      cyberdogapp::Telemetry telemetry;
+      legacy(msg, telemetry);
+      telemetry.SerializeToString(&out);
+    });
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  auto rounds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+  ception_msgs::msg::Bms bms;
+  bms.batt_soc = 80;
+
+  std_msgs::msg::String rssi;
+  rssi.data = "-52";
+
+  motion_msgs::msg::ControlState status;
+  status.modestamped.control_mode = 3;
+  status.posestamped.rotation_w = 1.0;
+  status.parastamped.body_height = 0.28;
+  for (size_t i = 0; i < status.error_flag.motor_error.size(); i++) {
+    status.error_flag.motor_error[i] = i;
+  }
+
+  automation_msgs::msg::TrackingStatus tracking_status;
+  tracking_status.status = automation_msgs::msg::TrackingStatus::OBJECT_NEAR;
+
+  automation_msgs::msg::Caution caution;
+  caution.robot_mode = automation_msgs::msg::Caution::NAV_NORMAL;
+  caution.error_type = automation_msgs::msg::Caution::NO_ERROR;
+
+  interaction_msgs::msg::BodyInfo bodies;
+  bodies.count = BENCH_BODIES;
+  bodies.infos.resize(BENCH_BODIES);
+  for (size_t i = 0; i < bodies.infos.size(); i++) {
+    bodies.infos[i].roi.x_offset = 100 * i;
+    bodies.infos[i].roi.width = 80;
+    bodies.infos[i].roi.height = 240;
+  }
+
+  motion_msgs::msg::SE3VelocityCMD velocity;
+  velocity.velocity.linear_x = 0.5;
+  velocity.velocity.angular_z = 0.1;
+
+  interaction_msgs::msg::VoiceprintResult voiceprint;
+  voiceprint.header.frame_id = "voiceprint";
+  voiceprint.succeed = true;
+
+  interaction_msgs::msg::FaceResult face;
+  face.msg = "owner";
+  face.face_images.resize(1);
+  face.face_images[0].format = "jpeg";
+  face.face_images[0].data.resize(BENCH_FACE_JPEG_BYTES);
+  for (size_t i = 0; i < face.face_images[0].data.size(); i++) {
+    face.face_images[0].data[i] = static_cast<int8_t>(i * 31);
+  }
+
+  ception_msgs::msg::Around around;
+  around.front_distance.range_info.header.frame_id = "ultrasonic";
+  around.front_distance.range_info.max_range = 4.0f;
+  around.front_distance.range_info.range = 1.2f;
+
+  motion_msgs::msg::SE3Pose dog_pose;
+  dog_pose.rotation_w = 1.0;
+  dog_pose.position_x = 1.5;
+
+  motion_msgs::msg::Scene scene;
+  scene.type = motion_msgs::msg::Scene::OUTDOOR;
+  scene.lat = 39.9f;
+  scene.lon = 116.4f;
+
+  ception_msgs::msg::BtRemoteEvent remote_event;
+  remote_event.address = "00:11:22:33:44:55";
+  remote_event.scan_device_info = "remote";
+
+  nav_msgs::msg::Odometry odometry;
+  odometry.header.frame_id = "odom";
+  odometry.child_frame_id = "base_link";
+  odometry.pose.pose.orientation.w = 1.0;
+  for (size_t i = 0; i < odometry.pose.covariance.size(); i++) {
+    odometry.pose.covariance[i] = odometry.twist.covariance[i] = 0.01 * i;
+  }
+
+  nav_msgs::msg::OccupancyGrid map;
+  map.header.frame_id = "map";
+  map.info.resolution = 0.05f;
+  map.info.width = BENCH_MAP_WIDTH;
+  map.info.height = BENCH_MAP_HEIGHT;
+  map.data.resize(BENCH_MAP_WIDTH * BENCH_MAP_HEIGHT);
+  for (size_t i = 0; i < map.data.size(); i++) {
+    map.data[i] = i % 7 == 0 ? 100 : (i % 5 == 0 ? -1 : 0);
+  }
+
+  nav_msgs::msg::Path path;
+  path.header.frame_id = "map";
+  path.poses.resize(BENCH_PATH_POSES);
+  for (size_t i = 0; i < path.poses.size(); i++) {
+    path.poses[i].header.frame_id = "map";
+    path.poses[i].pose.position.x = 0.1 * i;
+    path.poses[i].pose.orientation.w = 1.0;
+  }
+
+  std::printf("%d rounds, convert + serialize\n", rounds);
+  std::printf("== bms\n");
+  run_legacy("legacy", rounds, bms, &legacy_bms);
+  run_arena("arena", rounds, bms, &cyberdogapp::Telemetry::mutable_bms);
+  std::printf("== wifi rssi\n");
+  run_legacy("legacy", rounds, rssi, &legacy_rssi);
+  run_arena("arena", rounds, rssi, &cyberdogapp::Telemetry::mutable_wifi_rssi);
+  std::printf("== status\n");
+  run_legacy("legacy", rounds, status, &legacy_status);
+  run_arena("arena", rounds, status, &cyberdogapp::Telemetry::mutable_status);
+  std::printf("== tracking status\n");
+  run_legacy("legacy", rounds, tracking_status, &legacy_tracking_status);
+  run_arena("arena", rounds, tracking_status, &cyberdogapp::Telemetry::mutable_tracking_status);
+  std::printf("== nav status\n");
+  run_legacy("legacy", rounds, caution, &legacy_nav_status);
+  run_arena("arena", rounds, caution, &cyberdogapp::Telemetry::mutable_nav_status);
+  std::printf("== body select, %d bodies\n", BENCH_BODIES);
+  run_legacy("legacy", rounds, bodies, &legacy_body_select);
+  run_arena("arena", rounds, bodies, &cyberdogapp::Telemetry::mutable_body_select);
+  std::printf("== tracking, %d bodies\n", BENCH_BODIES);
+  run_legacy("legacy", rounds, bodies, &legacy_tracking);
+  run_arena("arena", rounds, bodies, &cyberdogapp::Telemetry::mutable_tracking);
+  std::printf("== position\n");
+  run_legacy("legacy", rounds, velocity, &legacy_position);
+  run_arena("arena", rounds, velocity, &cyberdogapp::Telemetry::mutable_position);
+  std::printf("== voiceprint result\n");
+  run_legacy("legacy", rounds, voiceprint, &legacy_voiceprint);
+  run_arena("arena", rounds, voiceprint, &cyberdogapp::Telemetry::mutable_voiceprint_result);
+  std::printf("== face result, %d bytes image\n", BENCH_FACE_JPEG_BYTES);
+  run_legacy("legacy", std::max(1, rounds / 20), face, &legacy_face_result);
+  run_arena(
+    "arena", std::max(1, rounds / 20), face, &cyberdogapp::Telemetry::mutable_face_result);
+  run(
+    "arena bytes_images", std::max(1, rounds / 20), [&face](std::string & out) {
+      ConvertArena arena;
+      auto telemetry = arena.create<cyberdogapp::Telemetry>();
+      app_msg::fill(face, telemetry->mutable_face_result(), true);
+      telemetry->SerializeToString(&out);
+    });
+  std::printf("== odometry\n");
+  run_legacy("legacy", rounds, odometry, &legacy_odometry);
+  run_arena("arena", rounds, odometry, &cyberdogapp::Telemetry::mutable_odom_out);
+  std::printf("== obstacle detection\n");
+  run_legacy("legacy", rounds, around, &legacy_obstacle);
+  run_arena("arena", rounds, around, &cyberdogapp::Telemetry::mutable_obstacle_detection);
+  std::printf("== dog pose\n");
+  run_legacy("legacy", rounds, dog_pose, &legacy_dog_pose);
+  run_arena("arena", rounds, dog_pose, &cyberdogapp::Telemetry::mutable_dog_pose);
+  std::printf("== gps scene\n");
+  run_legacy("legacy", rounds, scene, &legacy_gps_scene);
+  run_arena("arena", rounds, scene, &cyberdogapp::Telemetry::mutable_gps_scene);
+  std::printf("== remote event\n");
+  run_legacy("legacy", rounds, remote_event, &legacy_remote_event);
+  run_arena("arena", rounds, remote_event, &cyberdogapp::Telemetry::mutable_remote_event);
+  std::printf("== path, %d poses\n", BENCH_PATH_POSES);
+  run_legacy("legacy", rounds, path, &legacy_path);
+  run_arena("arena", rounds, path, &cyberdogapp::Telemetry::mutable_path);
+  std::printf("== map, %dx%d\n", BENCH_MAP_WIDTH, BENCH_MAP_HEIGHT);
+  run_legacy("legacy", std::max(1, rounds / 20), map, &legacy_map);
+  run_arena("arena", std::max(1, rounds / 20), map, &cyberdogapp::Telemetry::mutable_map);
+  return 0;
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cost of getting one image to the app. Face images are jpeg already, the
+// legacy rounds put one data element per byte as the bridge used to, the
+// bytes rounds assign the image field once. Camera rounds read the latest
+// raw frame of a shared memory ring in place and encode it to jpeg, as
+// GET_IMAGE does with image_transport shm.
+//
+// Usage: image_bench [rounds]
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "app_msg_convert.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Face crops of the camera are about this size
+#define BENCH_FACE_JPEG_BYTES (60 * 1024)
+#define BENCH_CAMERA_WIDTH 1280
+#define BENCH_CAMERA_HEIGHT 720
+
+/**
+ * @brief Run one conversion rounds times and print cost per image
+ */
+void run(
+  const std::string & name, const int rounds,
+  const std::function<bool(std::string & out)> & convert)
+{
+  std::string out;
+  convert(out);  // warm up output buffer
+  auto start = Clock::now();
+  size_t bytes(0);
+  int failed(0);
+  for (int i = 0; i < rounds; i++) {
+    if (!convert(out)) {
+      failed++;
+    }
+    bytes += out.size();
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  std::printf(
+    "  %-20s %10.1f us/image %9zu bytes/image %d failed\n", name.c_str(),
+    elapsed / rounds, bytes / rounds, failed);
+}
+
+void legacy_image(
+  const interaction_msgs::msg::CompressedImage & in, cyberdogapp::CompressedImage * img)
+{
+  ::cyberdogapp::Header header;
+  ::cyberdogapp::Timestamp time;
+  img->set_format(in.format);
+  time.set_sec(in.header.stamp.sec);
+  time.set_nanosec(in.header.stamp.nanosec);
+  header.set_frame_id(in.header.frame_id);
+  header.mutable_stamp()->CopyFrom(time);
+  img->mutable_header()->CopyFrom(header);
+  for (size_t j = 0; j < in.data.size(); j++) {
+    img->add_data(in.data[j]);
+  }
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  auto rounds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+
+  interaction_msgs::msg::CompressedImage face;
+  face.header.frame_id = "camera";
+  face.format = "jpeg";
+  face.data.resize(BENCH_FACE_JPEG_BYTES);
+  for (size_t i = 0; i < face.data.size(); i++) {
+    face.data[i] = static_cast<uint8_t>(i * 31 + i / 7);
+  }
+
+  std::printf("%d rounds, convert + serialize\n", rounds);
+  std::printf("== face image, %d bytes jpeg\n", BENCH_FACE_JPEG_BYTES);
+  run(
+    "legacy", rounds, [&face](std::string & out) {
+      cyberdogapp::FaceManager_Response respond;
+      legacy_image(face, respond.add_face_images());
+      return respond.SerializeToString(&out);
+    });
+  run(
+    "bytes", rounds, [&face](std::string & out) {
+      cyberdogapp::FaceManager_Response respond;
+      app_msg::fill(face, respond.add_face_images(), true);
+      return respond.SerializeToString(&out);
+    });
+
+  auto name = "/image_bench_" + std::to_string(getpid());
+  auto producer = cyberdog_utils::ImageRing::create(
+    name, 3, BENCH_CAMERA_WIDTH * BENCH_CAMERA_HEIGHT * 3);
+  auto reader = cyberdog_utils::ImageRing::open(name);
+  if (producer == nullptr || reader == nullptr) {
+    std::printf("can not create ring %s\n", name.c_str());
+    return 1;
+  }
+  cyberdog_utils::ImageFrame frame;
+  std::memset(&frame, 0, sizeof(frame));
+  frame.format = cyberdog_utils::IMAGE_BGR8;
+  frame.width = BENCH_CAMERA_WIDTH;
+  frame.height = BENCH_CAMERA_HEIGHT;
+  frame.step = BENCH_CAMERA_WIDTH * 3;
+  frame.size = frame.step * BENCH_CAMERA_HEIGHT;
+  std::strncpy(frame.frame_id, "1", sizeof(frame.frame_id) - 1);
+  // Gradient with some noise, compresses about like a camera image
+  std::vector<uint8_t> pixels(frame.size);
+  for (uint32_t y = 0; y < frame.height; y++) {
+    for (uint32_t x = 0; x < frame.step; x++) {
+      pixels[y * frame.step + x] = static_cast<uint8_t>(x / 5 + y / 3 + (x * y) % 13);
+    }
+  }
+  producer->write(frame, pixels.data());
+
+  std::printf("== camera image, %dx%d bgr8\n", BENCH_CAMERA_WIDTH, BENCH_CAMERA_HEIGHT);
+  for (int quality : {50, JPEG_DEFAULT_QUALITY, 90}) {
+    run(
+      "ring + jpeg q" + std::to_string(quality), std::max(1, rounds / 10),
+      [&reader, quality](std::string & out) {
+        cyberdogapp::CameraService_respond respond;
+        bool encoded(false);
+        bool read = reader->read_latest(
+          [&encoded, &respond, quality](
+            const cyberdog_utils::ImageFrame & frame, const uint8_t * data) {
+            encoded = app_msg::fill(frame, data, quality, respond.mutable_image());
+          });
+        respond.SerializeToString(&out);
+        return read && encoded;
+      });
+  }
+  reader.reset();
+  producer.reset();
+  return 0;
+}
@@ -0,0 +1,282 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App topics through the dispatcher pool over a throttled local socket,
+// once with fixed rates and once with link rate control. The sink reads at
+// a fixed byte rate, like a weak Wi-Fi link, and each send gives up after
+// the 2 s deadline of the app calls. Latency is push -> written.
+//
+// Usage: link_rate_harness [kbytes_per_s] [seconds]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "link_rate_control.hpp"
+#include "msgdispatcher.hpp"
+#include "net_avalible.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+const int SOCKET_BUFFER = 16 * 1024;
+const size_t FRAME_BYTES = 4 * 1024;
+const auto SEND_DEADLINE = std::chrono::seconds(2);
+
+struct TopicSpec
+{
+  const char * name;
+  TopicPriority priority;
+  double rate_hz;
+  size_t bytes;
+};
+
+const TopicSpec TOPICS[] = {
+  {"status", PRIORITY_CRITICAL, 50, 300},
+  {"bms", PRIORITY_CRITICAL, 1, 100},
+  {"dog_pose", PRIORITY_NORMAL, 20, 200},
+  {"obstacle_detection", PRIORITY_NORMAL, 10, 400},
+  {"odom_out", PRIORITY_BULK, 10, 700},
+  {"path", PRIORITY_BULK, 2, 20000},
+  {"map", PRIORITY_BULK, 1, 200000},
+};
+const size_t TOPIC_COUNT = sizeof(TOPICS) / sizeof(TOPICS[0]);
+
+struct Sample
+{
+  size_t topic;
+  Clock::time_point pushed;
+};
+using SamplePtr = std::shared_ptr<Sample>;
+
+/**
+ * @brief Accepts one connection and reads it at a fixed byte rate
+ */
+class ThrottledSink
+{
+public:
+  explicit ThrottledSink(size_t bytes_per_s)
+  : bytes_per_s_(bytes_per_s), need_run_(true)
+  {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listen_fd_, SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&address), sizeof(address));
+    socklen_t len = sizeof(address);
+    getsockname(listen_fd_, reinterpret_cast<struct sockaddr *>(&address), &len);
+    port_ = ntohs(address.sin_port);
+    listen(listen_fd_, 1);
+    thread_ = std::thread(&ThrottledSink::run_, this);
+  }
+  ~ThrottledSink()
+  {
+    need_run_ = false;
+    shutdown(listen_fd_, SHUT_RDWR);
+    thread_.join();
+    close(listen_fd_);
+  }
+  uint16_t port() const {return port_;}
+
+private:
+  void run_()
+  {
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      return;
+    }
+    // Read in 10 ms slices
+    std::vector<char> buf(std::max<size_t>(1, bytes_per_s_ / 100));
+    auto next = Clock::now();
+    while (need_run_) {
+      next += std::chrono::milliseconds(10);
+      std::this_thread::sleep_until(next);
+      if (recv(fd, buf.data(), buf.size(), MSG_DONTWAIT) == 0) {
+        break;
+      }
+    }
+    close(fd);
+  }
+
+  size_t bytes_per_s_;
+  std::atomic_bool need_run_;
+  int listen_fd_;
+  uint16_t port_;
+  std::thread thread_;
+};
+
+/**
+ * @brief One connection shared by all topics, like the channel to the app
+ */
+class Sender
+{
+public:
+  explicit Sender(uint16_t port)
+  : payload_(FRAME_BYTES, 'x')
+  {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    connect(fd_, reinterpret_cast<struct sockaddr *>(&address), sizeof(address));
+  }
+  ~Sender()
+  {
+    close(fd_);
+  }
+
+  // False if deadline is hit. Written in frames so topics share the
+  // connection, like the streams of one HTTP/2 connection.
+  bool send(size_t bytes)
+  {
+    auto deadline = Clock::now() + SEND_DEADLINE;
+    size_t sent = 0;
+    while (sent < bytes) {
+      auto frame = std::min(FRAME_BYTES, bytes - sent);
+      std::lock_guard<std::mutex> lk(mutex_);
+      while (frame > 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        struct pollfd pfd = {fd_, POLLOUT, 0};
+        if (left.count() <= 0 || poll(&pfd, 1, left.count()) <= 0) {
+          return false;
+        }
+        auto n = ::send(fd_, payload_.data(), frame, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN) {
+          return false;
+        }
+        frame -= std::max<ssize_t>(0, n);
+        sent += std::max<ssize_t>(0, n);
+      }
+    }
+    return true;
+  }
+
+private:
+  int fd_;
+  std::mutex mutex_;
+  std::string payload_;
+};
+
+struct TopicResult
+{
+  std::mutex mutex;
+  uint64_t pushed = 0;
+  uint64_t failed = 0;
+  std::vector<double> latency_ms;
+};
+
+void run(const char * title, size_t bytes_per_s, int seconds, bool rate_control)
+{
+  ThrottledSink sink(bytes_per_s);
+  Sender sender(sink.port());
+  NetChecker checker;
+  checker.set_ip("127.0.0.1", sink.port());
+  LinkRateControl control;
+  std::vector<TopicResult> results(TOPIC_COUNT);
+  {
+    DispatcherPool pool;
+    std::vector<std::unique_ptr<LatestMsgDispather<SamplePtr>>> dispatchers;
+    for (size_t i = 0; i < TOPIC_COUNT; i++) {
+      dispatchers.emplace_back(new LatestMsgDispather<SamplePtr>(pool));
+      auto & dispatcher = *dispatchers.back();
+      dispatcher.setCallback(
+        [&sender, &results](SamplePtr msg) {
+          auto & sample = *msg;
+          bool ok = sender.send(TOPICS[sample.topic].bytes);
+          auto & result = results[sample.topic];
+          std::lock_guard<std::mutex> lk(result.mutex);
+          if (ok) {
+            result.latency_ms.push_back(
+              std::chrono::duration<double, std::milli>(Clock::now() - sample.pushed).count());
+          } else {
+            result.failed++;
+          }
+        });
+      auto topic = control.add_topic(
+        TOPICS[i].name, TOPICS[i].priority,
+        [&dispatcher](double rate_hz) {dispatcher.setRateLimit(rate_hz);});
+      dispatcher.setSentCallback(
+        [&control, topic](Clock::duration elapsed) {control.on_sent(topic, elapsed);});
+    }
+
+    // Every topic at its own rate from one producer, like the ROS callbacks
+    std::vector<Clock::time_point> next(TOPIC_COUNT, Clock::now());
+    auto end = Clock::now() + std::chrono::seconds(seconds);
+    auto next_update = Clock::now();
+    while (Clock::now() < end) {
+      auto now = Clock::now();
+      for (size_t i = 0; i < TOPIC_COUNT; i++) {
+        if (now >= next[i]) {
+          next[i] += std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / TOPICS[i].rate_hz));
+          dispatchers[i]->push(std::make_shared<Sample>(Sample{i, now}));
+          std::lock_guard<std::mutex> lk(results[i].mutex);
+          results[i].pushed++;
+        }
+      }
+      if (rate_control && now >= next_update) {
+        // Heartbeat period of Cyberdog_app
+        next_update += std::chrono::milliseconds(500);
+        control.update(checker.stats(), true);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  std::printf("== %s\n", title);
+  auto stats = control.stats();
+  std::printf(
+    "  period normal %.2f s, bulk %.2f s\n", stats.period_s[PRIORITY_NORMAL],
+    stats.period_s[PRIORITY_BULK]);
+  for (size_t i = 0; i < TOPIC_COUNT; i++) {
+    auto & latency = results[i].latency_ms;
+    std::sort(latency.begin(), latency.end());
+    auto pick = [&latency](double q) {
+        return latency.empty() ? 0 :
+               latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+      };
+    std::printf(
+      "  %-18s pushed %6.1f Hz delivered %6.1f Hz timeouts %3lu latency ms p50 %7.1f p99 %7.1f\n",
+      TOPICS[i].name, results[i].pushed / static_cast<double>(seconds),
+      latency.size() / static_cast<double>(seconds), results[i].failed, pick(0.5), pick(0.99));
+  }
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  auto kbytes_per_s = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100;
+  auto seconds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+  std::printf("link %d KB/s, %d s\n", kbytes_per_s, seconds);
+  run("fixed rates", kbytes_per_s * 1024, seconds, false);
+  run("link rate control", kbytes_per_s * 1024, seconds, true);
+  return 0;
+}
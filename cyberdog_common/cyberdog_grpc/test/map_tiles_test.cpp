@@ -0,0 +1,193 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "map_tiles.hpp"
+
+#include "gtest/gtest.h"
+
+namespace
+{
+// Not a multiple of the tile size, edge tiles are smaller
+#define TEST_MAP_WIDTH 150
+#define TEST_MAP_HEIGHT 100
+#define TEST_TILE_SIZE 64
+#define TEST_TILES_X 3
+#define TEST_TILES_Y 2
+
+nav_msgs::msg::OccupancyGrid make_grid()
+{
+  nav_msgs::msg::OccupancyGrid grid;
+  grid.info.resolution = 0.05f;
+  grid.info.width = TEST_MAP_WIDTH;
+  grid.info.height = TEST_MAP_HEIGHT;
+  grid.data.resize(TEST_MAP_WIDTH * TEST_MAP_HEIGHT);
+  for (size_t i = 0; i < grid.data.size(); i++) {
+    grid.data[i] = i % 7 == 0 ? 100 : (i % 5 == 0 ? -1 : 0);
+  }
+  return grid;
+}
+
+// FNV-1a over the rows of one tile, as the app checks it
+uint64_t tile_hash(const nav_msgs::msg::OccupancyGrid & grid, uint32_t index)
+{
+  uint32_t x0 = index % TEST_TILES_X * TEST_TILE_SIZE;
+  uint32_t y0 = index / TEST_TILES_X * TEST_TILE_SIZE;
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint32_t y = y0; y < std::min<uint32_t>(y0 + TEST_TILE_SIZE, grid.info.height); y++) {
+    for (uint32_t x = x0; x < std::min<uint32_t>(x0 + TEST_TILE_SIZE, grid.info.width); x++) {
+      hash = (hash ^ static_cast<uint8_t>(grid.data[y * grid.info.width + x])) *
+        1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+std::set<uint32_t> indices(const cyberdogapp::MapTiles & tiles)
+{
+  std::set<uint32_t> result;
+  for (const auto & tile : tiles.tiles()) {
+    result.insert(tile.index());
+  }
+  return result;
+}
+
+void expect_round_trip(const std::vector<int8_t> & cells)
+{
+  std::string encoded;
+  MapTileEncoder::rle_encode(cells.data(), cells.size(), encoded);
+  std::vector<int8_t> decoded;
+  ASSERT_TRUE(MapTileEncoder::rle_decode(encoded, decoded));
+  EXPECT_EQ(decoded, cells);
+}
+}  // namespace
+
+TEST(MapTilesTest, RleRoundTrip)
+{
+  expect_round_trip({});
+  expect_round_trip({-1});
+  expect_round_trip({0, 100, -1, 100, 0});
+  // Runs longer than one count byte are split
+  expect_round_trip(std::vector<int8_t>(1000, -1));
+  std::vector<int8_t> cells(255, 0);
+  cells.push_back(0);
+  cells.push_back(100);
+  expect_round_trip(cells);
+
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> value(-128, 127);
+  std::uniform_int_distribution<int> run(1, 600);
+  cells.clear();
+  while (cells.size() < 20000) {
+    cells.insert(cells.end(), run(random), static_cast<int8_t>(value(random)));
+  }
+  expect_round_trip(cells);
+}
+
+TEST(MapTilesTest, RleRejectsBrokenInput)
+{
+  std::vector<int8_t> cells;
+  EXPECT_FALSE(MapTileEncoder::rle_decode(std::string("\x03", 1), cells));
+  EXPECT_FALSE(MapTileEncoder::rle_decode(std::string("\x00\x05", 2), cells));
+}
+
+TEST(MapTilesTest, FirstMapIsFullAndRebuildsGrid)
+{
+  auto grid = make_grid();
+  MapTileEncoder encoder(TEST_TILE_SIZE);
+  cyberdogapp::MapTiles tiles;
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+  EXPECT_TRUE(tiles.full());
+  EXPECT_EQ(tiles.tile_size(), uint32_t(TEST_TILE_SIZE));
+  ASSERT_EQ(tiles.tiles_size(), TEST_TILES_X * TEST_TILES_Y);
+
+  std::vector<int8_t> rebuilt(grid.data.size(), 0);
+  for (const auto & tile : tiles.tiles()) {
+    EXPECT_EQ(tile.hash(), tile_hash(grid, tile.index()));
+    std::vector<int8_t> cells;
+    ASSERT_TRUE(MapTileEncoder::rle_decode(tile.data(), cells));
+    uint32_t x0 = tile.index() % TEST_TILES_X * TEST_TILE_SIZE;
+    uint32_t y0 = tile.index() / TEST_TILES_X * TEST_TILE_SIZE;
+    uint32_t w = std::min<uint32_t>(TEST_TILE_SIZE, TEST_MAP_WIDTH - x0);
+    ASSERT_EQ(cells.size() % w, 0u);
+    for (size_t i = 0; i < cells.size(); i++) {
+      rebuilt[(y0 + i / w) * TEST_MAP_WIDTH + x0 + i % w] = cells[i];
+    }
+  }
+  EXPECT_EQ(rebuilt, grid.data);
+}
+
+TEST(MapTilesTest, OnlyChangedTilesAreSent)
+{
+  auto grid = make_grid();
+  MapTileEncoder encoder(TEST_TILE_SIZE);
+  cyberdogapp::MapTiles tiles;
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+
+  tiles.Clear();
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+  EXPECT_FALSE(tiles.full());
+  EXPECT_EQ(tiles.tiles_size(), 0);
+
+  // One cell in the top left tile, one in the bottom right edge tile
+  grid.data[3 * TEST_MAP_WIDTH + 5] = 42;
+  grid.data[(TEST_MAP_HEIGHT - 1) * TEST_MAP_WIDTH + TEST_MAP_WIDTH - 1] = 42;
+  tiles.Clear();
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+  EXPECT_FALSE(tiles.full());
+  EXPECT_EQ(indices(tiles), std::set<uint32_t>({0, TEST_TILES_X * TEST_TILES_Y - 1}));
+  for (const auto & tile : tiles.tiles()) {
+    EXPECT_EQ(tile.hash(), tile_hash(grid, tile.index()));
+  }
+
+  // Changed back is a change too
+  grid.data[3 * TEST_MAP_WIDTH + 5] = make_grid().data[3 * TEST_MAP_WIDTH + 5];
+  tiles.Clear();
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+  EXPECT_EQ(indices(tiles), std::set<uint32_t>({0}));
+}
+
+TEST(MapTilesTest, NewGeometryOrResetIsFull)
+{
+  auto grid = make_grid();
+  MapTileEncoder encoder(TEST_TILE_SIZE);
+  cyberdogapp::MapTiles tiles;
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+
+  grid.info.origin.position.x = 1.0;
+  tiles.Clear();
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+  EXPECT_TRUE(tiles.full());
+  EXPECT_EQ(tiles.tiles_size(), TEST_TILES_X * TEST_TILES_Y);
+
+  encoder.reset();
+  tiles.Clear();
+  ASSERT_TRUE(encoder.encode(grid, tiles));
+  EXPECT_TRUE(tiles.full());
+  EXPECT_EQ(tiles.tiles_size(), TEST_TILES_X * TEST_TILES_Y);
+}
+
+TEST(MapTilesTest, DataNotMatchingSizeIsRejected)
+{
+  auto grid = make_grid();
+  grid.data.pop_back();
+  MapTileEncoder encoder(TEST_TILE_SIZE);
+  cyberdogapp::MapTiles tiles;
+  EXPECT_FALSE(encoder.encode(grid, tiles));
+}
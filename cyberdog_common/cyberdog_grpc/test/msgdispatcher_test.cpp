@@ -0,0 +1,219 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "msgdispatcher.hpp"
+
+#include "gtest/gtest.h"
+
+namespace
+{
+using ValuePtr = std::shared_ptr<int>;
+
+/**
+ * @brief Callback blocked until released, to hold a worker
+ */
+class Gate
+{
+public:
+  void enter()
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    entered_ = true;
+    cv_.notify_all();
+    cv_.wait(lk, [this] {return open_;});
+  }
+  bool wait_entered()
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    return cv_.wait_for(lk, std::chrono::seconds(5), [this] {return entered_;});
+  }
+  void open()
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    open_ = true;
+    cv_.notify_all();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool entered_{false};
+  bool open_{false};
+};
+
+template<typename PredicateT>
+bool wait_until(PredicateT predicate)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+}  // namespace
+
+TEST(MsgDispatcherTest, PushesWhileBusyAreCoalesced)
+{
+  DispatcherPool pool(1);
+  Gate gate;
+  std::mutex mutex;
+  std::vector<int> seen;
+  ValuePtr called;
+  LatestMsgDispather<ValuePtr> dispatcher(pool);
+  dispatcher.setCallback(
+    [&](ValuePtr msg) {
+      if (*msg == 1) {
+        gate.enter();
+      }
+      std::lock_guard<std::mutex> lk(mutex);
+      called = msg;
+      seen.push_back(*msg);
+    });
+
+  dispatcher.push(std::make_shared<int>(1));
+  ASSERT_TRUE(gate.wait_entered());
+  // Pointer pushed is the one called back, nothing is copied
+  auto last = std::make_shared<int>(100);
+  const int * last_address = last.get();
+  for (int i = 2; i < 100; i++) {
+    dispatcher.push(std::make_shared<int>(i));
+  }
+  dispatcher.push(last);
+  last.reset();
+  gate.open();
+
+  ASSERT_TRUE(
+    wait_until(
+      [&] {
+        std::lock_guard<std::mutex> lk(mutex);
+        return seen.size() == 2;
+      }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::lock_guard<std::mutex> lk(mutex);
+  EXPECT_EQ(seen, std::vector<int>({1, 100}));
+  ASSERT_NE(called, nullptr);
+  EXPECT_EQ(called.get(), last_address);
+}
+
+TEST(MsgDispatcherTest, TopicsKeepOrderAndNeverRunTwice)
+{
+  const int topics = 8;
+  const int values = 2000;
+  DispatcherPool pool(4);
+  std::vector<std::atomic_int> last(topics);
+  std::vector<std::atomic_int> running(topics);
+  std::atomic_int out_of_order(0);
+  std::atomic_int overlapped(0);
+  // Declared last, gone before anything its callbacks use
+  std::vector<std::unique_ptr<LatestMsgDispather<ValuePtr>>> dispatchers;
+  for (int i = 0; i < topics; i++) {
+    last[i] = 0;
+    running[i] = 0;
+    dispatchers.emplace_back(new LatestMsgDispather<ValuePtr>(pool));
+    dispatchers.back()->setCallback(
+      [&, i](ValuePtr msg) {
+        if (running[i]++ != 0) {
+          overlapped++;
+        }
+        if (*msg <= last[i]) {
+          out_of_order++;
+        }
+        last[i] = *msg;
+        std::this_thread::yield();
+        running[i]--;
+      });
+  }
+
+  // Two producers, like ROS callbacks of different topics on different threads
+  auto produce = [&](int first) {
+      for (int value = 1; value <= values; value++) {
+        for (int i = first; i < topics; i += 2) {
+          dispatchers[i]->push(std::make_shared<int>(value));
+        }
+      }
+    };
+  std::thread even(produce, 0);
+  std::thread odd(produce, 1);
+  even.join();
+  odd.join();
+
+  for (int i = 0; i < topics; i++) {
+    EXPECT_TRUE(wait_until([&] {return last[i] == values;})) << "topic " << i;
+  }
+  EXPECT_EQ(out_of_order, 0);
+  EXPECT_EQ(overlapped, 0);
+}
+
+TEST(MsgDispatcherTest, BlockedTopicHoldsOneWorkerOnly)
+{
+  DispatcherPool pool(2);
+  Gate gate;
+  std::atomic_int fast_calls(0);
+  LatestMsgDispather<ValuePtr> slow(pool);
+  LatestMsgDispather<ValuePtr> fast(pool);
+  slow.setCallback([&](ValuePtr) {gate.enter();});
+  fast.setCallback([&](ValuePtr) {fast_calls++;});
+
+  slow.push(std::make_shared<int>(1));
+  ASSERT_TRUE(gate.wait_entered());
+  for (int i = 1; i <= 10; i++) {
+    fast.push(std::make_shared<int>(i));
+    EXPECT_TRUE(wait_until([&] {return fast_calls == i;}));
+  }
+  gate.open();
+}
+
+TEST(MsgDispatcherTest, NoCallbackAfterRemoval)
+{
+  DispatcherPool pool(1);
+  Gate gate;
+  std::atomic_int calls(0);
+  LatestMsgDispather<ValuePtr> blocker(pool);
+  blocker.setCallback([&](ValuePtr) {gate.enter();});
+  blocker.push(std::make_shared<int>(1));
+  ASSERT_TRUE(gate.wait_entered());
+  {
+    // Queued behind the blocked worker when it goes away
+    LatestMsgDispather<ValuePtr> removed(pool);
+    removed.setCallback([&](ValuePtr) {calls++;});
+    removed.push(std::make_shared<int>(1));
+  }
+  gate.open();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(calls, 0);
+}
+
+TEST(MsgDispatcherTest, PushAfterRemovalStartedIsNotQueued)
+{
+  DispatcherPool pool(1);
+  std::atomic_int calls(0);
+  LatestMsgDispather<ValuePtr> removed(pool);
+  removed.setCallback([&](ValuePtr) {calls++;});
+  // Same order as a push racing with the destructor, which removes first
+  pool.remove(&removed);
+  removed.push(std::make_shared<int>(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(calls, 0);
+}
@@ -0,0 +1,171 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "response_queue.hpp"
+
+#include "gtest/gtest.h"
+
+namespace
+{
+// Producer in the high bits, its running count in the low ones
+#define VALUE_PRODUCER_SHIFT 32
+// Values with this bit set are progress feedback
+#define VALUE_FEEDBACK_BIT (int64_t(1) << 62)
+
+int64_t make_value(int producer, int count)
+{
+  return (int64_t(producer) << VALUE_PRODUCER_SHIFT) | count;
+}
+int producer_of(int64_t value)
+{
+  return static_cast<int>((value & ~VALUE_FEEDBACK_BIT) >> VALUE_PRODUCER_SHIFT);
+}
+int count_of(int64_t value)
+{
+  return static_cast<int>(value & 0xffffffff);
+}
+bool is_feedback(const int64_t & value)
+{
+  return (value & VALUE_FEEDBACK_BIT) != 0;
+}
+}  // namespace
+
+TEST(ResponseQueueTest, FullQueueDropsOldest)
+{
+  ResponseQueue<int64_t> queue(8);
+  for (int i = 0; i < 20; i++) {
+    queue.push(i);
+  }
+  EXPECT_EQ(queue.dropped(), 12u);
+  int64_t value;
+  for (int i = 12; i < 20; i++) {
+    ASSERT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(ResponseQueueTest, FeedbackKeepsLatestAfterEarlierResponses)
+{
+  ResponseQueue<int64_t> queue(8, is_feedback);
+  queue.push(1);
+  queue.push(VALUE_FEEDBACK_BIT | 1);
+  queue.push(VALUE_FEEDBACK_BIT | 2);
+  queue.push(2);
+  EXPECT_EQ(queue.dropped(), 1u);
+  int64_t value;
+  ASSERT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(value, 1);
+  ASSERT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(value, VALUE_FEEDBACK_BIT | 2);
+  ASSERT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(ResponseQueueTest, ProducersKeepOrderAndCountsAddUp)
+{
+  const int producers = 4;
+  const int values = 50000;
+  ResponseQueue<int64_t> queue(64, is_feedback);
+  std::atomic_int done(0);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back(
+      [&, p]() {
+        for (int i = 1; i <= values; i++) {
+          if (i % 10 == 0) {
+            queue.push(VALUE_FEEDBACK_BIT | make_value(p, i));
+          } else {
+            queue.push(make_value(p, i));
+          }
+        }
+        done++;
+      });
+  }
+
+  std::vector<int> last(producers, 0);
+  uint64_t popped(0);
+  int out_of_order(0);
+  int64_t value;
+  while (true) {
+    bool finished = done == producers;
+    if (queue.wait_and_pop(value, std::chrono::milliseconds(10)) == queue.POPPED) {
+      popped++;
+      // Feedback is only the latest one, ordered against the ring by stamp
+      if (!is_feedback(value)) {
+        auto p = producer_of(value);
+        if (count_of(value) <= last[p]) {
+          out_of_order++;
+        }
+        last[p] = count_of(value);
+      }
+    } else if (finished) {
+      break;
+    }
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(out_of_order, 0);
+  EXPECT_EQ(popped + queue.dropped(), uint64_t(producers) * values);
+}
+
+TEST(ResponseQueueTest, WaitWakesOnPush)
+{
+  ResponseQueue<int64_t> queue(8);
+  std::thread producer(
+    [&queue]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      queue.push(7);
+    });
+  auto start = std::chrono::steady_clock::now();
+  int64_t value(0);
+  EXPECT_EQ(queue.wait_and_pop(value, std::chrono::seconds(5)), queue.POPPED);
+  EXPECT_EQ(value, 7);
+  // Woken by the eventfd, not by the cancel poll
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(90));
+  producer.join();
+}
+
+TEST(ResponseQueueTest, WaitEndsOnTimeoutAndCancel)
+{
+  ResponseQueue<int64_t> queue(8);
+  int64_t value;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(queue.wait_and_pop(value, std::chrono::milliseconds(50)), queue.TIMEOUT);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+  std::atomic_bool cancelled(false);
+  std::thread canceller(
+    [&cancelled]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      cancelled = true;
+    });
+  start = std::chrono::steady_clock::now();
+  EXPECT_EQ(
+    queue.wait_and_pop(
+      value, std::chrono::seconds(10), [&cancelled]() {return cancelled.load();}),
+    queue.CANCELLED);
+  EXPECT_LT(
+    std::chrono::steady_clock::now() - start,
+    std::chrono::milliseconds(50 + 2 * RESPONSE_CANCEL_POLL_MS));
+  canceller.join();
+}
@@ -0,0 +1,319 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Telemetry over streamTelemetry against unary subscribe* calls, same load
+// for both, over a loopback connection to a fake app in this process. Each
+// message carries its sequence number, latency is send -> app received and
+// throughput is messages over the time until the app got the last one.
+// Rate 0 sends as fast as the transport takes them.
+//
+// Usage: stream_bench [messages] [rate_hz]
+
+#include <grpcpp/create_channel.h>
+#include <grpcpp/security/credentials.h>
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server_builder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "app_msg_convert.hpp"
+#include "telemetry_stream.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Sizes as seen on the robot
+#define BENCH_PATH_POSES 500
+#define BENCH_DRAIN_SECONDS 10
+
+int64_t steady_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Send time of every message and receive time at the app
+ */
+class Record
+{
+public:
+  void reset(int messages)
+  {
+    sent_ns_.assign(messages, 0);
+    received_ns_.reset(new std::atomic<int64_t>[messages]);
+    for (int i = 0; i < messages; i++) {
+      received_ns_[i].store(0);
+    }
+    received_ = 0;
+  }
+  void sent(int seq) {sent_ns_[seq] = steady_ns();}
+  void received(uint64_t seq)
+  {
+    if (seq < sent_ns_.size() && received_ns_[seq].exchange(steady_ns()) == 0) {
+      received_++;
+    }
+  }
+  int received_count() const {return received_;}
+  int64_t sent_ns(int seq) const {return sent_ns_[seq];}
+  int64_t received_ns(int seq) const {return received_ns_[seq].load();}
+  int size() const {return sent_ns_.size();}
+
+private:
+  std::vector<int64_t> sent_ns_;
+  std::unique_ptr<std::atomic<int64_t>[]> received_ns_;
+  std::atomic_int received_;
+};
+
+Record record;
+
+class FakeApp final : public cyberdogapp::CyberdogApp::Service
+{
+public:
+  grpc::Status subscribeStatus(
+    grpc::ServerContext *, const cyberdogapp::StatusStamped * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribeOdomOut(
+    grpc::ServerContext *, const cyberdogapp::Odometry * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status subscribePath(
+    grpc::ServerContext *, const cyberdogapp::Path * request,
+    cyberdogapp::Result *) override
+  {
+    take_(*request);
+    return grpc::Status::OK;
+  }
+
+  grpc::Status streamTelemetry(
+    grpc::ServerContext *, grpc::ServerReader<cyberdogapp::Telemetry> * reader,
+    cyberdogapp::Result *) override
+  {
+    cyberdogapp::Telemetry telemetry;
+    while (reader->Read(&telemetry)) {
+      switch (telemetry.payload_case()) {
+        case cyberdogapp::Telemetry::kStatus:
+          take_(telemetry.status());
+          break;
+        case cyberdogapp::Telemetry::kOdomOut:
+          take_(telemetry.odom_out());
+          break;
+        case cyberdogapp::Telemetry::kPath:
+          take_(telemetry.path());
+          break;
+        default:
+          break;
+      }
+    }
+    return grpc::Status::OK;
+  }
+
+private:
+  void take_(const cyberdogapp::StatusStamped & msg)
+  {
+    record.received(msg.status().pose().pose().position().x());
+  }
+  void take_(const cyberdogapp::Odometry & msg) {record.received(msg.header().stamp().sec());}
+  void take_(const cyberdogapp::Path & msg) {record.received(msg.header().stamp().sec());}
+};
+
+/**
+ * @brief Fill telemetry of message seq and send it one way
+ */
+using Sender = std::function<void (int seq, cyberdogapp::Telemetry * telemetry)>;
+using Filler = std::function<void (int seq, cyberdogapp::Telemetry * telemetry)>;
+
+void run(
+  const std::string & name, const int messages, const int rate_hz,
+  const Filler & fill, const Sender & send)
+{
+  record.reset(messages);
+  auto period = std::chrono::nanoseconds(rate_hz > 0 ? 1000000000 / rate_hz : 0);
+  auto start = Clock::now();
+  auto next = start;
+  for (int i = 0; i < messages; i++) {
+    if (rate_hz > 0) {
+      next += period;
+      std::this_thread::sleep_until(next);
+    }
+    ConvertArena arena;
+    auto telemetry = arena.create<cyberdogapp::Telemetry>();
+    record.sent(i);
+    fill(i, telemetry);
+    send(i, telemetry);
+  }
+  auto send_done = Clock::now();
+  auto drain_deadline = send_done + std::chrono::seconds(BENCH_DRAIN_SECONDS);
+  while (record.received_count() < messages && Clock::now() < drain_deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  int64_t last_ns(0);
+  std::vector<double> latency;
+  for (int i = 0; i < messages; i++) {
+    if (record.received_ns(i) != 0) {
+      latency.push_back((record.received_ns(i) - record.sent_ns(i)) * 1e-3);
+      last_ns = std::max(last_ns, record.received_ns(i));
+    }
+  }
+  auto start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    start.time_since_epoch()).count();
+  auto seconds = std::max<int64_t>(1, last_ns - start_ns) * 1e-9;
+  std::printf(
+    "  %-8s received %d of %d, %9.0f msg/s, send %7.2f us/msg", name.c_str(),
+    static_cast<int>(latency.size()), messages, latency.size() / seconds,
+    std::chrono::duration<double, std::micro>(send_done - start).count() / messages);
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    auto pick = [&latency](double q) {
+        return latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+      };
+    std::printf(
+      ", latency us p50 %.0f p99 %.0f max %.0f", pick(0.5), pick(0.99), latency.back());
+  }
+  std::printf("\n");
+}
+
+template<typename RequestT>
+Sender unary(
+  cyberdogapp::CyberdogApp::Stub * stub,
+  grpc::Status (cyberdogapp::CyberdogApp::Stub::* call)(
+    grpc::ClientContext *, const RequestT &, cyberdogapp::Result *),
+  const RequestT & (cyberdogapp::Telemetry::* field)() const)
+{
+  return [stub, call, field](int, cyberdogapp::Telemetry * telemetry) {
+           grpc::ClientContext context;
+           context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(2));
+           cyberdogapp::Result result;
+           (stub->*call)(&context, (telemetry->*field)(), &result);
+         };
+}
+
+Sender stream(TelemetryStream * telemetry_stream)
+{
+  return [telemetry_stream](int, cyberdogapp::Telemetry * telemetry) {
+           std::vector<cyberdogapp::Telemetry> unconfirmed;
+           telemetry_stream->write(*telemetry, unconfirmed);
+         };
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  auto messages = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5000;
+  auto rate_hz = argc > 2 ? std::max(0, std::atoi(argv[2])) : 0;
+
+  FakeApp app;
+  int port(0);
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+  builder.RegisterService(&app);
+  auto server = builder.BuildAndStart();
+  if (server == nullptr || port == 0) {
+    std::printf("can not start fake app\n");
+    return 1;
+  }
+  auto channel = grpc::CreateChannel(
+    "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials());
+  auto stub = cyberdogapp::CyberdogApp::NewStub(channel);
+  TelemetryStream telemetry_stream(stub.get());
+
+  motion_msgs::msg::ControlState status;
+  status.modestamped.control_mode = 3;
+  nav_msgs::msg::Odometry odometry;
+  odometry.header.frame_id = "odom";
+  odometry.child_frame_id = "base_link";
+  odometry.pose.pose.orientation.w = 1.0;
+  nav_msgs::msg::Path path;
+  path.header.frame_id = "map";
+  path.poses.resize(BENCH_PATH_POSES);
+  for (size_t i = 0; i < path.poses.size(); i++) {
+    path.poses[i].header.frame_id = "map";
+    path.poses[i].pose.position.x = 0.1 * i;
+    path.poses[i].pose.orientation.w = 1.0;
+  }
+
+  Filler fill_status = [&status](int seq, cyberdogapp::Telemetry * telemetry) {
+      status.posestamped.position_x = seq;
+      app_msg::fill(status, telemetry->mutable_status());
+    };
+  Filler fill_odometry = [&odometry](int seq, cyberdogapp::Telemetry * telemetry) {
+      odometry.header.stamp.sec = seq;
+      app_msg::fill(odometry, telemetry->mutable_odom_out());
+    };
+  Filler fill_path = [&path](int seq, cyberdogapp::Telemetry * telemetry) {
+      path.header.stamp.sec = seq;
+      app_msg::fill(path, telemetry->mutable_path());
+    };
+
+  // A new stream keeps what it writes for its first seconds, a running robot is past them
+  // Past the last sequence number, the app does not record them
+  status.posestamped.position_x = messages;
+  auto warm_end = Clock::now() + std::chrono::milliseconds(STREAM_WRITE_TIMEOUT_MS + 100);
+  while (Clock::now() < warm_end) {
+    ConvertArena arena;
+    auto telemetry = arena.create<cyberdogapp::Telemetry>();
+    app_msg::fill(status, telemetry->mutable_status());
+    std::vector<cyberdogapp::Telemetry> unconfirmed;
+    telemetry_stream.write(*telemetry, unconfirmed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::printf("%d messages, %s\n", messages,
+    rate_hz > 0 ? (std::to_string(rate_hz) + " Hz").c_str() : "as fast as possible");
+  std::printf("== status\n");
+  run(
+    "unary", messages, rate_hz, fill_status,
+    unary(
+      stub.get(), &cyberdogapp::CyberdogApp::Stub::subscribeStatus,
+      &cyberdogapp::Telemetry::status));
+  run("stream", messages, rate_hz, fill_status, stream(&telemetry_stream));
+  std::printf("== odometry\n");
+  run(
+    "unary", messages, rate_hz, fill_odometry,
+    unary(
+      stub.get(), &cyberdogapp::CyberdogApp::Stub::subscribeOdomOut,
+      &cyberdogapp::Telemetry::odom_out));
+  run("stream", messages, rate_hz, fill_odometry, stream(&telemetry_stream));
+  std::printf("== path, %d poses\n", BENCH_PATH_POSES);
+  run(
+    "unary", std::max(1, messages / 10), rate_hz, fill_path,
+    unary(
+      stub.get(), &cyberdogapp::CyberdogApp::Stub::subscribePath,
+      &cyberdogapp::Telemetry::path));
+  run("stream", std::max(1, messages / 10), rate_hz, fill_path, stream(&telemetry_stream));
+
+  telemetry_stream.cancel();
+  server->Shutdown();
+  return 0;
+}
@@ -20,9 +20,10 @@
 #include <mutex>
 #include <string>
 #include <thread>
-#include <future>
 #include <chrono>
+#include <condition_variable>
 
+#include "cyberdog_utils/goal_worker_pool.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 
@@ -48,6 +49,11 @@ public:
   // ExecuteCallback.
   typedef std::function<void ()> CompletionCallback;
 
+  // Callback function called on every preemption, cancellation and
+  // completion, from the thread causing it. Used to wake up event driven
+  // loops which do not block in wait_for_event.
+  typedef std::function<void ()> EventCallback;
+
   /**
    * @brief An constructor for ActionServer
    * @param node Ptr to node to make actions
@@ -88,6 +94,17 @@ public:
     }
   }
 
+  /**
+   * @brief Wait for goal execution to finish, it runs on a shared worker
+   */
+  ~ActionServer()
+  {
+    std::unique_lock<std::recursive_mutex> lock(update_mutex_);
+    stop_execution_ = true;
+    notify_event();
+    event_cv_.wait(lock, [this]() {return !running_;});
+  }
+
   /**
    * @brief handle the goal requested: accept or reject. This implementation always accepts.
    * @param uuid Goal ID
@@ -137,6 +154,9 @@ public:
     }
 
     debug_msg("Received request for goal cancellation");
+    // Handle turns to canceling after this returns, remember it for waiters woken now
+    cancel_accepted_ = handle;
+    notify_event();
     return rclcpp_action::CancelResponse::ACCEPT;
   }
 
@@ -165,6 +185,7 @@ public:
       }
       pending_handle_ = handle;
       preempt_requested_ = true;
+      notify_event();
     } else {
       if (is_active(pending_handle_)) {
         // Shouldn't reach a state with a pending goal but no current one.
@@ -175,9 +196,10 @@ public:
 
       current_handle_ = handle;
 
-      // Return quickly to avoid blocking the executor, so spin up a new thread
+      // Return quickly to avoid blocking the executor, run on a pooled worker
       debug_msg("Executing goal asynchronously.");
-      execution_future_ = std::async(std::launch::async, [this]() {work();});
+      running_ = true;
+      GoalWorkerPool::instance().post([this]() {work();});
     }
   }
 
@@ -191,44 +213,58 @@ public:
       return;
     }
 
-    while (rclcpp::ok() && !stop_execution_ && is_active(current_handle_)) {
-      debug_msg("Executing the goal...");
-      try {
-        execute_callback_();
-      } catch (std::exception & ex) {
-        RCLCPP_ERROR(
-          node_logging_interface_->get_logger(),
-          "Action server failed while executing action callback: \"%s\"", ex.what());
-        terminate_all();
-        completion_callback_();
-        return;
+    while (true) {
+      while (rclcpp::ok() && !stop_execution_ && is_active(current_handle_)) {
+        debug_msg("Executing the goal...");
+        try {
+          execute_callback_();
+        } catch (std::exception & ex) {
+          RCLCPP_ERROR(
+            node_logging_interface_->get_logger(),
+            "Action server failed while executing action callback: \"%s\"", ex.what());
+          terminate_all();
+          completion_callback_();
+          break;
+        }
+
+        debug_msg("Blocking processing of new goal handles.");
+        std::lock_guard<std::recursive_mutex> lock(update_mutex_);
+
+        if (stop_execution_) {
+          warn_msg("Stopping the thread per request.");
+          terminate_all();
+          completion_callback_();
+          break;
+        }
+
+        if (is_active(current_handle_)) {
+          warn_msg("Current goal was not completed successfully.");
+          terminate(current_handle_);
+          completion_callback_();
+        }
+
+        if (is_active(pending_handle_)) {
+          debug_msg("Executing a pending handle on the existing thread.");
+          accept_pending_goal();
+        } else {
+          debug_msg("Done processing available goals.");
+          break;
+        }
       }
 
-      debug_msg("Blocking processing of new goal handles.");
+      // A goal accepted after the last check is pending on this worker, take it here
       std::lock_guard<std::recursive_mutex> lock(update_mutex_);
-
-      if (stop_execution_) {
-        warn_msg("Stopping the thread per request.");
-        terminate_all();
-        completion_callback_();
-        break;
-      }
-
-      if (is_active(current_handle_)) {
-        warn_msg("Current goal was not completed successfully.");
-        terminate(current_handle_);
-        completion_callback_();
-      }
-
-      if (is_active(pending_handle_)) {
-        debug_msg("Executing a pending handle on the existing thread.");
+      if (rclcpp::ok() && !stop_execution_ && is_active(pending_handle_)) {
+        debug_msg("Executing a goal received while finishing.");
         accept_pending_goal();
-      } else {
-        debug_msg("Done processing available goals.");
-        break;
+        continue;
       }
+      // Server may be destroyed as soon as it is not running
+      debug_msg("Worker thread done.");
+      running_ = false;
+      notify_event();
+      break;
     }
-    debug_msg("Worker thread done.");
   }
 
   /**
@@ -258,31 +294,22 @@ public:
 
     debug_msg("Deactivating...");
 
-    {
-      std::lock_guard<std::recursive_mutex> lock(update_mutex_);
-      server_active_ = false;
-      stop_execution_ = true;
-    }
-
-    if (!execution_future_.valid()) {
-      return;
-    }
+    std::unique_lock<std::recursive_mutex> lock(update_mutex_);
+    server_active_ = false;
+    stop_execution_ = true;
+    notify_event();
 
-    if (is_running()) {
+    if (running_) {
       warn_msg(
         "Requested to deactivate server but goal is still executing."
         " Should check if action server is running before deactivating.");
+      info_msg("Waiting for async process to finish.");
     }
 
-    using namespace std::chrono;  //NOLINT
-    auto start_time = steady_clock::now();
-    while (execution_future_.wait_for(milliseconds(100)) != std::future_status::ready) {
-      info_msg("Waiting for async process to finish.");
-      if (steady_clock::now() - start_time >= server_timeout_) {
-        terminate_all();
-        completion_callback_();
-        throw std::runtime_error("Action callback is still running and missed deadline to stop");
-      }
+    if (!event_cv_.wait_for(lock, server_timeout_, [this]() {return !running_;})) {
+      terminate_all();
+      completion_callback_();
+      throw std::runtime_error("Action callback is still running and missed deadline to stop");
     }
 
     debug_msg("Deactivation completed.");
@@ -299,9 +326,51 @@ public:
       return false;
     }
 
-    return execution_future_.valid() &&
-           (execution_future_.wait_for(std::chrono::milliseconds(0)) ==
-           std::future_status::timeout);
+    std::lock_guard<std::recursive_mutex> lock(update_mutex_);
+    return running_;
+  }
+
+  /**
+   * @brief Block until goals change since last call: preemption, cancellation,
+   * completion or stop. Used by execute callback in place of a fixed rate
+   * sleep. Must not be called with update_mutex_ held.
+   * @param timeout Longest time to wait
+   * @return bool True if woken by a change, false on timeout
+   */
+  template<typename Rep, typename Period>
+  bool wait_for_event(const std::chrono::duration<Rep, Period> & timeout)
+  {
+    if (!init_) {
+      std::cout << "Action server is not initialized yet" << std::endl;
+      return false;
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(update_mutex_);
+    bool rtn_ = event_cv_.wait_for(
+      lock, timeout, [this]() {return events_ != seen_events_;});
+    seen_events_ = events_;
+    return rtn_;
+  }
+
+  /**
+   * @brief Block until no goal is executing
+   * @param timeout Longest time to wait
+   * @return bool True if server is idle
+   */
+  template<typename Rep, typename Period>
+  bool wait_for_idle(const std::chrono::duration<Rep, Period> & timeout)
+  {
+    std::unique_lock<std::recursive_mutex> lock(update_mutex_);
+    return event_cv_.wait_for(lock, timeout, [this]() {return !running_;});
+  }
+
+  /**
+   * @brief Set callback called on every preemption, cancellation and completion
+   */
+  void set_event_callback(EventCallback event_callback)
+  {
+    std::lock_guard<std::recursive_mutex> lock(update_mutex_);
+    event_callback_ = event_callback;
   }
 
   /**
@@ -360,6 +429,7 @@ public:
     current_handle_ = pending_handle_;
     pending_handle_.reset();
     preempt_requested_ = false;
+    notify_event();
 
     debug_msg("Preempted goal");
 
@@ -385,6 +455,7 @@ public:
 
     terminate(pending_handle_);
     preempt_requested_ = false;
+    notify_event();
 
     debug_msg("Pending goal terminated");
   }
@@ -452,10 +523,10 @@ public:
     }
 
     if (pending_handle_ != nullptr) {
-      return pending_handle_->is_canceling();
+      return is_canceling(pending_handle_);
     }
 
-    return current_handle_->is_canceling();
+    return is_canceling(current_handle_);
   }
 
   /**
@@ -475,6 +546,7 @@ public:
     terminate(current_handle_, result);
     terminate(pending_handle_, result);
     preempt_requested_ = false;
+    notify_event();
   }
 
   /**
@@ -492,6 +564,7 @@ public:
 
     std::lock_guard<std::recursive_mutex> lock(update_mutex_);
     terminate(current_handle_, result);
+    notify_event();
   }
 
   /**
@@ -513,6 +586,7 @@ public:
       debug_msg("Setting succeed on current goal.");
       current_handle_->succeed(result);
       current_handle_.reset();
+      notify_event();
     }
   }
 
@@ -545,10 +619,16 @@ protected:
 
   ExecuteCallback execute_callback_;
   CompletionCallback completion_callback_;
-  std::future<void> execution_future_;
+  EventCallback event_callback_;
   bool stop_execution_{false};
 
   mutable std::recursive_mutex update_mutex_;
+  // Notified with update_mutex_ held on every change waited for
+  std::condition_variable_any event_cv_;
+  bool running_{false};
+  uint64_t events_{0};
+  uint64_t seen_events_{0};
+  std::weak_ptr<rclcpp_action::ServerGoalHandle<ActionT>> cancel_accepted_;
   bool server_active_{false};
   bool preempt_requested_{false};
   std::chrono::milliseconds server_timeout_;
@@ -577,6 +657,27 @@ protected:
     return handle != nullptr && handle->is_active();
   }
 
+  /**
+   * @brief Whether a goal is canceling or its cancellation is being accepted
+   */
+  bool is_canceling(const std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>> handle) const
+  {
+    return handle->is_canceling() ||
+           (handle->is_active() && cancel_accepted_.lock() == handle);
+  }
+
+  /**
+   * @brief Wake up waiters, update_mutex_ must be held
+   */
+  void notify_event()
+  {
+    events_++;
+    event_cv_.notify_all();
+    if (event_callback_) {
+      event_callback_();
+    }
+  }
+
   /**
    * @brief Terminate a particular action with a result
    * @param handle goal handle to terminate
@@ -0,0 +1,66 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CYBERDOG_UTILS__GOAL_WORKER_POOL_HPP_
+#define CYBERDOG_UTILS__GOAL_WORKER_POOL_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cyberdog_utils
+{
+/**
+* @class cyberdog_utils::GoalWorkerPool
+* @brief Worker threads shared by all action servers of a process.
+* Goals may block for seconds, so a task never waits for a busy worker:
+* an idle worker is reused, otherwise a new one is started and kept.
+*/
+class GoalWorkerPool
+{
+public:
+  /**
+   * @brief Pool of this process
+   */
+  static GoalWorkerPool & instance();
+
+  ~GoalWorkerPool();
+
+  /**
+   * @brief Run task on an idle worker, returns immediately
+   */
+  void post(std::function<void()> task);
+
+  /**
+   * @brief Number of started workers
+   */
+  size_t size();
+
+private:
+  GoalWorkerPool() = default;
+  void worker();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> workers_;
+  size_t idle_{0};
+  bool running_{true};
+};
+}  // namespace cyberdog_utils
+
+#endif  // CYBERDOG_UTILS__GOAL_WORKER_POOL_HPP_
@@ -0,0 +1,134 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CYBERDOG_UTILS__IMAGE_RING_HPP_
+#define CYBERDOG_UTILS__IMAGE_RING_HPP_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace cyberdog_utils
+{
+// Frames of the main camera rgb stream
+constexpr char CAMERA_RGB_RING[] = "/cyberdog_camera_rgb";
+// Readers one ring can have open at the same time
+constexpr int IMAGE_RING_READERS = 8;
+
+enum ImageFormat : uint32_t
+{
+  IMAGE_JPEG = 0,
+  IMAGE_BGR8 = 1,
+  IMAGE_RGB8 = 2,
+  IMAGE_MONO8 = 3
+};
+
+/**
+* @brief Description of one image in the ring, data follows it
+*/
+struct ImageFrame
+{
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t step;
+  uint32_t size;
+  int32_t sec;
+  uint32_t nanosec;
+  char frame_id[64];
+};
+
+struct ImageRingShared;
+
+/**
+* @class cyberdog_utils::ImageRing
+* @brief Ring of images in POSIX shared memory, one producer and any number
+* of reader processes. An image is copied once into the ring by the producer
+* and readers use it in place, each slot is guarded by a sequence counter so
+* a reader finds out if the producer overwrote the slot meanwhile.
+* The producer skips writing while no reader has the ring open. Each reader
+* holds a slot with its pid, slots of dead processes are freed by
+* has_readers(), so readers must share the pid namespace of the producer.
+* The ring is only accessible to the user of the producer and is removed
+* when the producer goes away.
+*/
+class ImageRing
+{
+public:
+  using Consumer = std::function<void (const ImageFrame & frame, const uint8_t * data)>;
+
+  /**
+   * @brief Create ring as producer, an existing ring of the name is replaced
+   * @return nullptr on failure
+   */
+  static std::unique_ptr<ImageRing> create(
+    const std::string & name, uint32_t slots, size_t slot_size);
+
+  /**
+   * @brief Open ring of a producer as reader
+   * @return nullptr if there is no such ring or all reader slots are taken
+   */
+  static std::unique_ptr<ImageRing> open(const std::string & name);
+
+  ~ImageRing();
+  ImageRing(const ImageRing &) = delete;
+  ImageRing & operator=(const ImageRing &) = delete;
+
+  /**
+   * @brief Producer only, copy an image into the next slot
+   * @return False if image does not fit a slot
+   */
+  bool write(const ImageFrame & frame, const void * data);
+
+  /**
+   * @brief Reader only, call consumer with the latest image in place
+   * @param index Set to index of the image, compare with written() for new ones
+   * @return False if there is no image yet or the producer overwrote it
+   * while consumer ran, anything consumer produced is invalid then
+   */
+  bool read_latest(const Consumer & consumer, uint64_t * index = nullptr);
+
+  // Images written since the ring was created
+  uint64_t written() const;
+  // Any live reader, frees slots of readers that died
+  bool has_readers() const;
+  size_t slot_size() const;
+
+  /**
+   * @brief True if a producer has created a new ring of the name since
+   */
+  bool stale() const;
+
+private:
+  ImageRing(
+    const std::string & name, int fd, void * base, size_t length, bool producer, ino_t inode,
+    int reader_slot);
+  uint8_t * slot(uint64_t index) const;
+
+  std::string name_;
+  int fd_;
+  void * base_;
+  size_t length_;
+  bool producer_;
+  ino_t inode_;
+  int reader_slot_;
+  ImageRingShared * shared_;
+};
+}  // namespace cyberdog_utils
+
+#endif  // CYBERDOG_UTILS__IMAGE_RING_HPP_
@@ -0,0 +1,177 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CYBERDOG_UTILS__LIFECYCLE_METRICS_HPP_
+#define CYBERDOG_UTILS__LIFECYCLE_METRICS_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cyberdog_utils
+{
+/// Longest activator name kept in a record, longer ones are truncated
+constexpr size_t METRICS_NAME_SIZE = 32;
+
+enum LifecycleCallbackType
+{
+  CALLBACK_CONFIGURE = 1,
+  CALLBACK_CLEANUP = 2,
+  CALLBACK_ACTIVATE = 3,
+  CALLBACK_DEACTIVATE = 4,
+  CALLBACK_SHUTDOWN = 5,
+  CALLBACK_ERROR = 6
+};
+
+enum TransitionCause
+{
+  // Lifecycle service or any caller outside cyberdog_utils::LifecycleNode
+  CAUSE_SERVICE = 0,
+  // trigger_transition of this node
+  CAUSE_REQUEST = 1,
+  // State change of an activator
+  CAUSE_CASCADE = 2,
+  // State change of dictator
+  CAUSE_DICTATOR = 3
+};
+
+/**
+ * @struct cyberdog_utils::TransitionMetric
+ * @brief Steady clock stamps of one transition, 0 if not reached.
+ * request_ns equals start_ns if request is not seen by this node.
+ */
+struct TransitionMetric
+{
+  int64_t request_ns;
+  int64_t start_ns;
+  int64_t end_ns;
+  int64_t published_ns;
+  uint8_t callback;
+  uint8_t result;
+  uint8_t cause;
+  char activator[METRICS_NAME_SIZE];
+};
+
+/**
+ * @struct cyberdog_utils::ActivatorMetric
+ * @brief Arrival of one activator state
+ */
+struct ActivatorMetric
+{
+  int64_t stamp_ns;
+  uint8_t state;
+  char activator[METRICS_NAME_SIZE];
+};
+
+inline int64_t metrics_now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void metrics_copy_name(char (& dst)[METRICS_NAME_SIZE], const std::string & name)
+{
+  auto size = std::min(name.size(), METRICS_NAME_SIZE - 1);
+  std::memcpy(dst, name.data(), size);
+  dst[size] = '\0';
+}
+
+/**
+* @class cyberdog_utils::MetricsRing
+* @brief Fixed size ring keeping the latest N records. Any thread may push
+* without lock or allocation, oldest record is overwritten. Readers copy
+* records out and skip those being overwritten meanwhile.
+*/
+template<typename T, size_t N>
+class MetricsRing
+{
+  static_assert(std::is_trivially_copyable<T>::value, "Record must be trivially copyable");
+
+public:
+  MetricsRing()
+  : head_(0)
+  {
+    for (auto & slot : slots_) {
+      slot.sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void push(const T & record)
+  {
+    auto index = head_.fetch_add(1, std::memory_order_relaxed);
+    auto & slot = slots_[index % N];
+    // Odd while writing, 2 * (index + 1) once record of index is complete
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = record;
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Copy records pushed since cursor, at most the latest N
+   * @param out Records are appended to it
+   * @param cursor Updated to count of records pushed, start from 0
+   * @return Number of records lost, overwritten before reading
+   */
+  uint64_t read(std::vector<T> & out, uint64_t & cursor) const
+  {
+    auto head = head_.load(std::memory_order_acquire);
+    auto begin = std::max(cursor, head > N ? head - N : 0);
+    uint64_t lost = begin - std::min(cursor, begin);
+    for (auto index = begin; index < head; index++) {
+      const auto & slot = slots_[index % N];
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+      T record = slot.record;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence != 2 * index + 2 ||
+        slot.sequence.load(std::memory_order_relaxed) != sequence)
+      {
+        lost++;
+        continue;
+      }
+      out.push_back(record);
+    }
+    cursor = head;
+    return lost;
+  }
+
+  /**
+   * @brief Number of records pushed since creation
+   */
+  uint64_t count() const {return head_.load(std::memory_order_relaxed);}
+
+private:
+  struct Slot
+  {
+    std::atomic<uint64_t> sequence;
+    T record;
+  };
+
+  std::array<Slot, N> slots_;
+  std::atomic<uint64_t> head_;
+};
+
+constexpr size_t TRANSITION_METRICS_SIZE = 64;
+constexpr size_t ACTIVATOR_METRICS_SIZE = 256;
+using TransitionMetrics = MetricsRing<TransitionMetric, TRANSITION_METRICS_SIZE>;
+using ActivatorMetrics = MetricsRing<ActivatorMetric, ACTIVATOR_METRICS_SIZE>;
+}  // namespace cyberdog_utils
+
+#endif  // CYBERDOG_UTILS__LIFECYCLE_METRICS_HPP_
@@ -15,6 +15,8 @@
 #ifndef CYBERDOG_UTILS__LIFECYCLE_NODE_HPP_
 #define CYBERDOG_UTILS__LIFECYCLE_NODE_HPP_
 
+#include <chrono>
+#include <ostream>
 #include <set>
 #include <map>
 #include <string>
@@ -28,8 +30,10 @@
 
 #include "lifecycle_msgs/msg/state.hpp"
 #include "cascade_lifecycle_msgs/msg/activation.hpp"
+#include "cascade_lifecycle_msgs/msg/lifecycle_metric.hpp"
 #include "cascade_lifecycle_msgs/msg/state.hpp"
 #include "cyberdog_utils/Enums.hpp"
+#include "cyberdog_utils/lifecycle_metrics.hpp"
 
 #define ANSI_COLOR_RESET    "\x1b[0m"
 #define ANSI_COLOR_BLUE     "\x1b[34m"
@@ -39,6 +43,23 @@ namespace cyberdog_utils
 using CallbackReturn = rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn;
 using lifecycle_msgs::msg::State;
 
+/// Lease of cascade state writers, activator loss is reported after it expires
+constexpr std::chrono::milliseconds CASCADE_LEASE_DURATION(2000);
+
+/// QoS of cascade_lifecycle_states.
+/**
+ * States are published on transition only. Transient local keeps the last state
+ * of every node for late joiners, liveliness reports nodes which disappear.
+ */
+inline rclcpp::QoS cascade_states_qos()
+{
+  return rclcpp::QoS(100)
+         .reliable()
+         .transient_local()
+         .liveliness(RMW_QOS_POLICY_LIVELINESS_AUTOMATIC)
+         .liveliness_lease_duration(rclcpp::Duration(CASCADE_LEASE_DURATION));
+}
+
 class LifecycleNode : public rclcpp_lifecycle::LifecycleNode
 {
 public:
@@ -65,6 +86,12 @@ public:
     const std::string & namespace_,
     const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
 
+  ~LifecycleNode();
+
+  /// Same as rclcpp_lifecycle::LifecycleNode::trigger_transition, request time is recorded.
+  using rclcpp_lifecycle::LifecycleNode::trigger_transition;
+  const rclcpp_lifecycle::State & trigger_transition(uint8_t transition_id);
+
   void add_activation(const std::string & node_name);
   void remove_activation(const std::string & node_name);
   void remove_activation_pub(const std::string & node_name);
@@ -85,6 +112,18 @@ public:
    */
   bool auto_check(uint8_t check_type);
 
+  /// Latest transitions of this node, with request, callback and publish times
+  const TransitionMetrics & get_transition_metrics() const {return transition_metrics_;}
+  /// Latest state arrivals of activators of this node
+  const ActivatorMetrics & get_activator_metrics() const {return activator_metrics_;}
+  /// Write kept metrics as CSV for offline analysis.
+  /**
+   * \param[in] out : one line per record,
+   *   transition,node,callback,result,cause,activator,request_ns,start_ns,end_ns,published_ns
+   *   activator,node,state,activator,stamp_ns
+   */
+  void export_metrics(std::ostream & out) const;
+
 private:
   CallbackReturn
   on_configure_internal(const rclcpp_lifecycle::State & previous_state);
@@ -112,15 +151,36 @@ private:
   rclcpp::Subscription<cascade_lifecycle_msgs::msg::State>::SharedPtr states_sub_;
 
   rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::TimerBase::SharedPtr recheck_timer_;
+  rclcpp::Time recheck_start_;
 
   std::set<std::string> activators_;
   std::set<std::string> activations_;
   std::map<std::string, uint8_t> activators_state_;
+  // Last state of every cascade node, an activator added later starts from it
+  std::map<std::string, uint8_t> known_state_;
   bool governed;
 
+  // Metrics are pushed from transition and state callbacks without lock or allocation
+  TransitionMetrics transition_metrics_;
+  ActivatorMetrics activator_metrics_;
+  rclcpp_lifecycle::LifecyclePublisher<cascade_lifecycle_msgs::msg::LifecycleMetric>::SharedPtr
+    metrics_pub_;
+  rclcpp::TimerBase::SharedPtr metrics_timer_;
+  uint64_t transition_cursor_;
+  uint64_t activator_cursor_;
+  std::string metrics_file_;
+
+  TransitionMetric begin_transition(const uint8_t callback);
+  void end_transition(TransitionMetric & metric, const CallbackReturn ret, const uint8_t state);
+  void publish_metrics();
+
   void activations_callback(const cascade_lifecycle_msgs::msg::Activation::SharedPtr msg);
   void states_callback(const cascade_lifecycle_msgs::msg::State::SharedPtr msg);
   void update_state(const uint8_t state = lifecycle_msgs::msg::Transition::TRANSITION_CREATE);
+  void publish_state(const uint8_t state);
+  bool check_activators();
+  void recheck_activators();
   void timer_callback();
   void message(const std::string & msg)
   {
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+
+#include <string>
+#include <utility>
+
+#include "cyberdog_utils/goal_worker_pool.hpp"
+
+namespace cyberdog_utils
+{
+
+GoalWorkerPool & GoalWorkerPool::instance()
+{
+  static GoalWorkerPool pool;
+  return pool;
+}
+
+GoalWorkerPool::~GoalWorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cv_.notify_all();
+  for (auto & worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+void GoalWorkerPool::post(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    if (tasks_.size() > idle_) {
+      workers_.emplace_back(&GoalWorkerPool::worker, this);
+      return;
+    }
+  }
+  cv_.notify_one();
+}
+
+size_t GoalWorkerPool::size()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return workers_.size();
+}
+
+void GoalWorkerPool::worker()
+{
+  auto name = std::string("goal_worker_") + std::to_string(size());
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    idle_++;
+    cv_.wait(lock, [this]() {return !running_ || !tasks_.empty();});
+    idle_--;
+    if (tasks_.empty()) {
+      break;
+    }
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+}  // namespace cyberdog_utils
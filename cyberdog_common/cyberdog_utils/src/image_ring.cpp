@@ -0,0 +1,257 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "cyberdog_utils/image_ring.hpp"
+
+namespace cyberdog_utils
+{
+namespace
+{
+const uint32_t RING_MAGIC = 0x32524d49;  // "IMR2"
+const size_t RING_ALIGN = 64;
+// Only producer and its owner may map the frames
+const mode_t RING_MODE = 0600;
+
+size_t align_up(size_t size)
+{
+  return (size + RING_ALIGN - 1) / RING_ALIGN * RING_ALIGN;
+}
+
+bool process_alive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+struct SlotHeader
+{
+  // Odd while producer writes the slot
+  std::atomic<uint64_t> sequence;
+  ImageFrame frame;
+};
+}  // namespace
+
+struct ImageRingShared
+{
+  std::atomic<uint32_t> magic;
+  uint32_t slots;
+  uint64_t slot_size;
+  uint64_t slot_stride;
+  std::atomic<uint64_t> written;
+  // Pid of the process holding each reader slot, 0 for a free slot
+  std::atomic<int32_t> readers[IMAGE_RING_READERS];
+};
+
+ImageRing::ImageRing(
+  const std::string & name, int fd, void * base, size_t length, bool producer, ino_t inode,
+  int reader_slot)
+: name_(name), fd_(fd), base_(base), length_(length), producer_(producer), inode_(inode),
+  reader_slot_(reader_slot), shared_(static_cast<ImageRingShared *>(base))
+{
+}
+
+ImageRing::~ImageRing()
+{
+  if (producer_) {
+    // Leave a ring of a newer producer of the name alone
+    if (!stale()) {
+      shm_unlink(name_.c_str());
+    }
+  } else {
+    shared_->readers[reader_slot_].store(0, std::memory_order_release);
+  }
+  munmap(base_, length_);
+  close(fd_);
+}
+
+std::unique_ptr<ImageRing> ImageRing::create(
+  const std::string & name, uint32_t slots, size_t slot_size)
+{
+  if (slots == 0) {
+    return nullptr;
+  }
+  // Readers of a previous producer keep their mapping and see it is stale
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, RING_MODE);
+  if (fd < 0) {
+    return nullptr;
+  }
+  size_t stride = align_up(sizeof(SlotHeader)) + align_up(slot_size);
+  size_t length = align_up(sizeof(ImageRingShared)) + stride * slots;
+  struct stat st;
+  if (ftruncate(fd, length) != 0 || fstat(fd, &st) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  void * base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  auto shared = new (base) ImageRingShared;
+  shared->slots = slots;
+  shared->slot_size = slot_size;
+  shared->slot_stride = stride;
+  shared->written.store(0);
+  for (auto & reader : shared->readers) {
+    reader.store(0);
+  }
+  std::unique_ptr<ImageRing> ring(new ImageRing(name, fd, base, length, true, st.st_ino, -1));
+  for (uint32_t i = 0; i < slots; i++) {
+    new (ring->slot(i)) SlotHeader;
+    reinterpret_cast<SlotHeader *>(ring->slot(i))->sequence.store(0);
+  }
+  shared->magic.store(RING_MAGIC, std::memory_order_release);
+  return ring;
+}
+
+std::unique_ptr<ImageRing> ImageRing::open(const std::string & name)
+{
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ImageRingShared)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t length = st.st_size;
+  void * base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+  auto shared = static_cast<ImageRingShared *>(base);
+  if (shared->magic.load(std::memory_order_acquire) != RING_MAGIC ||
+    align_up(sizeof(ImageRingShared)) + shared->slot_stride * shared->slots > length)
+  {
+    munmap(base, length);
+    close(fd);
+    return nullptr;
+  }
+  int32_t pid = getpid();
+  for (int i = 0; i < IMAGE_RING_READERS; i++) {
+    int32_t free_slot(0);
+    if (shared->readers[i].compare_exchange_strong(free_slot, pid)) {
+      return std::unique_ptr<ImageRing>(
+        new ImageRing(name, fd, base, length, false, st.st_ino, i));
+    }
+  }
+  munmap(base, length);
+  close(fd);
+  return nullptr;
+}
+
+uint8_t * ImageRing::slot(uint64_t index) const
+{
+  return static_cast<uint8_t *>(base_) + align_up(sizeof(ImageRingShared)) +
+         shared_->slot_stride * (index % shared_->slots);
+}
+
+bool ImageRing::write(const ImageFrame & frame, const void * data)
+{
+  if (!producer_ || frame.size > shared_->slot_size) {
+    return false;
+  }
+  auto index = shared_->written.load(std::memory_order_relaxed);
+  auto header = reinterpret_cast<SlotHeader *>(slot(index));
+  auto sequence = header->sequence.load(std::memory_order_relaxed);
+  header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&header->frame, &frame, sizeof(frame));
+  std::memcpy(slot(index) + align_up(sizeof(SlotHeader)), data, frame.size);
+  header->sequence.store(sequence + 2, std::memory_order_release);
+  shared_->written.store(index + 1, std::memory_order_release);
+  return true;
+}
+
+bool ImageRing::read_latest(const Consumer & consumer, uint64_t * index)
+{
+  auto written = shared_->written.load(std::memory_order_acquire);
+  if (written == 0) {
+    return false;
+  }
+  auto latest = written - 1;
+  auto header = reinterpret_cast<SlotHeader *>(slot(latest));
+  auto sequence = header->sequence.load(std::memory_order_acquire);
+  if (sequence & 1) {
+    return false;
+  }
+  ImageFrame frame;
+  std::memcpy(&frame, &header->frame, sizeof(frame));
+  if (frame.size > shared_->slot_size) {
+    return false;
+  }
+  frame.frame_id[sizeof(frame.frame_id) - 1] = '\0';
+  consumer(frame, slot(latest) + align_up(sizeof(SlotHeader)));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header->sequence.load(std::memory_order_relaxed) != sequence) {
+    return false;
+  }
+  if (index != nullptr) {
+    *index = latest;
+  }
+  return true;
+}
+
+uint64_t ImageRing::written() const
+{
+  return shared_->written.load(std::memory_order_acquire);
+}
+
+bool ImageRing::has_readers() const
+{
+  bool readers(false);
+  for (auto & reader : shared_->readers) {
+    int32_t pid = reader.load(std::memory_order_relaxed);
+    if (pid == 0) {
+      continue;
+    }
+    if (process_alive(pid)) {
+      readers = true;
+    } else {
+      // Reader died without closing the ring
+      reader.compare_exchange_strong(pid, 0);
+    }
+  }
+  return readers;
+}
+
+size_t ImageRing::slot_size() const
+{
+  return shared_->slot_size;
+}
+
+bool ImageRing::stale() const
+{
+  struct stat st;
+  auto path = std::string("/dev/shm") + name_;
+  return stat(path.c_str(), &st) != 0 || st.st_ino != inode_;
+}
+}  // namespace cyberdog_utils
@@ -13,8 +13,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
+#include <fstream>
 #include <string>
 #include <set>
+#include <unordered_set>
+#include <vector>
 
 #include "cyberdog_utils/lifecycle_node.hpp"
 #include "rclcpp_lifecycle/node_interfaces/lifecycle_node_interface.hpp"
@@ -26,6 +30,25 @@ namespace cyberdog_utils  // Modified from rclcpp_cascade_lifecycle
 
 using namespace std::chrono_literals;
 
+namespace
+{
+/// Request seen by the thread running the transition, transitions run on the requesting thread
+struct PendingTransition
+{
+  int64_t request_ns{0};
+  uint8_t cause{CAUSE_SERVICE};
+  char activator[METRICS_NAME_SIZE]{};
+};
+thread_local PendingTransition pending_transition;
+
+void set_pending(const uint8_t cause, const std::string & activator)
+{
+  pending_transition.request_ns = metrics_now_ns();
+  pending_transition.cause = cause;
+  metrics_copy_name(pending_transition.activator, activator);
+}
+}  // namespace
+
 LifecycleNode::LifecycleNode(
   const std::string & node_name,
   const rclcpp::NodeOptions & options)
@@ -43,7 +66,9 @@ LifecycleNode::LifecycleNode(
     node_name,
     namespace_,
     options),
-  governed(false)
+  governed(false),
+  transition_cursor_(0),
+  activator_cursor_(0)
 {
   using std::placeholders::_1;
   using namespace std::chrono_literals;
@@ -52,25 +77,52 @@ LifecycleNode::LifecycleNode(
     "cascade_lifecycle_activations",
     rclcpp::QoS(1000).keep_all().transient_local().reliable());
 
+  // Each node only publishes its own state, history 1 is the latest one
   states_pub_ = create_publisher<cascade_lifecycle_msgs::msg::State>(
-    "cascade_lifecycle_states", rclcpp::QoS(100));
+    "cascade_lifecycle_states", cascade_states_qos().keep_last(1));
 
   activations_sub_ = create_subscription<cascade_lifecycle_msgs::msg::Activation>(
     "cascade_lifecycle_activations",
     rclcpp::QoS(1000).keep_all().transient_local().reliable(),
     std::bind(&LifecycleNode::activations_callback, this, _1));
 
+  // Writer lost or gone means some cascade node left, check activators then
+  rclcpp::SubscriptionOptions states_options;
+  states_options.event_callbacks.liveliness_callback =
+    [this](rclcpp::QOSLivelinessChangedInfo & event) {
+      if (event.alive_count_change < 0 || event.not_alive_count_change > 0) {
+        recheck_activators();
+      }
+    };
   states_sub_ = create_subscription<cascade_lifecycle_msgs::msg::State>(
     "cascade_lifecycle_states",
-    rclcpp::QoS(100),
-    std::bind(&LifecycleNode::states_callback, this, _1));
+    cascade_states_qos(),
+    std::bind(&LifecycleNode::states_callback, this, _1),
+    states_options);
+
+  // Periodic state broadcast is optional, 0 means transitions only
+  auto heartbeat_ms = this->declare_parameter("cascade_heartbeat_ms", 0);
+  if (heartbeat_ms > 0) {
+    timer_ = create_wall_timer(
+      std::chrono::milliseconds(heartbeat_ms),
+      std::bind(&LifecycleNode::timer_callback, this));
+  }
 
-  timer_ = create_wall_timer(
-    500ms,
-    std::bind(&LifecycleNode::timer_callback, this));
+  // Metrics are always collected, publishing and exporting are optional
+  auto metrics_ms = this->declare_parameter("lifecycle_metrics_period_ms", 0);
+  metrics_file_ = this->declare_parameter("lifecycle_metrics_file", std::string(""));
+  if (metrics_ms > 0) {
+    metrics_pub_ = create_publisher<cascade_lifecycle_msgs::msg::LifecycleMetric>(
+      "lifecycle_metrics", rclcpp::QoS(100).reliable());
+    metrics_pub_->on_activate();
+    metrics_timer_ = create_wall_timer(
+      std::chrono::milliseconds(metrics_ms),
+      std::bind(&LifecycleNode::publish_metrics, this));
+  }
 
   activations_pub_->on_activate();
   states_pub_->on_activate();
+  publish_state(get_current_state().id());
 
   register_on_configure(
     std::bind(
@@ -103,6 +155,29 @@ LifecycleNode::LifecycleNode(
       this, std::placeholders::_1));
 }
 
+LifecycleNode::~LifecycleNode()
+{
+  if (!metrics_file_.empty()) {
+    std::ofstream file(metrics_file_, std::ios::app);
+    export_metrics(file);
+  }
+}
+
+const rclcpp_lifecycle::State &
+LifecycleNode::trigger_transition(uint8_t transition_id)
+{
+  // Cascade and dictator requests are stamped at state arrival already
+  bool own_request = pending_transition.request_ns == 0;
+  if (own_request) {
+    set_pending(CAUSE_REQUEST, std::string());
+  }
+  const auto & state = rclcpp_lifecycle::LifecycleNode::trigger_transition(transition_id);
+  if (own_request) {
+    pending_transition.request_ns = 0;
+  }
+  return state;
+}
+
 void
 LifecycleNode::activations_callback(
   const cascade_lifecycle_msgs::msg::Activation::SharedPtr msg)
@@ -115,7 +190,14 @@ LifecycleNode::activations_callback(
       } else if (msg->activation == get_name()) {
         activators_.insert(msg->activator);
         if (activators_state_.find(msg->activator) == activators_state_.end()) {
-          activators_state_[msg->activator] = lifecycle_msgs::msg::State::PRIMARY_STATE_UNKNOWN;
+          auto known = known_state_.find(msg->activator);
+          activators_state_[msg->activator] = known == known_state_.end() ?
+            lifecycle_msgs::msg::State::PRIMARY_STATE_UNKNOWN : known->second;
+          if (known != known_state_.end() && !governed) {
+            set_pending(CAUSE_CASCADE, msg->activator);
+            update_state();
+            pending_transition.request_ns = 0;
+          }
         }
       }
       break;
@@ -153,15 +235,30 @@ LifecycleNode::activations_callback(
 void
 LifecycleNode::states_callback(const cascade_lifecycle_msgs::msg::State::SharedPtr msg)
 {
-  if (activators_state_.find(msg->node_name) != activators_state_.end() && !governed) {
-    if (activators_state_[msg->node_name] != msg->state) {
-      activators_state_[msg->node_name] = msg->state;
+  known_state_[msg->node_name] = msg->state;
+
+  auto activator = activators_state_.find(msg->node_name);
+  if (activator != activators_state_.end() && activator->second != msg->state) {
+    ActivatorMetric metric;
+    metric.stamp_ns = metrics_now_ns();
+    metric.state = msg->state;
+    metrics_copy_name(metric.activator, msg->node_name);
+    activator_metrics_.push(metric);
+  }
+
+  if (activator != activators_state_.end() && !governed) {
+    if (activator->second != msg->state) {
+      activator->second = msg->state;
+      set_pending(CAUSE_CASCADE, msg->node_name);
       update_state();
+      pending_transition.request_ns = 0;
     }
   }
 
   if (msg->node_name == dictator_ && governed) {
+    set_pending(CAUSE_DICTATOR, msg->node_name);
     update_state(msg->state);
+    pending_transition.request_ns = 0;
   }
 }
 
@@ -226,17 +323,9 @@ CallbackReturn
 LifecycleNode::on_configure_internal(
   const rclcpp_lifecycle::State & previous_state)
 {
-  cascade_lifecycle_msgs::msg::State msg;
-
+  auto metric = begin_transition(CALLBACK_CONFIGURE);
   auto ret = on_configure(previous_state);
-
-  if (ret == CallbackReturn::SUCCESS) {
-    cascade_lifecycle_msgs::msg::State msg;
-    msg.state = lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE;
-    msg.node_name = get_name();
-
-    states_pub_->publish(msg);
-  }
+  end_transition(metric, ret, lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE);
 
   return ret;
 }
@@ -245,17 +334,9 @@ CallbackReturn
 LifecycleNode::on_cleanup_internal(
   const rclcpp_lifecycle::State & previous_state)
 {
-  cascade_lifecycle_msgs::msg::State msg;
-
+  auto metric = begin_transition(CALLBACK_CLEANUP);
   auto ret = on_cleanup(previous_state);
-
-  if (ret == CallbackReturn::SUCCESS) {
-    cascade_lifecycle_msgs::msg::State msg;
-    msg.state = lifecycle_msgs::msg::State::PRIMARY_STATE_UNCONFIGURED;
-    msg.node_name = get_name();
-
-    states_pub_->publish(msg);
-  }
+  end_transition(metric, ret, lifecycle_msgs::msg::State::PRIMARY_STATE_UNCONFIGURED);
 
   return ret;
 }
@@ -264,17 +345,9 @@ CallbackReturn
 LifecycleNode::on_shutdown_internal(
   const rclcpp_lifecycle::State & previous_state)
 {
-  cascade_lifecycle_msgs::msg::State msg;
-
+  auto metric = begin_transition(CALLBACK_SHUTDOWN);
   auto ret = on_shutdown(previous_state);
-
-  if (ret == CallbackReturn::SUCCESS) {
-    cascade_lifecycle_msgs::msg::State msg;
-    msg.state = lifecycle_msgs::msg::State::PRIMARY_STATE_FINALIZED;
-    msg.node_name = get_name();
-
-    states_pub_->publish(msg);
-  }
+  end_transition(metric, ret, lifecycle_msgs::msg::State::PRIMARY_STATE_FINALIZED);
 
   return ret;
 }
@@ -283,17 +356,9 @@ CallbackReturn
 LifecycleNode::on_activate_internal(
   const rclcpp_lifecycle::State & previous_state)
 {
-  cascade_lifecycle_msgs::msg::State msg;
-
+  auto metric = begin_transition(CALLBACK_ACTIVATE);
   auto ret = on_activate(previous_state);
-
-  if (ret == CallbackReturn::SUCCESS) {
-    cascade_lifecycle_msgs::msg::State msg;
-    msg.state = lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE;
-    msg.node_name = get_name();
-
-    states_pub_->publish(msg);
-  }
+  end_transition(metric, ret, lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE);
 
   return ret;
 }
@@ -302,17 +367,9 @@ CallbackReturn
 LifecycleNode::on_deactivate_internal(
   const rclcpp_lifecycle::State & previous_state)
 {
-  cascade_lifecycle_msgs::msg::State msg;
-
+  auto metric = begin_transition(CALLBACK_DEACTIVATE);
   auto ret = on_deactivate(previous_state);
-
-  if (ret == CallbackReturn::SUCCESS) {
-    cascade_lifecycle_msgs::msg::State msg;
-    msg.state = lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE;
-    msg.node_name = get_name();
-
-    states_pub_->publish(msg);
-  }
+  end_transition(metric, ret, lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE);
 
   return ret;
 }
@@ -321,17 +378,9 @@ CallbackReturn
 LifecycleNode::on_error_internal(
   const rclcpp_lifecycle::State & previous_state)
 {
-  cascade_lifecycle_msgs::msg::State msg;
-
+  auto metric = begin_transition(CALLBACK_ERROR);
   auto ret = on_error(previous_state);
-
-  if (ret == CallbackReturn::SUCCESS) {
-    cascade_lifecycle_msgs::msg::State msg;
-    msg.state = lifecycle_msgs::msg::State::PRIMARY_STATE_FINALIZED;
-    msg.node_name = get_name();
-
-    states_pub_->publish(msg);
-  }
+  end_transition(metric, ret, lifecycle_msgs::msg::State::PRIMARY_STATE_FINALIZED);
 
   return ret;
 }
@@ -404,39 +453,173 @@ LifecycleNode::update_state(const uint8_t state)
   }
 }
 
+TransitionMetric
+LifecycleNode::begin_transition(const uint8_t callback)
+{
+  TransitionMetric metric;
+  metric.start_ns = metrics_now_ns();
+  metric.end_ns = 0;
+  metric.published_ns = 0;
+  metric.callback = callback;
+  metric.result = 0;
+  if (pending_transition.request_ns != 0) {
+    metric.request_ns = pending_transition.request_ns;
+    metric.cause = pending_transition.cause;
+    std::memcpy(metric.activator, pending_transition.activator, METRICS_NAME_SIZE);
+    // Transitions triggered inside the callback are requests of their own
+    pending_transition.request_ns = 0;
+  } else {
+    metric.request_ns = metric.start_ns;
+    metric.cause = CAUSE_SERVICE;
+    metric.activator[0] = '\0';
+  }
+  return metric;
+}
+
 void
-LifecycleNode::timer_callback()
+LifecycleNode::end_transition(
+  TransitionMetric & metric, const CallbackReturn ret, const uint8_t state)
+{
+  metric.end_ns = metrics_now_ns();
+  metric.result = static_cast<uint8_t>(ret);
+  if (ret == CallbackReturn::SUCCESS) {
+    publish_state(state);
+    metric.published_ns = metrics_now_ns();
+  }
+  transition_metrics_.push(metric);
+}
+
+void
+LifecycleNode::publish_metrics()
+{
+  std::vector<TransitionMetric> transitions;
+  std::vector<ActivatorMetric> activators;
+  transition_metrics_.read(transitions, transition_cursor_);
+  activator_metrics_.read(activators, activator_cursor_);
+
+  cascade_lifecycle_msgs::msg::LifecycleMetric msg;
+  msg.node_name = get_name();
+  msg.type = cascade_lifecycle_msgs::msg::LifecycleMetric::TRANSITION;
+  for (const auto & metric : transitions) {
+    msg.id = metric.callback;
+    msg.result = metric.result;
+    msg.cause = metric.cause;
+    msg.activator = metric.activator;
+    msg.request_ns = metric.request_ns;
+    msg.start_ns = metric.start_ns;
+    msg.end_ns = metric.end_ns;
+    msg.published_ns = metric.published_ns;
+    metrics_pub_->publish(msg);
+  }
+  msg.type = cascade_lifecycle_msgs::msg::LifecycleMetric::ACTIVATOR;
+  msg.result = 0;
+  msg.cause = 0;
+  msg.start_ns = msg.end_ns = msg.published_ns = 0;
+  for (const auto & metric : activators) {
+    msg.id = metric.state;
+    msg.activator = metric.activator;
+    msg.request_ns = metric.stamp_ns;
+    metrics_pub_->publish(msg);
+  }
+}
+
+void
+LifecycleNode::export_metrics(std::ostream & out) const
+{
+  std::vector<TransitionMetric> transitions;
+  std::vector<ActivatorMetric> activators;
+  uint64_t cursor(0);
+  transition_metrics_.read(transitions, cursor);
+  cursor = 0;
+  activator_metrics_.read(activators, cursor);
+
+  for (const auto & metric : transitions) {
+    out << "transition," << get_name() << "," << int(metric.callback) << "," <<
+      int(metric.result) << "," << int(metric.cause) << "," << metric.activator << "," <<
+      metric.request_ns << "," << metric.start_ns << "," << metric.end_ns << "," <<
+      metric.published_ns << "\n";
+  }
+  for (const auto & metric : activators) {
+    out << "activator," << get_name() << "," << int(metric.state) << "," <<
+      metric.activator << "," << metric.stamp_ns << "\n";
+  }
+  out.flush();
+}
+
+void
+LifecycleNode::publish_state(const uint8_t state)
+{
+  cascade_lifecycle_msgs::msg::State msg;
+  msg.state = state;
+  msg.node_name = get_name();
+
+  states_pub_->publish(msg);
+}
+
+void
+LifecycleNode::recheck_activators()
+{
+  // Graph may lag behind the writer loss, keep checking within one lease
+  if (check_activators() || recheck_timer_) {
+    return;
+  }
+  recheck_start_ = now();
+  recheck_timer_ = create_wall_timer(
+    250ms,
+    [this]() {
+      if (check_activators() ||
+      now() - recheck_start_ >= rclcpp::Duration(CASCADE_LEASE_DURATION))
+      {
+        recheck_timer_->cancel();
+        recheck_timer_.reset();
+      }
+    });
+}
+
+bool
+LifecycleNode::check_activators()
 {
-  auto nodes = this->get_node_graph_interface()->get_node_names();
+  if (activators_.empty()) {
+    return false;
+  }
+  auto node_names = this->get_node_graph_interface()->get_node_names();
+  std::unordered_set<std::string> nodes(node_names.begin(), node_names.end());
   std::string ns = get_namespace();
   if (ns != std::string("/")) {
     ns = ns + std::string("/");
   }
 
+  std::vector<std::string> removed;
   std::set<std::string>::iterator it = activators_.begin();
   while (it != activators_.end()) {
     const auto & node_name = *it;
-    if (std::find(nodes.begin(), nodes.end(), ns + node_name) == nodes.end()) {
+    if (nodes.find(ns + node_name) == nodes.end()) {
       RCLCPP_DEBUG(
         get_logger(), "Activator %s is not longer present, removing from activators",
         node_name.c_str());
+      removed.push_back(node_name);
       it = activators_.erase(it);
-
-      if (get_current_state().id() == activators_state_[node_name]) {
-        update_state();
-      }
-      activators_state_.erase(node_name);
     } else {
       it++;
     }
   }
 
-  cascade_lifecycle_msgs::msg::State msg;
-  msg.state = get_current_state().id();
-  msg.node_name = get_name();
-
-  states_pub_->publish(msg);
+  for (const auto & node_name : removed) {
+    auto removed_state = activators_state_[node_name];
+    activators_state_.erase(node_name);
+    known_state_.erase(node_name);
+    if (get_current_state().id() == removed_state) {
+      update_state();
+    }
+  }
+  return !removed.empty();
+}
 
+void
+LifecycleNode::timer_callback()
+{
+  check_activators();
+  publish_state(get_current_state().id());
   update_state();
 }
 
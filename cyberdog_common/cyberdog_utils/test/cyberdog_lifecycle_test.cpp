@@ -18,6 +18,7 @@
 #include <regex>
 #include <iostream>
 #include <memory>
+#include <sstream>
 
 
 #include "cyberdog_utils/lifecycle_node.hpp"
@@ -1880,6 +1881,67 @@ TEST(cyberdog_utils, inheritance_with_namespace)
   ASSERT_EQ(node_2->get_my_state(), lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE);
 }
 
+TEST(cyberdog_utils, transition_metrics)
+{
+  auto node_a = std::make_shared<cyberdog_utils::LifecycleNode>("node_A");
+  auto node_b = std::make_shared<cyberdog_utils::LifecycleNode>("node_B");
+
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(node_a->get_node_base_interface());
+  executor.add_node(node_b->get_node_base_interface());
+
+  node_a->add_activation("node_B");
+
+  {
+    rclcpp::Rate rate(10);
+    auto start = node_a->now();
+    while ((node_a->now() - start).seconds() < 1.0) {
+      executor.spin_some();
+      rate.sleep();
+    }
+  }
+
+  node_a->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
+
+  {
+    rclcpp::Rate rate(10);
+    auto start = node_a->now();
+    while ((node_a->now() - start).seconds() < 1.0) {
+      executor.spin_some();
+      rate.sleep();
+    }
+  }
+
+  std::vector<cyberdog_utils::TransitionMetric> transitions;
+  uint64_t cursor = 0;
+  ASSERT_EQ(node_a->get_transition_metrics().read(transitions, cursor), 0u);
+  ASSERT_EQ(transitions.size(), 1u);
+  ASSERT_EQ(transitions[0].callback, cyberdog_utils::CALLBACK_CONFIGURE);
+  ASSERT_EQ(transitions[0].cause, cyberdog_utils::CAUSE_REQUEST);
+  ASSERT_LE(transitions[0].request_ns, transitions[0].start_ns);
+  ASSERT_LE(transitions[0].start_ns, transitions[0].end_ns);
+  ASSERT_LE(transitions[0].end_ns, transitions[0].published_ns);
+
+  transitions.clear();
+  cursor = 0;
+  node_b->get_transition_metrics().read(transitions, cursor);
+  ASSERT_EQ(transitions.size(), 1u);
+  ASSERT_EQ(transitions[0].cause, cyberdog_utils::CAUSE_CASCADE);
+  ASSERT_STREQ(transitions[0].activator, "node_A");
+  ASSERT_NE(transitions[0].published_ns, 0);
+
+  std::vector<cyberdog_utils::ActivatorMetric> activators;
+  cursor = 0;
+  node_b->get_activator_metrics().read(activators, cursor);
+  ASSERT_FALSE(activators.empty());
+  ASSERT_EQ(activators.back().state, lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE);
+  ASSERT_LE(activators.back().stamp_ns, transitions[0].request_ns);
+
+  std::stringstream csv;
+  node_b->export_metrics(csv);
+  ASSERT_EQ(csv.str().find("transition,node_B,"), 0u);
+}
+
 int main(int argc, char ** argv)
 {
   rclcpp::init(argc, argv);
@@ -0,0 +1,187 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cyberdog_utils/image_ring.hpp"
+
+#include "gtest/gtest.h"
+
+namespace
+{
+std::string ring_name()
+{
+  return "/image_ring_test_" + std::to_string(getpid());
+}
+
+bool ring_exists()
+{
+  struct stat st;
+  return stat(("/dev/shm" + ring_name()).c_str(), &st) == 0;
+}
+
+cyberdog_utils::ImageFrame make_frame(uint32_t size, uint8_t value, std::vector<uint8_t> & data)
+{
+  cyberdog_utils::ImageFrame frame;
+  std::memset(&frame, 0, sizeof(frame));
+  frame.format = cyberdog_utils::IMAGE_MONO8;
+  frame.width = size;
+  frame.height = 1;
+  frame.step = size;
+  frame.size = size;
+  std::snprintf(frame.frame_id, sizeof(frame.frame_id), "%u", value);
+  data.assign(size, value);
+  return frame;
+}
+}  // namespace
+
+TEST(ImageRingTest, ReadLatest)
+{
+  auto producer = cyberdog_utils::ImageRing::create(ring_name(), 3, 1024);
+  ASSERT_NE(producer, nullptr);
+  EXPECT_FALSE(producer->has_readers());
+  EXPECT_EQ(cyberdog_utils::ImageRing::open("/image_ring_test_none"), nullptr);
+
+  auto reader = cyberdog_utils::ImageRing::open(ring_name());
+  ASSERT_NE(reader, nullptr);
+  EXPECT_TRUE(producer->has_readers());
+  EXPECT_FALSE(reader->read_latest([](const cyberdog_utils::ImageFrame &, const uint8_t *) {}));
+
+  std::vector<uint8_t> data;
+  for (uint8_t i = 1; i <= 5; i++) {
+    auto frame = make_frame(100 + i, i, data);
+    EXPECT_TRUE(producer->write(frame, data.data()));
+  }
+  auto big = make_frame(2048, 9, data);
+  EXPECT_FALSE(producer->write(big, data.data()));
+
+  uint64_t index(0);
+  std::string copied;
+  ASSERT_TRUE(
+    reader->read_latest(
+      [&copied](const cyberdog_utils::ImageFrame & frame, const uint8_t * bytes) {
+        EXPECT_STREQ(frame.frame_id, "5");
+        copied.assign(reinterpret_cast<const char *>(bytes), frame.size);
+      }, &index));
+  EXPECT_EQ(index, 4u);
+  EXPECT_EQ(reader->written(), 5u);
+  EXPECT_EQ(copied, std::string(105, 5));
+  EXPECT_FALSE(reader->stale());
+
+  reader.reset();
+  EXPECT_FALSE(producer->has_readers());
+  producer.reset();
+  EXPECT_FALSE(ring_exists());
+}
+
+TEST(ImageRingTest, ProducerRestart)
+{
+  auto producer = cyberdog_utils::ImageRing::create(ring_name(), 2, 64);
+  ASSERT_NE(producer, nullptr);
+  auto reader = cyberdog_utils::ImageRing::open(ring_name());
+  ASSERT_NE(reader, nullptr);
+  producer = cyberdog_utils::ImageRing::create(ring_name(), 2, 64);
+  ASSERT_NE(producer, nullptr);
+  EXPECT_TRUE(reader->stale());
+  // Old producer is gone, ring of the new one stays
+  EXPECT_TRUE(ring_exists());
+  reader.reset();
+  producer.reset();
+  EXPECT_FALSE(ring_exists());
+}
+
+TEST(ImageRingTest, DeadReaderIsDropped)
+{
+  auto producer = cyberdog_utils::ImageRing::create(ring_name(), 2, 64);
+  ASSERT_NE(producer, nullptr);
+  EXPECT_EQ(0600u, [] {
+      struct stat st;
+      stat(("/dev/shm" + ring_name()).c_str(), &st);
+      return st.st_mode & 0777;
+    } ());
+
+  auto name = ring_name();
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    // Exit without closing the ring, as a crashed reader does
+    auto reader = cyberdog_utils::ImageRing::open(name);
+    _exit(reader == nullptr ? 1 : 0);
+  }
+  int status(0);
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_FALSE(producer->has_readers());
+
+  std::vector<std::unique_ptr<cyberdog_utils::ImageRing>> readers;
+  for (int i = 0; i < cyberdog_utils::IMAGE_RING_READERS; i++) {
+    readers.push_back(cyberdog_utils::ImageRing::open(ring_name()));
+    ASSERT_NE(readers.back(), nullptr);
+  }
+  EXPECT_EQ(cyberdog_utils::ImageRing::open(ring_name()), nullptr);
+  EXPECT_TRUE(producer->has_readers());
+  readers.clear();
+  EXPECT_FALSE(producer->has_readers());
+}
+
+TEST(ImageRingTest, TornReadsAreReported)
+{
+  auto producer = cyberdog_utils::ImageRing::create(ring_name(), 2, 4096);
+  ASSERT_NE(producer, nullptr);
+  auto reader = cyberdog_utils::ImageRing::open(ring_name());
+  ASSERT_NE(reader, nullptr);
+
+  std::atomic_bool running(true);
+  std::thread writer(
+    [&producer, &running]() {
+      std::vector<uint8_t> data;
+      for (uint8_t i = 0; running; i++) {
+        auto frame = make_frame(4096, i, data);
+        producer->write(frame, data.data());
+      }
+    });
+  while (reader->written() == 0) {
+    std::this_thread::yield();
+  }
+  int valid(0);
+  for (int i = 0; i < 20000; i++) {
+    bool uniform(true);
+    bool ok = reader->read_latest(
+      [&uniform](const cyberdog_utils::ImageFrame & frame, const uint8_t * bytes) {
+        for (uint32_t j = 1; j < frame.size; j++) {
+          uniform = uniform && bytes[j] == bytes[0];
+        }
+      });
+    if (ok) {
+      EXPECT_TRUE(uniform);
+      valid++;
+    }
+  }
+  running = false;
+  writer.join();
+  EXPECT_GT(valid, 0);
+  reader.reset();
+  producer.reset();
+  EXPECT_FALSE(ring_exists());
+}
@@ -17,6 +17,8 @@
 
 #include <rclcpp/rclcpp.hpp>
 #include <sensor_msgs/msg/image.hpp>
+#include <memory>
+#include "cyberdog_utils/image_ring.hpp"
 #include "camera_base/color_convert.hpp"
 #include "camera_base/stream_consumer.hpp"
 
@@ -38,8 +40,11 @@ private:
   ColorConvert * m_convert;
   unsigned char * m_buffer;
   rclcpp::Publisher<sensor_msgs::msg::Image>::SharedPtr m_publisher;
+  // Frames for local readers such as the app bridge
+  std::unique_ptr<cyberdog_utils::ImageRing> m_ring;
 
   void publishImage(uint64_t frame_id, ImageBuffer & buf);
+  void writeRing(uint64_t frame_id, ImageBuffer & buf);
 };
 
 }  // namespace cyberdog_camera
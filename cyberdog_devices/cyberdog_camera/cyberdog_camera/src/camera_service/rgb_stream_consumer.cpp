@@ -13,13 +13,18 @@
 // limitations under the License.
 
 #define LOG_TAG "RGBStream"
+#include <cstring>
 #include <memory>
+#include <string>
 #include <utility>
 #include "camera_service/rgb_stream_consumer.hpp"
 #include "camera_service/camera_manager.hpp"
 #include "camera_utils/log.hpp"
 #include "camera_utils/utils.hpp"
 
+// Readers get the newest frame, a few slots let them encode while frames go on
+#define RGB_RING_SLOTS 3
+
 namespace cyberdog_camera
 {
 
@@ -66,6 +71,12 @@ bool RGBStreamConsumer::threadInitialize()
   m_convert = new ColorConvert(m_size.width(), m_size.height());
   m_convert->initialze(m_rgbaFd);
 
+  m_ring = cyberdog_utils::ImageRing::create(
+    cyberdog_utils::CAMERA_RGB_RING, RGB_RING_SLOTS, m_size.width() * m_size.height() * 3);
+  if (!m_ring) {
+    CAM_INFO("Failed to create image ring, frames only go to topic.");
+  }
+
   return true;
 }
 
@@ -77,6 +88,7 @@ bool RGBStreamConsumer::threadShutdown()
 
   m_convert->release();
   delete m_convert;
+  m_ring.reset();
 
   if (m_rgbaFd > 0) {
     NvBufferDestroy(m_rgbaFd);
@@ -132,6 +144,7 @@ bool RGBStreamConsumer::processBuffer(Buffer * buffer)
   buf.data = m_buffer;
   buf.timestamp = ts;
 
+  writeRing(m_frameCount, buf);
   publishImage(m_frameCount, buf);
   m_frameCount++;
   bufferDone(buffer);
@@ -159,4 +172,22 @@ void RGBStreamConsumer::publishImage(uint64_t frame_id, ImageBuffer & buf)
   m_publisher->publish(std::move(msg));
 }
 
+void RGBStreamConsumer::writeRing(uint64_t frame_id, ImageBuffer & buf)
+{
+  if (!m_ring || !m_ring->has_readers()) {
+    return;
+  }
+  cyberdog_utils::ImageFrame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.format = cyberdog_utils::IMAGE_BGR8;
+  frame.width = buf.res.width();
+  frame.height = buf.res.height();
+  frame.step = frame.width * 3;
+  frame.size = frame.step * frame.height;
+  frame.sec = buf.timestamp.tv_sec;
+  frame.nanosec = buf.timestamp.tv_nsec;
+  strncpy(frame.frame_id, std::to_string(frame_id).c_str(), sizeof(frame.frame_id) - 1);
+  m_ring->write(frame, buf.data);
+}
+
 }  // namespace cyberdog_camera
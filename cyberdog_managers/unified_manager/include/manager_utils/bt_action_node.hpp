@@ -19,6 +19,7 @@
 #include <string>
 
 #include "behaviortree_cpp_v3/action_node.h"
+#include "manager_utils/bt_wakeup.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 
 namespace cyberdog
@@ -50,7 +51,13 @@ public:
     callback_group_ = node_->create_callback_group(
       rclcpp::CallbackGroupType::MutuallyExclusive,
       false);
-    callback_group_executor_.add_callback_group(callback_group_, node_->get_node_base_interface());
+    // Event driven trees share one executor which is spun while the engine sleeps
+    config().blackboard->template get<std::shared_ptr<BtWakeup>>("bt_wakeup", wakeup_);
+    callback_group_executor_ = wakeup_ ?
+      wakeup_->executor() :
+      std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+    callback_group_executor_->add_callback_group(
+      callback_group_, node_->get_node_base_interface());
 
     // Get the required items from the blackboard
     bt_loop_duration_ =
@@ -77,6 +84,7 @@ public:
 
   virtual ~BtActionNode()
   {
+    callback_group_executor_->remove_callback_group(callback_group_);
   }
 
   /**
@@ -228,7 +236,7 @@ public:
           }
         }
 
-        callback_group_executor_.spin_some();
+        callback_group_executor_->spin_some();
 
         // check if, after invoking spin_some(), we finally received the result
         if (!goal_result_available_) {
@@ -278,7 +286,7 @@ public:
   {
     if (should_cancel_goal()) {
       auto future_cancel = action_client_->async_cancel_goal(goal_handle_);
-      if (callback_group_executor_.spin_until_future_complete(future_cancel, server_timeout_) !=
+      if (callback_group_executor_->spin_until_future_complete(future_cancel, server_timeout_) !=
         rclcpp::FutureReturnCode::SUCCESS)
       {
         RCLCPP_ERROR(
@@ -307,7 +315,7 @@ protected:
       return false;
     }
 
-    callback_group_executor_.spin_some();
+    callback_group_executor_->spin_some();
     auto status = goal_handle_->get_status();
 
     // Check if the goal is still executing
@@ -338,8 +346,14 @@ protected:
         if (this->goal_handle_->get_goal_id() == result.goal_id) {
           goal_result_available_ = true;
           result_ = result;
+          if (wakeup_) {
+            wakeup_->notify();
+          }
         }
       };
+    if (wakeup_) {
+      send_goal_options.goal_response_callback = [this](auto) {wakeup_->notify();};
+    }
 
     future_goal_handle_ = std::make_shared<
       std::shared_future<typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr>>(
@@ -363,9 +377,14 @@ protected:
       return false;
     }
 
+    // Event driven tick never blocks, it is woken by goal response or server timeout
     auto timeout = remaining > bt_loop_duration_ ? bt_loop_duration_ : remaining;
+    if (wakeup_) {
+      wakeup_->notify_at(std::chrono::steady_clock::now() + remaining);
+      timeout = std::chrono::milliseconds(0);
+    }
     auto result =
-      callback_group_executor_.spin_until_future_complete(*future_goal_handle_, timeout);
+      callback_group_executor_->spin_until_future_complete(*future_goal_handle_, timeout);
     elapsed += timeout;
 
     if (result == rclcpp::FutureReturnCode::INTERRUPTED) {
@@ -409,7 +428,9 @@ protected:
   // The node that will be used for any ROS operations
   rclcpp::Node::SharedPtr node_;
   rclcpp::CallbackGroup::SharedPtr callback_group_;
-  rclcpp::executors::SingleThreadedExecutor callback_group_executor_;
+  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> callback_group_executor_;
+  // Set if tree is event driven
+  std::shared_ptr<BtWakeup> wakeup_;
 
   // The timeout value while waiting for response from a server when a
   // new action goal is sent or canceled
@@ -15,11 +15,15 @@
 #ifndef MANAGER_UTILS__BT_ACTION_SERVER_HPP_
 #define MANAGER_UTILS__BT_ACTION_SERVER_HPP_
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "manager_utils/bt_binary_logger.hpp"
 #include "manager_utils/ros_topic_logger.hpp"
 #include "manager_utils/bt_engine.hpp"
 #include "cyberdog_utils/action_server.hpp"
@@ -77,6 +81,13 @@ public:
 
     node_clock_interface_ = node_->get_node_clock_interface();
     node_logging_interface_ = node_->get_node_logging_interface();
+
+    // Event driven ticking is off unless node parameter bt_event_max_period_ms is over 0
+    if (!node_->has_parameter("bt_event_max_period_ms")) {
+      node_->declare_parameter("bt_event_max_period_ms", 0);
+    }
+    event_max_period_ = std::chrono::milliseconds(
+      std::max<int64_t>(0, node_->get_parameter("bt_event_max_period_ms").as_int()));
   }
 
   /**
@@ -84,6 +95,36 @@ public:
    */
   ~BtActionServer() {}
 
+  /**
+   * @brief Tick BT only when a wakeup source of its nodes fires, call before on_configure.
+   * Overrides node parameter bt_event_max_period_ms
+   * @param max_period Longest time between two ticks, 0 keeps ticking at fixed rate
+   */
+  void setEventDriven(const std::chrono::milliseconds max_period)
+  {
+    event_max_period_ = max_period;
+  }
+
+  /**
+   * @brief Additional BT XML files which goals may switch to, call before on_configure.
+   * They are validated at configure and instantiated at activate
+   * @param bt_xml_filenames Files besides the default one
+   */
+  void setBehaviorTreeFiles(const std::vector<std::string> & bt_xml_filenames)
+  {
+    bt_xml_filenames_ = bt_xml_filenames;
+  }
+
+  /**
+   * @brief Log BT status changes to a binary file instead of topic, call before on_configure.
+   * Decode it with bt_log_decoder
+   * @param file_path Binary log file, empty keeps logging to topic
+   */
+  void setBinaryLog(const std::string & file_path)
+  {
+    bt_log_file_ = file_path;
+  }
+
   /**
    * @brief Configures member variables
    * Initializes action server for, builds behavior tree from xml file,
@@ -130,6 +171,32 @@ public:
     blackboard_->set<rclcpp::Node::SharedPtr>("node", client_node_);
     blackboard_->set<std::chrono::milliseconds>("bt_loop_duration", bt_loop_duration);
     blackboard_->set<std::chrono::milliseconds>("server_timeout", bt_action_server_timeout);
+    if (event_max_period_ > std::chrono::milliseconds(0)) {
+      wakeup_ = std::make_shared<BtWakeup>();
+      blackboard_->set<std::shared_ptr<BtWakeup>>("bt_wakeup", wakeup_);
+      // Cancel and preemption are seen on the next tick, not after max_period
+      action_server_->set_event_callback([wakeup = wakeup_]() {wakeup->notify();});
+    }
+
+    if (!bt_log_file_.empty()) {
+      bt_log_writer_ = std::make_shared<BtLogWriter>(bt_log_file_);
+      if (!bt_log_writer_->good()) {
+        RCLCPP_ERROR(
+          node_logging_interface_->get_logger(), "Couldn't open BT log file: %s",
+          bt_log_file_.c_str());
+        return false;
+      }
+    }
+
+    // Parse and validate every XML against loaded plugins before any goal arrives
+    if (bt_->loadTreeModel(default_bt_xml_filename_) == 0) {
+      return false;
+    }
+    for (const auto & filename : bt_xml_filenames_) {
+      if (bt_->loadTreeModel(filename) == 0) {
+        return false;
+      }
+    }
 
     return true;
   }
@@ -146,6 +213,15 @@ public:
         default_bt_xml_filename_.c_str());
       return false;
     }
+    // Nodes of a tree wait for their servers, so trees are only instantiated here
+    for (const auto & filename : bt_xml_filenames_) {
+      if (!poolBehaviorTree(filename)) {
+        RCLCPP_ERROR(
+          node_logging_interface_->get_logger(), "Error loading XML file: %s",
+          filename.c_str());
+        return false;
+      }
+    }
     action_server_->activate();
     return true;
   }
@@ -168,13 +244,18 @@ public:
   {
     client_node_.reset();
     action_server_.reset();
-    topic_logger_.reset();
     plugin_lib_names_.clear();
     current_bt_xml_filename_.clear();
     blackboard_.reset();
-    bt_->haltAllActions(tree_.rootNode());
+    if (current_tree_) {
+      bt_->haltAllActions(current_tree_->tree.rootNode());
+    }
+    current_tree_.reset();
+    tree_pool_.clear();
     // bt_->resetGrootMonitor();
     bt_.reset();
+    wakeup_.reset();
+    bt_log_writer_.reset();
     return true;
   }
 
@@ -199,34 +280,26 @@ public:
   {
     auto filename = bt_xml_filename.empty() ? default_bt_xml_filename_ : bt_xml_filename;
 
-    if (current_bt_xml_filename_ == filename) {
-      RCLCPP_DEBUG(
-        node_logging_interface_->get_logger(),
-        "BT will not be reloaded as the given xml is already loaded");
-      return true;
-    }
-
     // if a new tree is created, than the ZMQ Publisher must be destroyed
     // bt_->resetGrootMonitor();
 
-    // Read the input BT XML from the specified file into a string
-    std::ifstream xml_file(filename);
-
-    if (!xml_file.good()) {
-      RCLCPP_ERROR(
-        node_logging_interface_->get_logger(), "Couldn't open input XML file: %s",
-        filename.c_str());
+    // Model is parsed again only if file is changed, then pooled tree is rebuilt
+    auto tree = poolBehaviorTree(filename);
+    if (!tree) {
       return false;
     }
 
-    auto xml_string = std::string(
-      std::istreambuf_iterator<char>(xml_file),
-      std::istreambuf_iterator<char>());
-
-    // Create the Behavior Tree from the XML input
-    tree_ = bt_->createTreeFromText(xml_string, blackboard_);
-    topic_logger_ = std::make_unique<RosTopicLogger>(client_node_, tree_);
+    if (tree == current_tree_) {
+      RCLCPP_DEBUG(
+        node_logging_interface_->get_logger(),
+        "BT will not be reloaded as the given xml is already loaded");
+      return true;
+    }
 
+    if (current_tree_) {
+      bt_->haltAllActions(current_tree_->tree.rootNode());
+    }
+    current_tree_ = tree;
     current_bt_xml_filename_ = filename;
 
     // Enable monitoring with Groot
@@ -312,7 +385,7 @@ public:
    */
   BT::Tree getTree() const
   {
-    return tree_;
+    return current_tree_->tree;
   }
 
   /**
@@ -321,10 +394,55 @@ public:
    */
   void haltTree()
   {
-    tree_.rootNode()->halt();
+    current_tree_->tree.rootNode()->halt();
   }
 
 protected:
+  /**
+   * @brief Halted instantiated BT, reused while its XML file is unchanged
+   */
+  struct PooledTree
+  {
+    uint64_t generation;
+    BT::Tree tree;
+    std::unique_ptr<BT::StatusChangeLogger> topic_logger;
+  };
+
+  /**
+   * @brief Find or instantiate BT of a file in tree pool
+   * @param filename The file containing the BT
+   * @return Pooled BT, nullptr if file is invalid or BT can not be instantiated
+   */
+  std::shared_ptr<PooledTree> poolBehaviorTree(const std::string & filename)
+  {
+    auto generation = bt_->loadTreeModel(filename);
+    if (generation == 0) {
+      return nullptr;
+    }
+    auto pooled = tree_pool_.find(filename);
+    if (pooled != tree_pool_.end() && pooled->second->generation == generation) {
+      return pooled->second;
+    }
+
+    auto tree = std::make_shared<PooledTree>();
+    tree->generation = generation;
+    try {
+      tree->tree = bt_->createTreeFromModel(filename, blackboard_);
+    } catch (const std::exception & ex) {
+      RCLCPP_ERROR(
+        node_logging_interface_->get_logger(), "Couldn't create BT from %s: %s",
+        filename.c_str(), ex.what());
+      return nullptr;
+    }
+    if (bt_log_writer_) {
+      tree->topic_logger = std::make_unique<BinaryTreeLogger>(bt_log_writer_, tree->tree);
+    } else {
+      tree->topic_logger = std::make_unique<RosTopicLogger>(client_node_, tree->tree);
+    }
+    tree_pool_[filename] = tree;
+    return tree;
+  }
+
   /**
    * @brief Action server callback
    */
@@ -349,20 +467,24 @@ protected:
         return action_server_->is_cancel_requested();
       };
 
+    // Goal callback may switch BT, keep the chosen one alive while running
+    auto tree = current_tree_;
     auto on_loop = [&]() {
         if (action_server_->is_preempt_requested() && on_preempt_callback_) {
           on_preempt_callback_(action_server_->get_pending_goal());
         }
-        topic_logger_->flush();
+        tree->topic_logger->flush();
         on_loop_callback_();
       };
 
     // Execute the BT that was previously created in the configure step
-    BtStatus rc = bt_->run(&tree_, on_loop, is_canceling, bt_loop_duration_);
+    BtStatus rc = wakeup_ ?
+      bt_->run(&tree->tree, on_loop, is_canceling, wakeup_, event_max_period_) :
+      bt_->run(&tree->tree, on_loop, is_canceling, bt_loop_duration_);
 
     // Make sure that the Bt is not in a running state from a previous execution
     // note: if all the ControlNodes are implemented correctly, this is not needed.
-    bt_->haltAllActions(tree_.rootNode());
+    bt_->haltAllActions(tree->tree.rootNode());
 
     // Give server an opportunity to populate the result message or simple give
     // an indication that the action is complete.
@@ -397,10 +519,13 @@ private:
   std::string action_name_;
   std::string default_bt_xml_filename_;
   std::string current_bt_xml_filename_;
+  std::vector<std::string> bt_xml_filenames_;
+  std::string bt_log_file_;
   std::vector<std::string> plugin_lib_names_;
   typename nodeT::WeakPtr node_weak_ptr_;
   std::chrono::milliseconds bt_loop_duration_;
   std::chrono::milliseconds bt_action_server_timeout_;
+  std::chrono::milliseconds event_max_period_{0};
 
   // user-provided callbacks
   OnGoalReceivedCallback on_goal_received_callback_;
@@ -414,11 +539,13 @@ private:
 
   // internal variables
   std::shared_ptr<ActionServer> action_server_;
-  BT::Tree tree_;
+  std::shared_ptr<PooledTree> current_tree_;
+  std::unordered_map<std::string, std::shared_ptr<PooledTree>> tree_pool_;
   BT::Blackboard::Ptr blackboard_;
   std::unique_ptr<BehaviorTreeEngine> bt_;
+  std::shared_ptr<BtWakeup> wakeup_;
+  std::shared_ptr<BtLogWriter> bt_log_writer_;
   rclcpp::Node::SharedPtr client_node_;
-  std::unique_ptr<RosTopicLogger> topic_logger_;
 };
 }  // namespace bt_engine
 }  // namespace cyberdog
@@ -0,0 +1,179 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__BT_BINARY_LOGGER_HPP_
+#define MANAGER_UTILS__BT_BINARY_LOGGER_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "behaviortree_cpp_v3/loggers/abstract_logger.h"
+
+namespace cyberdog
+{
+namespace bt_engine
+{
+
+// Stream layout, host byte order:
+//   file    : "CDBTLOG1" then any sequence of tables and batches
+//   table   : 'T' u16 count, count * {u16 uid, u16 len, name, u16 len, registration name}
+//   batch   : 'B' i64 base_ns, u32 dropped, u32 count, count * BtLogRecord
+// Node uid is BT::TreeNode::UID(), unique in one process.
+constexpr char BT_LOG_MAGIC[] = "CDBTLOG1";
+constexpr uint8_t BT_LOG_TABLE = 'T';
+constexpr uint8_t BT_LOG_BATCH = 'B';
+
+/**
+ * @struct bt_engine::BtLogRecord
+ * @brief One status change, time is relative to base_ns of its batch
+ */
+struct BtLogRecord
+{
+  uint32_t delta_us;
+  uint16_t uid;
+  uint8_t prev_status;
+  uint8_t status;
+};
+static_assert(sizeof(BtLogRecord) == 8, "BtLogRecord must be packed in 8 bytes");
+
+/**
+ * @class bt_engine::BtLogWriter
+ * @brief Collects status changes of all trees into a lock-free ring, a writer
+ * thread appends them to file in batches. Producers never block or allocate,
+ * changes are dropped and counted when ring is full.
+ */
+class BtLogWriter
+{
+public:
+  static constexpr uint32_t CAPACITY = 4096;
+
+  /**
+   * @brief A constructor for bt_engine::BtLogWriter
+   * @param file_path File to append log to
+   * @param flush_period Longest time a change stays in ring
+   */
+  explicit BtLogWriter(
+    const std::string & file_path,
+    const std::chrono::milliseconds flush_period = std::chrono::milliseconds(200));
+  ~BtLogWriter();
+
+  /**
+   * @return bool false if file can not be opened
+   */
+  bool good() const {return file_ != nullptr;}
+
+  /**
+   * @brief Write uid to name table of tree, before any change of it is written
+   */
+  void add_tree(const BT::Tree & tree);
+
+  /**
+   * @brief Record one status change, called from any ticking thread
+   */
+  void push(const int64_t stamp_ns, const uint16_t uid, const uint8_t prev, const uint8_t status);
+
+private:
+  struct Entry
+  {
+    int64_t stamp_ns;
+    uint16_t uid;
+    uint8_t prev_status;
+    uint8_t status;
+  };
+
+  struct Slot
+  {
+    std::atomic<uint32_t> sequence;
+    Entry entry;
+  };
+
+  bool pop(Entry & entry);
+  void write_spin();
+  void write_batch(const std::vector<Entry> & entries, const uint32_t dropped);
+
+  FILE * file_;
+  std::chrono::milliseconds flush_period_;
+  std::array<Slot, CAPACITY> slots_;
+  std::atomic<uint32_t> head_;
+  uint32_t tail_;
+  std::atomic<uint32_t> dropped_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<uint8_t> pending_tables_;
+  bool running_;
+  std::thread write_thread_;
+};
+
+/**
+ * @class bt_engine::BinaryTreeLogger
+ * @brief Drop-in replacement of RosTopicLogger, only node uid and statuses are
+ * recorded while ticking
+ */
+class BinaryTreeLogger : public BT::StatusChangeLogger
+{
+public:
+  /**
+   * @brief A constructor for bt_engine::BinaryTreeLogger
+   * @param writer Writer shared by all trees of a server
+   * @param tree BT to monitor
+   */
+  BinaryTreeLogger(const std::shared_ptr<BtLogWriter> & writer, const BT::Tree & tree)
+  : StatusChangeLogger(tree.rootNode()), writer_(writer)
+  {
+    writer_->add_tree(tree);
+  }
+
+  void callback(
+    BT::Duration timestamp,
+    const BT::TreeNode & node,
+    BT::NodeStatus prev_status,
+    BT::NodeStatus status) override
+  {
+    writer_->push(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp).count(),
+      node.UID(), static_cast<uint8_t>(prev_status), static_cast<uint8_t>(status));
+  }
+
+  /**
+   * @brief Nothing to do, writer thread flushes in batches
+   */
+  void flush() override {}
+
+private:
+  std::shared_ptr<BtLogWriter> writer_;
+};
+
+/**
+ * @brief Decode a binary BT log to readable lines
+ * @param in Binary stream written by bt_engine::BtLogWriter
+ * @param out One line per status change, same format as RosTopicLogger debug output
+ * @return bool false if stream is not a BT log or is truncated
+ */
+bool decode_bt_log(std::istream & in, std::ostream & out);
+}  // namespace bt_engine
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__BT_BINARY_LOGGER_HPP_
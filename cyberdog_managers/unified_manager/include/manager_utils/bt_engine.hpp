@@ -18,13 +18,16 @@
 #define MANAGER_UTILS__BT_ENGINE_HPP_
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "behaviortree_cpp_v3/behavior_tree.h"
 #include "behaviortree_cpp_v3/bt_factory.h"
 #include "behaviortree_cpp_v3/xml_parsing.h"
 #include "behaviortree_cpp_v3/loggers/bt_zmq_publisher.h"
+#include "manager_utils/bt_wakeup.hpp"
 
 
 namespace cyberdog
@@ -66,6 +69,22 @@ public:
     std::function<bool()> cancelRequested,
     std::chrono::milliseconds loopTimeout = std::chrono::milliseconds(10));
 
+  /**
+   * @brief Function to execute a BT only when one of its wakeup sources fires
+   * @param tree BT to execute
+   * @param onLoop Function to execute on each iteration of BT execution
+   * @param cancelRequested Function to check if cancel was requested during BT execution
+   * @param wakeup Wakeup sources registered by leaf nodes
+   * @param maxPeriod Longest time between two ticks, bounds cancel latency
+   * @return bt_engine::BtStatus Status of BT execution
+   */
+  BtStatus run(
+    BT::Tree * tree,
+    std::function<void()> onLoop,
+    std::function<bool()> cancelRequested,
+    std::shared_ptr<BtWakeup> wakeup,
+    std::chrono::milliseconds maxPeriod = std::chrono::milliseconds(100));
+
   /**
    * @brief Function to create a BT from a XML string
    * @param xml_string XML string representing BT
@@ -86,6 +105,25 @@ public:
     const std::string & file_path,
     BT::Blackboard::Ptr blackboard);
 
+  /**
+   * @brief Parse and validate a BT XML file against registered plugins. Parsed
+   * model is cached by path and modification time, an unchanged file is not parsed again
+   * @param file_path Path to BT XML file
+   * @return uint64_t Generation of parsed model, changes when file is parsed again.
+   * 0 if file can not be read or is invalid
+   */
+  uint64_t loadTreeModel(const std::string & file_path);
+
+  /**
+   * @brief Function to create a BT from cached model, see loadTreeModel
+   * @param file_path Path to BT XML file
+   * @param blackboard Blackboard for BT
+   * @return BT::Tree Created behavior tree
+   */
+  BT::Tree createTreeFromModel(
+    const std::string & file_path,
+    BT::Blackboard::Ptr blackboard);
+
   /**
    * @brief Add groot monitor to publish BT status changes
    * @param tree BT to monitor
@@ -114,6 +152,18 @@ protected:
   // The factory that will be used to dynamically construct the behavior tree
   BT::BehaviorTreeFactory factory_;
 
+  // Parsed XML models keyed by file path
+  struct TreeModel
+  {
+    int64_t mtime_ns;
+    int64_t size;
+    uint64_t generation;
+    std::shared_ptr<BT::XMLParser> parser;
+  };
+  std::unordered_map<std::string, TreeModel> models_;
+  uint64_t model_generation_{0};
+  std::mutex models_mutex_;
+
   // static inline std::unique_ptr<BT::PublisherZMQ> groot_monitor_;
 };
 }  // namespace bt_engine
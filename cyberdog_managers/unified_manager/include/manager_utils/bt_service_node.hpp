@@ -19,6 +19,7 @@
 #include <memory>
 
 #include "behaviortree_cpp_v3/action_node.h"
+#include "manager_utils/bt_wakeup.hpp"
 #include "rclcpp/rclcpp.hpp"
 
 namespace cyberdog
@@ -48,7 +49,13 @@ public:
     callback_group_ = node_->create_callback_group(
       rclcpp::CallbackGroupType::MutuallyExclusive,
       false);
-    callback_group_executor_.add_callback_group(callback_group_, node_->get_node_base_interface());
+    // Event driven trees share one executor which is spun while the engine sleeps
+    config().blackboard->template get<std::shared_ptr<BtWakeup>>("bt_wakeup", wakeup_);
+    callback_group_executor_ = wakeup_ ?
+      wakeup_->executor() :
+      std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+    callback_group_executor_->add_callback_group(
+      callback_group_, node_->get_node_base_interface());
 
     // Get the required items from the blackboard
     bt_loop_duration_ =
@@ -82,6 +89,7 @@ public:
 
   virtual ~BtServiceNode()
   {
+    callback_group_executor_->remove_callback_group(callback_group_);
   }
 
   /**
@@ -118,7 +126,15 @@ public:
   {
     if (!request_sent_) {
       on_tick();
-      future_result_ = service_client_->async_send_request(request_).share();
+      if (wakeup_) {
+        future_result_ = service_client_->async_send_request(
+          request_, [this](typename rclcpp::Client<ServiceT>::SharedFuture) {
+            wakeup_->notify();
+          });
+        wakeup_->notify_at(std::chrono::steady_clock::now() + server_timeout_);
+      } else {
+        future_result_ = service_client_->async_send_request(request_).share();
+      }
       sent_time_ = node_->now();
       request_sent_ = true;
     }
@@ -165,7 +181,9 @@ public:
       auto timeout = remaining > bt_loop_duration_ ? bt_loop_duration_ : remaining;
 
       rclcpp::FutureReturnCode rc;
-      rc = callback_group_executor_.spin_until_future_complete(future_result_, server_timeout_);
+      rc = callback_group_executor_->spin_until_future_complete(
+        future_result_,
+        wakeup_ ? std::chrono::milliseconds(0) : server_timeout_);
       if (rc == rclcpp::FutureReturnCode::SUCCESS) {
         request_sent_ = false;
         BT::NodeStatus status = on_completion();
@@ -215,7 +233,9 @@ protected:
   // The node that will be used for any ROS operations
   rclcpp::Node::SharedPtr node_;
   rclcpp::CallbackGroup::SharedPtr callback_group_;
-  rclcpp::executors::SingleThreadedExecutor callback_group_executor_;
+  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> callback_group_executor_;
+  // Set if tree is event driven
+  std::shared_ptr<BtWakeup> wakeup_;
 
   // The timeout value while to use in the tick loop while waiting for
   // a result from the server
@@ -0,0 +1,138 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__BT_WAKEUP_HPP_
+#define MANAGER_UTILS__BT_WAKEUP_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace cyberdog
+{
+namespace bt_engine
+{
+
+/**
+ * @class bt_engine::BtWakeup
+ * @brief Wakeup sources of an event driven behavior tree. Shared by blackboard
+ * key "bt_wakeup".
+ * Leaf nodes add their callback groups to executor(), so action / service
+ * responses are processed while the engine sleeps, and call notify() once a
+ * result is available. Topic callbacks running elsewhere call notify() too.
+ * Timeouts are registered by notify_at().
+ */
+class BtWakeup
+{
+public:
+  using Clock_T = std::chrono::steady_clock;
+  using Executor_T = rclcpp::executors::SingleThreadedExecutor;
+
+  BtWakeup()
+  : executor_(std::make_shared<Executor_T>()),
+    sequence_(0),
+    waiting_(false),
+    deadline_(Clock_T::time_point::max())
+  {}
+
+  /**
+   * @brief Executor which is spun by the engine thread only
+   */
+  std::shared_ptr<Executor_T> executor() const {return executor_;}
+
+  /**
+   * @brief Number of notifications, read it before ticking and pass it to wait()
+   */
+  uint64_t sequence()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sequence_;
+  }
+
+  /**
+   * @brief Request a tick as soon as possible, called from any thread
+   */
+  void notify()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sequence_++;
+    // Interrupt is latched by guard condition, only sent while engine is waiting
+    // so blocking calls inside a tick are never cut short
+    if (waiting_) {
+      executor_->cancel();
+    }
+  }
+
+  /**
+   * @brief Request a tick no later than time_point, called from any thread
+   */
+  void notify_at(const Clock_T::time_point time_point)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadline_ = std::min(deadline_, time_point);
+  }
+
+  /**
+   * @brief Sleep until notified after seen, a registered deadline or max_period
+   * @param seen Sequence read before last tick
+   * @param max_period Fallback period
+   * @return true if woken by notification or deadline, false by fallback
+   */
+  bool wait(const uint64_t seen, const std::chrono::nanoseconds max_period)
+  {
+    auto fallback = Clock_T::now() + max_period;
+    while (rclcpp::ok()) {
+      Clock_T::time_point until;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sequence_ != seen) {
+          return true;
+        }
+        auto now = Clock_T::now();
+        if (deadline_ <= now) {
+          deadline_ = Clock_T::time_point::max();
+          return true;
+        }
+        if (fallback <= now) {
+          return false;
+        }
+        until = std::min(fallback, deadline_);
+        waiting_ = true;
+      }
+      // Negative timeout blocks forever in spin_once
+      executor_->spin_once(
+        std::max(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(until - Clock_T::now()),
+          std::chrono::nanoseconds(0)));
+      std::lock_guard<std::mutex> lock(mutex_);
+      waiting_ = false;
+    }
+    return false;
+  }
+
+private:
+  std::shared_ptr<Executor_T> executor_;
+  std::mutex mutex_;
+  uint64_t sequence_;
+  bool waiting_;
+  Clock_T::time_point deadline_;
+};
+}  // namespace bt_engine
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__BT_WAKEUP_HPP_
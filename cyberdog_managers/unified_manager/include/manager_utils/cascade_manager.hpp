@@ -16,9 +16,12 @@
 #define MANAGER_UTILS__CASCADE_MANAGER_HPP_
 
 // C++ headers
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -29,6 +32,7 @@
 #include "string_view"
 
 #include "cyberdog_utils/lifecycle_node.hpp"
+#include "manager_utils/completion_tracker.hpp"
 #include "rclcpp/rclcpp.hpp"
 
 namespace cyberdog
@@ -72,9 +76,32 @@ public:
   ~CascadeManager();
 
   uint8_t manager_type;
-  uint8_t chainnodes_state_;
+  std::atomic<uint8_t> chainnodes_state_;
+
+  /**
+   * @brief Block until current chain checking finishes
+   * @param timeout Maximum waiting time
+   * @return true if all chained nodes are active, or there is no chain
+   */
+  bool wait_chain(const std::chrono::nanoseconds timeout);
+
+  /**
+   * @brief Concern callback groups created by this manager, for mapping to executors
+   */
+  const std::map<std::string, rclcpp::CallbackGroup::SharedPtr> & concern_groups() const
+  {
+    return concern_groups_;
+  }
 
 protected:
+  /**
+   * @brief Get or create a mutually exclusive callback group of a concern.
+   * Group is not added to executor with node, it is spun by the executor
+   * mapped to its concern (manager::ExecutorLayout).
+   * @param concern Name of concern, e.g. control, perception, interaction
+   */
+  rclcpp::CallbackGroup::SharedPtr concern_group(const std::string & concern);
+
   bool manager_configure(const std::string node_list_name = "");
   bool manager_activate();
   bool manager_deactivate();
@@ -91,13 +118,18 @@ private:
 /// Variables
 // Parameters
   std::string node_list_name_;
-  std::map<std::string, uint8_t> node_map_;
-  std::unordered_set<std::string> node_name_set_;
+// Node index is fixed at configure, states are tracked by index
+  std::vector<std::string> node_list_;
+  std::unordered_map<std::string, size_t> node_index_;
+  CompletionTracker node_tracker_;
   int timeout_manager_;
+  std::map<std::string, rclcpp::CallbackGroup::SharedPtr> concern_groups_;
 
 /// Threads
-  bool thread_flag_;
   std::unique_ptr<std::thread> sub_node_checking;
+  bool checking_;
+  std::mutex checking_mutex_;
+  std::condition_variable checking_cv_;
 
 // Subscriber for node's topic
   rclcpp::Subscription<cascade_lifecycle_msgs::msg::State>::SharedPtr node_states_;
@@ -107,6 +139,8 @@ private:
   void node_state_callback(const cascade_lifecycle_msgs::msg::State::SharedPtr msg);
 // common funcs
   void node_status_checking(const State_Req req_type);
+  void start_checking(const State_Req req_type);
+  void stop_checking();
 };
 }  // namespace manager
 }  // namespace cyberdog
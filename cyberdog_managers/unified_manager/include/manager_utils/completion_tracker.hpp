@@ -0,0 +1,155 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__COMPLETION_TRACKER_HPP_
+#define MANAGER_UTILS__COMPLETION_TRACKER_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace cyberdog
+{
+namespace manager
+{
+
+/**
+ * @class manager::CompletionTracker
+ * @brief Tracks states of a fixed set of indexed nodes against one target state.
+ * State updates only flip atomic bits, the waiter is woken once when every
+ * node reaches the target, or by timeout / cancel.
+ */
+class CompletionTracker
+{
+public:
+  static constexpr size_t MAX_NODES = 64;
+
+  CompletionTracker()
+  : count_(0), full_mask_(0), target_(0), done_(0), cancelled_(false)
+  {
+    for (auto & state : states_) {
+      state.store(0);
+    }
+  }
+
+  /**
+   * @brief Reset tracker for count nodes, all states are cleared
+   * @return false if count is bigger than MAX_NODES
+   */
+  bool reset(const size_t count)
+  {
+    if (count > MAX_NODES) {
+      return false;
+    }
+    count_ = count;
+    full_mask_ = count == MAX_NODES ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+    for (auto & state : states_) {
+      state.store(0);
+    }
+    done_.store(0);
+    return true;
+  }
+
+  size_t size() const {return count_;}
+  uint8_t state(const size_t index) const {return states_[index].load();}
+  bool done(const size_t index) const {return (done_.load() >> index) & 1;}
+
+  /**
+   * @brief Store state of one node, called from any thread
+   */
+  void set_state(const size_t index, const uint8_t state)
+  {
+    if (index >= count_) {
+      return;
+    }
+    states_[index].store(state);
+    // Target may change meanwhile, redo until the bit matches the current one
+    uint8_t target;
+    do {
+      target = target_.load();
+      update_bit(index, state == target);
+    } while (target != target_.load());
+  }
+
+  /**
+   * @brief Start tracking a new target state, clears cancel
+   */
+  void arm(const uint8_t target)
+  {
+    cancelled_.store(false);
+    target_.store(target);
+    for (size_t index = 0; index < count_; index++) {
+      update_bit(index, states_[index].load() == target);
+    }
+  }
+
+  /**
+   * @brief Block until every node reaches target, timeout or cancel
+   * @return true if every node reaches target
+   */
+  bool wait(const std::chrono::nanoseconds timeout)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_for(
+      lock, timeout, [this]() {
+        return done_.load() == full_mask_ || cancelled_.load();
+      });
+    return done_.load() == full_mask_;
+  }
+
+  /**
+   * @brief Wake the waiter without completion
+   */
+  void cancel()
+  {
+    cancelled_.store(true);
+    notify();
+  }
+
+private:
+  void update_bit(const size_t index, const bool reached)
+  {
+    const uint64_t bit = uint64_t(1) << index;
+    if (reached) {
+      if ((done_.fetch_or(bit) | bit) == full_mask_) {
+        notify();
+      }
+    } else {
+      done_.fetch_and(~bit);
+    }
+  }
+
+  void notify()
+  {
+    // Taking the lock orders notify after the waiter starts blocking
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    cv_.notify_all();
+  }
+
+  size_t count_;
+  uint64_t full_mask_;
+  std::array<std::atomic<uint8_t>, MAX_NODES> states_;
+  std::atomic<uint8_t> target_;
+  std::atomic<uint64_t> done_;
+  std::atomic_bool cancelled_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+}  // namespace manager
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__COMPLETION_TRACKER_HPP_
@@ -0,0 +1,106 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__DEADLINE_LOOP_HPP_
+#define MANAGER_UTILS__DEADLINE_LOOP_HPP_
+
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace cyberdog
+{
+namespace manager
+{
+
+/**
+ * @struct manager::DeadlineStats
+ * @brief Snapshot of periodic loop timing, all time values in nanoseconds
+ */
+struct DeadlineStats
+{
+  uint64_t cycles{0};
+  uint64_t overruns{0};
+  uint64_t missed{0};
+  int64_t jitter_max{0};
+  int64_t jitter_mean{0};
+  int64_t work_max{0};
+};
+
+/**
+ * @class manager::DeadlineLoop
+ * @brief Periodic loop sleeping to absolute deadlines on CLOCK_MONOTONIC.
+ * Deadlines advance by whole periods so cycle time never drifts. A cycle whose
+ * deadline has already passed counts as overrun and runs at once, late; periods
+ * entirely gone by then are skipped instead of bursting to catch up.
+ */
+class DeadlineLoop
+{
+public:
+  /**
+   * @brief A constructor for manager::DeadlineLoop
+   * @param period Cycle period
+   */
+  explicit DeadlineLoop(std::chrono::nanoseconds period);
+
+  /**
+   * @brief Set SCHED_FIFO for the calling thread
+   * @param priority FIFO priority, 0 keeps the default policy
+   * @return true if policy is set or not requested
+   */
+  static bool set_realtime(const int priority);
+  /**
+   * @brief Pin the calling thread to one cpu
+   * @param cpu CPU index, negative keeps the default affinity
+   * @return true if affinity is set or not requested
+   */
+  static bool set_affinity(const int cpu);
+
+  /**
+   * @brief Start timing, first deadline is one period from now
+   */
+  void start();
+  /**
+   * @brief Sleep until next deadline and account the finished cycle
+   * @return false if the cycle overran its deadline
+   */
+  bool wait();
+  /**
+   * @brief Read statistics, safe from any thread
+   * @param reset_window Reset maximum values after reading
+   */
+  DeadlineStats stats(const bool reset_window = false);
+
+private:
+  static int64_t to_ns(const timespec & ts);
+  static timespec from_ns(const int64_t ns);
+  static int64_t now_ns();
+
+  int64_t period_ns_;
+  int64_t next_ns_;
+  int64_t wake_ns_;
+
+  std::atomic<uint64_t> cycles_;
+  std::atomic<uint64_t> overruns_;
+  std::atomic<uint64_t> missed_;
+  std::atomic<int64_t> jitter_sum_;
+  std::atomic<int64_t> jitter_max_;
+  std::atomic<int64_t> work_max_;
+};
+}  // namespace manager
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__DEADLINE_LOOP_HPP_
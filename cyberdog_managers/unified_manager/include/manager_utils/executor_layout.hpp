@@ -0,0 +1,111 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__EXECUTOR_LAYOUT_HPP_
+#define MANAGER_UTILS__EXECUTOR_LAYOUT_HPP_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace cyberdog
+{
+namespace manager
+{
+
+/**
+ * @struct manager::ExecutorConfig
+ * @brief One executor and the concern callback groups it spins
+ */
+struct ExecutorConfig
+{
+  std::string name;
+  // 0 for one thread per CPU
+  size_t threads{1};
+  // SCHED_FIFO priority, 0 keeps normal scheduling
+  int priority{0};
+  // CPU to pin all threads of executor to, -1 for any
+  int cpu{-1};
+  std::vector<std::string> groups;
+};
+
+/**
+ * @class manager::ExecutorLayout
+ * @brief Maps named concern callback groups of nodes to dedicated executors.
+ * Callbacks outside a concern group stay on the "default" executor.
+ */
+class ExecutorLayout
+{
+public:
+  using Groups_T = std::map<std::string, rclcpp::CallbackGroup::SharedPtr>;
+
+  ExecutorLayout();
+  ~ExecutorLayout();
+
+  /**
+   * @brief Read [Executors.<name>] tables from TOML file
+   * @param toml_file Params file, empty for params.toml of this package
+   * @return false if file can not be parsed, only default executor is kept
+   */
+  bool load(const std::string & toml_file = "");
+
+  /**
+   * @brief Add or replace one executor, must be called before adding nodes
+   */
+  void add_executor(const ExecutorConfig & config);
+
+  /**
+   * @brief Node goes to default executor, each concern group to executor listing it
+   * @param node Base interface of node
+   * @param groups Concern groups of node, created without adding to executor with node
+   */
+  void add_node(
+    const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node,
+    const Groups_T & groups = {});
+
+  /**
+   * @brief Start one thread per executor, returns immediately
+   */
+  void spin();
+
+  /**
+   * @brief Block until every executor stops, after rclcpp::shutdown or cancel
+   */
+  void join();
+
+  void cancel();
+
+private:
+  struct Entry
+  {
+    ExecutorConfig config;
+    std::shared_ptr<rclcpp::Executor> executor;
+    std::thread thread;
+  };
+
+  void spin_entry(Entry & entry);
+
+  // Entry 0 is always the default executor
+  std::vector<std::unique_ptr<Entry>> entries_;
+  std::unordered_map<std::string, size_t> group_map_;
+};
+}  // namespace manager
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__EXECUTOR_LAYOUT_HPP_
@@ -0,0 +1,115 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__LOG_QUEUE_HPP_
+#define MANAGER_UTILS__LOG_QUEUE_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+namespace cyberdog
+{
+namespace manager
+{
+
+enum LogLevel
+{
+  LOG_INFO  = 0,
+  LOG_WARN  = 1,
+  LOG_ERROR = 2
+};
+
+/**
+ * @struct manager::LogEntry
+ * @brief Fixed size log line, longer text is truncated
+ */
+struct LogEntry
+{
+  uint8_t level{LOG_INFO};
+  char text[128]{};
+};
+
+/**
+ * @class manager::LogQueue
+ * @brief Single producer single consumer ring of log lines.
+ * Producer never blocks or allocates, lines are dropped and counted when full.
+ * @tparam CAPACITY Number of lines, must be power of 2
+ */
+template<uint32_t CAPACITY = 64>
+class LogQueue
+{
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be power of 2");
+
+public:
+  /**
+   * @brief Format one line into queue, called from producer thread only
+   * @param level Log level, see manager::LogLevel
+   * @param format printf style format
+   * @return false if queue is full and line is dropped
+   */
+  bool push(const uint8_t level, const char * format, ...)
+  __attribute__((format(printf, 3, 4)))
+  {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= CAPACITY) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    auto & entry = entries_[head & (CAPACITY - 1)];
+    entry.level = level;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(entry.text, sizeof(entry.text), format, args);
+    va_end(args);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Take one line out of queue, called from consumer thread only
+   * @param entry Line to return
+   * @return false if queue is empty
+   */
+  bool pop(LogEntry & entry)
+  {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    entry = entries_[tail & (CAPACITY - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Number of lines dropped since last calling
+   */
+  uint32_t take_dropped()
+  {
+    return dropped_.exchange(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::array<LogEntry, CAPACITY> entries_;
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
+}  // namespace manager
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__LOG_QUEUE_HPP_
@@ -0,0 +1,144 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__STARTUP_ORCHESTRATOR_HPP_
+#define MANAGER_UTILS__STARTUP_ORCHESTRATOR_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cyberdog
+{
+namespace manager
+{
+
+/**
+ * @struct manager::StartupRecord
+ * @brief One step of startup timeline, times are seconds since run() started
+ */
+struct StartupRecord
+{
+  std::string unit;
+  std::string step;
+  double start_s;
+  double end_s;
+  uint32_t attempts;
+  bool succeed;
+};
+
+/**
+ * @class manager::StartupOrchestrator
+ * @brief Runs startup units on a bounded worker pool. Steps inside one unit run
+ * in order, a unit starts once all of its dependencies succeed. A unit whose
+ * dependency fails is skipped.
+ */
+class StartupOrchestrator
+{
+public:
+  using Step_T = std::function<bool()>;
+
+  /**
+   * @brief A constructor for manager::StartupOrchestrator
+   * @param max_parallel Maximum number of units running at the same time
+   * @param retry_period Waiting time before retrying a failed step
+   * @param max_attempts Attempts of every required step before the unit fails,
+   * 0 means retry until ok
+   */
+  explicit StartupOrchestrator(
+    const size_t max_parallel = 2,
+    const std::chrono::milliseconds retry_period = std::chrono::milliseconds(100),
+    const uint32_t max_attempts = 50);
+
+  /**
+   * @brief Declare a unit
+   * @param name Unique name of unit
+   * @param dependencies Units which need to succeed before this one starts
+   * @return false if name is used
+   */
+  bool add_unit(const std::string & name, const std::vector<std::string> & dependencies = {});
+  /**
+   * @brief Append a step to a declared unit
+   * @param required Optional step is tried once, its failure is recorded only
+   * @return false if unit is unknown
+   */
+  bool add_step(
+    const std::string & unit, const std::string & step, Step_T function,
+    const bool required = true);
+
+  /**
+   * @brief Run all units, blocks until every unit succeeds, fails or is skipped
+   * @return true if every unit succeeds
+   */
+  bool run();
+
+  std::vector<StartupRecord> timeline() const;
+  /**
+   * @brief Readable timeline, one line per step in starting order
+   */
+  std::string timeline_str() const;
+
+private:
+  enum UnitStatus
+  {
+    UNIT_WAITING = 0,
+    UNIT_RUNNING = 1,
+    UNIT_SUCCEED = 2,
+    UNIT_FAILED  = 3,
+    UNIT_SKIPPED = 4
+  };
+
+  struct Step
+  {
+    std::string name;
+    Step_T function;
+    bool required;
+  };
+
+  struct Unit
+  {
+    std::string name;
+    std::vector<std::string> dependencies;
+    std::vector<Step> steps;
+    std::vector<size_t> dependents;
+    size_t pending{0};
+    uint8_t status{UNIT_WAITING};
+  };
+
+  bool resolve();
+  bool run_unit(const size_t index);
+  void finish_unit(const size_t index, const bool succeed, std::vector<size_t> & ready);
+  void worker();
+  double since_start() const;
+
+  size_t max_parallel_;
+  std::chrono::milliseconds retry_period_;
+  uint32_t max_attempts_;
+  std::vector<Unit> units_;
+  std::vector<StartupRecord> records_;
+  std::chrono::steady_clock::time_point start_time_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<size_t> ready_;
+  size_t finished_{0};
+};
+}  // namespace manager
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__STARTUP_ORCHESTRATOR_HPP_
@@ -0,0 +1,164 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__STATE_BUS_HPP_
+#define MANAGER_UTILS__STATE_BUS_HPP_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace cyberdog
+{
+namespace manager
+{
+
+/**
+ * @brief QoS of topics between managers, intra-process needs keep last and volatile
+ */
+inline rclcpp::QoS intra_process_qos(const size_t depth = 10)
+{
+  return rclcpp::QoS(rclcpp::KeepLast(depth)).reliable().durability_volatile();
+}
+
+/**
+ * @class manager::StateChannel
+ * @brief Latest value of one typed state shared inside the process.
+ * Publishing copies the state into the channel, nothing is serialized or
+ * queued. Readers poll the latest value with a cursor on their own thread,
+ * so the publisher never runs code of a reader.
+ */
+template<typename T>
+class StateChannel
+{
+public:
+  using SharedPtr = std::shared_ptr<StateChannel<T>>;
+
+  /**
+   * @brief Store state
+   * @param state New state
+   */
+  void publish(const T & state)
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    state_ = state;
+    sequence_++;
+  }
+
+  /**
+   * @brief Copy latest state
+   * @param state Latest state if published
+   * @return False if nothing is published yet
+   */
+  bool latest(T & state) const
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (sequence_ == 0) {
+      return false;
+    }
+    state = state_;
+    return true;
+  }
+
+  /**
+   * @brief Copy latest state if published after cursor
+   * @param state Latest state if newer
+   * @param cursor Sequence seen by caller, start from 0
+   * @return True if state is newer than cursor
+   */
+  bool take(T & state, uint64_t & cursor) const
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (sequence_ == cursor) {
+      return false;
+    }
+    state = state_;
+    cursor = sequence_;
+    return true;
+  }
+
+  /**
+   * @brief Number of publishing since creation
+   */
+  uint64_t sequence() const
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return sequence_;
+  }
+
+private:
+  mutable std::mutex state_mutex_;
+  T state_;
+  uint64_t sequence_{0};
+};
+
+/**
+ * @class manager::StateBus
+ * @brief Named state channels shared by managers of one process, for
+ * internal signals which never leave the process.
+ */
+class StateBus
+{
+public:
+  static StateBus & instance()
+  {
+    static StateBus bus;
+    return bus;
+  }
+
+  /**
+   * @brief Get or create channel
+   * @param name Name of channel
+   * @return Channel, nullptr if name is used by another type
+   */
+  template<typename T>
+  typename StateChannel<T>::SharedPtr channel(const std::string & name)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = channels_.find(name);
+    if (found == channels_.end()) {
+      auto created = std::make_shared<StateChannel<T>>();
+      channels_.emplace(name, Entry{std::type_index(typeid(T)), created});
+      return created;
+    }
+    if (found->second.type != std::type_index(typeid(T))) {
+      RCLCPP_ERROR(
+        rclcpp::get_logger("state_bus"), "State channel [%s] is used by type %s",
+        name.c_str(), found->second.type.name());
+      return nullptr;
+    }
+    return std::static_pointer_cast<StateChannel<T>>(found->second.channel);
+  }
+
+private:
+  struct Entry
+  {
+    std::type_index type;
+    std::shared_ptr<void> channel;
+  };
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> channels_;
+};
+}  // namespace manager
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__STATE_BUS_HPP_
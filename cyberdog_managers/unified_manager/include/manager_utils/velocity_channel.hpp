@@ -0,0 +1,236 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MANAGER_UTILS__VELOCITY_CHANNEL_HPP_
+#define MANAGER_UTILS__VELOCITY_CHANNEL_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace cyberdog
+{
+namespace manager
+{
+
+/**
+ * @enum manager::VelocitySource
+ * @brief Sources of velocity command, smaller value has higher priority
+ */
+enum VelocitySource
+{
+  VSOURCE_INTERNAL  = 0,
+  VSOURCE_REMOTEC   = 1,
+  VSOURCE_NAVIGATOR = 2,
+  VSOURCE_COUNT     = 3
+};
+
+/**
+ * @struct manager::VelocitySetpoint
+ * @brief Plain velocity setpoint carried by velocity channel
+ */
+struct VelocitySetpoint
+{
+  double linear[3]{0.0, 0.0, 0.0};
+  double angular[3]{0.0, 0.0, 0.0};
+};
+
+/**
+ * @class manager::VelocityChannel
+ * @brief Preallocated velocity command channel with one slot per source.
+ * Any thread may push into a source slot, only the control thread consumes.
+ * Consuming picks the highest priority slot which is not expired, and gives
+ * zeros when every slot is expired. No allocation after construction.
+ */
+class VelocityChannel
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief A constructor for manager::VelocityChannel
+   * @param expiry Setpoint older than expiry will be ignored by consumer
+   */
+  explicit VelocityChannel(std::chrono::nanoseconds expiry = std::chrono::milliseconds(300))
+  : expiry_ns_(expiry.count())
+  {
+    for (auto & slot : slots_) {
+      slot.stamp_ns.store(0, std::memory_order_relaxed);
+      for (auto & value : slot.value) {
+        value.store(0.0, std::memory_order_relaxed);
+      }
+    }
+    consumed_.fill(0);
+  }
+
+  /**
+   * @brief Reset expiry of setpoints
+   * @param expiry Setpoint older than expiry will be ignored by consumer
+   */
+  void set_expiry(std::chrono::nanoseconds expiry)
+  {
+    expiry_ns_.store(expiry.count(), std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Write setpoint into the slot of source
+   * @param source Velocity source, see manager::VelocitySource
+   * @param setpoint Setpoint to write
+   * @param stamp Time of setpoint, used for expiry
+   * @return false if source is unknown
+   */
+  bool push(
+    const uint8_t source, const VelocitySetpoint & setpoint,
+    const Clock::time_point stamp = Clock::now())
+  {
+    if (source >= VSOURCE_COUNT) {
+      return false;
+    }
+    auto & slot = slots_[source];
+    write_begin(slot);
+    for (uint8_t i = 0; i < 3; i++) {
+      slot.value[i].store(setpoint.linear[i], std::memory_order_relaxed);
+      slot.value[i + 3].store(setpoint.angular[i], std::memory_order_relaxed);
+    }
+    slot.stamp_ns.store(stamp.time_since_epoch().count(), std::memory_order_relaxed);
+    write_end(slot);
+    slot.pushed.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Zero all slots, stamps are kept
+   * @param notify Whether consumer sees clearing as a new command
+   */
+  void clear(const bool notify = true)
+  {
+    for (auto & slot : slots_) {
+      write_begin(slot);
+      for (auto & value : slot.value) {
+        value.store(0.0, std::memory_order_relaxed);
+      }
+      write_end(slot);
+    }
+    if (notify) {
+      cleared_.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  /**
+   * @brief Zero angular velocity of all slots, stamps are kept
+   */
+  void clear_angular()
+  {
+    for (auto & slot : slots_) {
+      write_begin(slot);
+      for (uint8_t i = 3; i < 6; i++) {
+        slot.value[i].store(0.0, std::memory_order_relaxed);
+      }
+      write_end(slot);
+    }
+  }
+
+  /**
+   * @brief Read the setpoint to execute. Only called from the consumer thread
+   * @param setpoint Setpoint to return, zeros if every slot is expired
+   * @param source Source of setpoint to return, VSOURCE_COUNT if every slot is expired
+   * @param now Current time, used for expiry
+   * @return true if any setpoint was pushed or cleared since last consuming
+   */
+  bool consume(
+    VelocitySetpoint & setpoint, uint8_t & source,
+    const Clock::time_point now = Clock::now())
+  {
+    bool fresh(false);
+    const auto expiry_ns = expiry_ns_.load(std::memory_order_relaxed);
+    const auto now_ns = now.time_since_epoch().count();
+    setpoint = VelocitySetpoint();
+    source = VSOURCE_COUNT;
+
+    auto cleared = cleared_.load(std::memory_order_acquire);
+    if (cleared != consumed_cleared_) {
+      consumed_cleared_ = cleared;
+      fresh = true;
+    }
+    for (uint8_t i = 0; i < VSOURCE_COUNT; i++) {
+      auto pushed = slots_[i].pushed.load(std::memory_order_acquire);
+      if (pushed != consumed_[i]) {
+        consumed_[i] = pushed;
+        fresh = true;
+      }
+    }
+    for (uint8_t i = 0; i < VSOURCE_COUNT; i++) {
+      int64_t stamp_ns(0);
+      VelocitySetpoint candidate;
+      read(slots_[i], candidate, stamp_ns);
+      if (stamp_ns != 0 && now_ns - stamp_ns <= expiry_ns) {
+        setpoint = candidate;
+        source = i;
+        break;
+      }
+    }
+    return fresh;
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic_flag writing = ATOMIC_FLAG_INIT;
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> pushed{0};
+    std::atomic<int64_t> stamp_ns;
+    std::array<std::atomic<double>, 6> value;
+  };
+
+  // Writers of one slot are serialized by a spin flag, readers use sequence checking
+  void write_begin(Slot & slot)
+  {
+    while (slot.writing.test_and_set(std::memory_order_acquire)) {}
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void write_end(Slot & slot)
+  {
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    slot.writing.clear(std::memory_order_release);
+  }
+
+  void read(const Slot & slot, VelocitySetpoint & setpoint, int64_t & stamp_ns) const
+  {
+    uint32_t seq_begin(0);
+    uint32_t seq_end(0);
+    do {
+      seq_begin = slot.seq.load(std::memory_order_acquire);
+      for (uint8_t i = 0; i < 3; i++) {
+        setpoint.linear[i] = slot.value[i].load(std::memory_order_relaxed);
+        setpoint.angular[i] = slot.value[i + 3].load(std::memory_order_relaxed);
+      }
+      stamp_ns = slot.stamp_ns.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      seq_end = slot.seq.load(std::memory_order_relaxed);
+    } while (seq_begin != seq_end || (seq_begin & 1));
+  }
+
+  std::atomic<int64_t> expiry_ns_;
+  std::atomic<uint32_t> cleared_{0};
+  uint32_t consumed_cleared_{0};
+  std::array<Slot, VSOURCE_COUNT> slots_;
+  std::array<uint32_t, VSOURCE_COUNT> consumed_;
+};
+}  // namespace manager
+}  // namespace cyberdog
+
+#endif  // MANAGER_UTILS__VELOCITY_CHANNEL_HPP_
@@ -31,6 +31,7 @@
 // ROS headers
 #include "ament_index_cpp/get_package_share_directory.hpp"
 #include "manager_utils/cascade_manager.hpp"
+#include "manager_utils/state_bus.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 // Other headers
@@ -92,6 +93,7 @@ private:
 
 // Publisher
   rclcpp_lifecycle::LifecyclePublisher<Safety_T>::SharedPtr guard_pub_;
+  StateChannel<Safety_T>::SharedPtr guard_state_;
 
 // Package directories
   std::string local_params_dir;
@@ -16,6 +16,7 @@
 #define MANAGERS__MOTION_MANAGER_HPP_
 
 // C++ headers
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <map>
@@ -68,6 +69,10 @@
 #include "cyberdog_utils/action_server.hpp"
 #include "manager_utils/bt_action_server.hpp"
 #include "manager_utils/cascade_manager.hpp"
+#include "manager_utils/deadline_loop.hpp"
+#include "manager_utils/log_queue.hpp"
+#include "manager_utils/state_bus.hpp"
+#include "manager_utils/velocity_channel.hpp"
 #include "managers/automation_manager.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "tf2/LinearMath/Quaternion.h"
@@ -75,7 +80,7 @@
 #include "tf2_ros/buffer.h"
 #include "tf2_ros/transform_listener.h"
 #include "tf2_ros/create_timer_ros.h"
-#include "tf2_ros/transform_broadcaster.h"
+#include "tf2_msgs/msg/tf_message.hpp"
 // other headers
 #include "lcm/lcm-cpp.hpp"
 #include "toml11/toml.hpp"
@@ -115,6 +120,8 @@ using SE3Pose_T = motion_msgs::msg::SE3Pose;
 using SE3Velocity_T = motion_msgs::msg::SE3Velocity;
 using SE3VelocityCMD_T = motion_msgs::msg::SE3VelocityCMD;
 using Time_T = builtin_interfaces::msg::Time;
+using TFMessage_T = tf2_msgs::msg::TFMessage;
+using Odometry_T = nav_msgs::msg::Odometry;
 using SubMode_T = automation_msgs::srv::NavMode;
 using SubModeReq_T = automation_msgs::srv::NavMode::Request;
 using ErrorFlag_T = motion_msgs::msg::ErrorFlag;
@@ -163,6 +170,8 @@ private:
   void caution_callback(const NavCaution_T::SharedPtr msg);
   void control_state_callback(const ControlState_T::SharedPtr msg);
   void guard_callback(const Safety_T::SharedPtr msg);
+  void take_guard();
+  void update_guard(const Safety_T & guard);
 
 // LCM message callback & LCM handler
   void control_lcm_collection(
@@ -183,13 +192,15 @@ private:
 
 // Topic publisher
   void publish_velocity(
-    const SE3VelocityCMD_T::SharedPtr velocity_out,
+    const SE3VelocityCMD_T & velocity_out,
     const int8_t ORDER_TYPE = MonOrder_T::MONO_ORDER_NULL);
   void publish_mode(const Mode_T & mode_out);
   void publish_gait(const Gait_T & gait_out, const bool order_req = false);
   void publish_control_state(const ControlState_T & control_state_out);
   void publish_paras(const Parameters_T paras_out);
   void publish_odom(const nav_msgs::msg::Odometry & odom_out);
+  void publish_odom_sample(const state_estimator_lcmt * lcm_data, const Time_T & odom_stamp);
+  void publish_body_tf(const Odometry_T & odom_sample);
 
 // Internal abstract function
   void init();
@@ -197,6 +208,10 @@ private:
   bool check_time_update(
     Time_T coming_time,
     Time_T stash_time);
+  void fill_odom_sample(
+    const state_estimator_lcmt * lcm_data, const Time_T & odom_stamp,
+    Odometry_T & odom_sample);
+  void update_odom_subscribers(const bool force = false);
 
 // Internal function
   void movement_detection();
@@ -206,6 +221,7 @@ private:
     const uint8_t & priority);
   void automation_node_spin();
   void control_cmd_spin();
+  void control_log_spin();
   template<typename T>
   void parameter_check(
     const T & max_value, T & value_to_check, const std::string & value_name,
@@ -224,6 +240,9 @@ private:
   inline static int rate_wait_loop_;
   inline static int rate_odom_;
   inline static int rate_lcm_const_;
+// parameters<int> realtime
+  inline static int rt_priority_control_;
+  inline static int rt_cpu_control_;
 // parameters<int> timeout
   inline static int timeout_manager_;
   inline static int timeout_motion_;
@@ -257,15 +276,25 @@ private:
 // Transforms
   std::unique_ptr<tf2_ros::Buffer> tf_;
   std::unique_ptr<tf2_ros::TransformListener> tf_listener_;
-  geometry_msgs::msg::TransformStamped robot_body_tf_;
   geometry_msgs::msg::TransformStamped robot_global_tf_;
-  std::unique_ptr<tf2_ros::TransformBroadcaster> tf_broadcaster;
+// Body TF keeps one preallocated transform, filled from the odom sample
+  TFMessage_T robot_body_tf_;
+// Cached subscriber state, refreshed on graph change instead of per sample
+  rclcpp::Event::SharedPtr odom_graph_event_;
+  std::atomic_bool odom_subscribed_;
+  std::atomic_bool tf_subscribed_;
 
 // LCM handler & messages
   std::unique_ptr<lcm::LCM> motion_out_;
   std::unique_ptr<lcm::LCM> motion_in_;
   std::unique_ptr<lcm::LCM> state_es_in_;
-  inline static motion_control_request_lcmt ros_to_lcm_data_;
+// Owned by control thread only, other threads write through command channel
+  motion_control_request_lcmt ros_to_lcm_data_;
+  VelocityChannel velocity_channel_;
+  std::atomic<int8_t> cmd_pattern_;
+  std::atomic<int8_t> cmd_order_;
+  std::atomic<double> cmd_body_height_;
+  std::atomic<double> cmd_gait_height_;
   std::vector<trajectory_command_lcmt> _motionList;
   inline static uint32_t response_count_;
   inline static uint32_t odom_count_;
@@ -298,6 +327,10 @@ private:
   std::unique_ptr<std::thread> lcm_statees_res_handle_thread_;
   std::unique_ptr<std::thread> automation_node_thread_;
   std::unique_ptr<std::thread> control_cmd_thread_;
+  std::unique_ptr<std::thread> control_log_thread_;
+// Control thread timing & logging, control thread never calls logger directly
+  std::unique_ptr<DeadlineLoop> control_loop_;
+  LogQueue<64> control_log_;
   std::unique_ptr<std::thread> ros_switch_order_thread_;
 
 // Action Server
@@ -326,11 +359,20 @@ private:
   rclcpp::Subscription<ControlState_T>::SharedPtr control_state_sub_;
   rclcpp::Subscription<Safety_T>::SharedPtr guard_sub_;
 
+// State bus, guard arrives from ception manager of the same process
+  bool use_state_bus_;
+  StateChannel<Safety_T>::SharedPtr guard_state_;
+  rclcpp::TimerBase::SharedPtr guard_timer_;
+  uint64_t guard_cursor_;
+// Velocity constraints are changed by guard and read by orders outside control group
+  std::mutex guard_mutex_;
+
 // Publisher
   rclcpp_lifecycle::LifecyclePublisher<Gait_T>::SharedPtr gait_pub_;
   rclcpp::Publisher<Gait_T>::SharedPtr gait_pub_temp_;
   rclcpp_lifecycle::LifecyclePublisher<ControlState_T>::SharedPtr control_state_pub_;
   rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::Odometry>::SharedPtr odom_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<TFMessage_T>::SharedPtr tf_pub_;
   rclcpp_lifecycle::LifecyclePublisher<SE3VelocityCMD_T>::SharedPtr cmd_pub_;
 
 // Node individual
@@ -0,0 +1,36 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <iostream>
+
+#include "manager_utils/bt_binary_logger.hpp"
+
+int main(int argc, char ** argv)
+{
+  if (argc < 2) {
+    std::cerr << "Usage: bt_log_decoder <log_file>" << std::endl;
+    return 1;
+  }
+  std::ifstream in(argv[1], std::ios::binary);
+  if (!in.good()) {
+    std::cerr << "Couldn't open " << argv[1] << std::endl;
+    return 1;
+  }
+  if (!cyberdog::bt_engine::decode_bt_log(in, std::cout)) {
+    std::cerr << "Log is broken or truncated" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -12,13 +12,63 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
 #include <exception>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "managers/ception_manager.hpp"
 #include "managers/interaction_manager.hpp"
 #include "managers/motion_manager.hpp"
+#include "manager_utils/executor_layout.hpp"
+#include "manager_utils/startup_orchestrator.hpp"
+
+using State_T = lifecycle_msgs::msg::State;
+using Transition_T = lifecycle_msgs::msg::Transition;
+
+/**
+ * @brief Add configure, activate and chain steps of one manager
+ */
+static void add_manager(
+  cyberdog::manager::StartupOrchestrator & orchestrator,
+  const std::string & unit,
+  const std::shared_ptr<cyberdog::manager::CascadeManager> & node,
+  const std::vector<std::string> & dependencies = {})
+{
+  orchestrator.add_unit(unit, dependencies);
+  orchestrator.add_step(
+    unit, "configure", [node]() {
+      if (node->get_current_state().id() == State_T::PRIMARY_STATE_UNCONFIGURED) {
+        node->trigger_transition(Transition_T::TRANSITION_CONFIGURE);
+      }
+      auto state = node->get_current_state().id();
+      return state == State_T::PRIMARY_STATE_INACTIVE || state == State_T::PRIMARY_STATE_ACTIVE;
+    });
+  orchestrator.add_step(
+    unit, "activate", [node, failed = false]() mutable {
+      auto state = node->get_current_state().id();
+      // Failed activate may leave half set up resources, start again from a clean configure.
+      // Error handling drops node to unconfigured, or finalized which is never retried ok.
+      if (failed && state == State_T::PRIMARY_STATE_INACTIVE) {
+        state = node->trigger_transition(Transition_T::TRANSITION_CLEANUP).id();
+      }
+      if (state == State_T::PRIMARY_STATE_UNCONFIGURED) {
+        state = node->trigger_transition(Transition_T::TRANSITION_CONFIGURE).id();
+      }
+      if (state == State_T::PRIMARY_STATE_INACTIVE) {
+        state = node->trigger_transition(Transition_T::TRANSITION_ACTIVATE).id();
+      }
+      failed = state != State_T::PRIMARY_STATE_ACTIVE;
+      return !failed;
+    });
+  // Chain checking is bounded by timeout_manager_s, partial chain does not block dependents
+  orchestrator.add_step(
+    unit, "chain", [node]() {
+      return node->wait_chain(std::chrono::seconds(60));
+    }, false);
+}
 
 int main(int argc, char ** argv)
 {
@@ -30,18 +80,25 @@ int main(int argc, char ** argv)
   auto node_motion = std::make_shared<cyberdog::manager::MotionManager>();
   auto node_cept = std::make_shared<cyberdog::manager::CeptionManager>();
   auto node_inter = std::make_shared<cyberdog::manager::InteractionManager>();
-  bool started = false;
 
-  while (!started) {
-    started = node_motion->auto_check(cyberdog_utils::CHECK_TO_START);
-    started &= node_cept->auto_check(cyberdog_utils::CHECK_TO_START);
-    started &= node_inter->auto_check(cyberdog_utils::CHECK_TO_START);
+  // Chain checking needs node states delivered, so spin before bringup
+  cyberdog::manager::ExecutorLayout layout;
+  layout.load();
+  for (const auto & node : std::vector<std::shared_ptr<cyberdog::manager::CascadeManager>>{
+      node_motion, node_cept, node_inter})
+  {
+    layout.add_node(node->get_node_base_interface(), node->concern_groups());
   }
-  rclcpp::executors::MultiThreadedExecutor exec_;
-  exec_.add_node(node_motion->get_node_base_interface());
-  exec_.add_node(node_cept->get_node_base_interface());
-  exec_.add_node(node_inter->get_node_base_interface());
-  exec_.spin();
+  layout.spin();
+
+  // Ception plays audio through interaction's chained nodes
+  cyberdog::manager::StartupOrchestrator orchestrator(2);
+  add_manager(orchestrator, "motion", node_motion);
+  add_manager(orchestrator, "interaction", node_inter);
+  add_manager(orchestrator, "ception", node_cept, {"interaction"});
+  orchestrator.run();
+
+  layout.join();
   rclcpp::shutdown();
 
   return 0;
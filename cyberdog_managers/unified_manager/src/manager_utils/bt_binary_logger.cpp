@@ -0,0 +1,264 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "manager_utils/bt_binary_logger.hpp"
+
+namespace cyberdog
+{
+namespace bt_engine
+{
+
+namespace
+{
+template<typename T>
+void append(std::vector<uint8_t> & buffer, const T & value)
+{
+  auto bytes = reinterpret_cast<const uint8_t *>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void append_string(std::vector<uint8_t> & buffer, const std::string & text)
+{
+  auto length = static_cast<uint16_t>(std::min<size_t>(text.size(), UINT16_MAX));
+  append(buffer, length);
+  buffer.insert(buffer.end(), text.begin(), text.begin() + length);
+}
+
+template<typename T>
+bool read(std::istream & in, T & value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+bool read_string(std::istream & in, std::string & text)
+{
+  uint16_t length;
+  if (!read(in, length)) {
+    return false;
+  }
+  text.resize(length);
+  return length == 0 || static_cast<bool>(in.read(&text[0], length));
+}
+
+const char * status_str(const uint8_t status)
+{
+  // Same order as BT::NodeStatus
+  static const char * names[] = {"IDLE", "RUNNING", "SUCCESS", "FAILURE"};
+  return status < 4 ? names[status] : "UNKNOWN";
+}
+}  // namespace
+
+BtLogWriter::BtLogWriter(
+  const std::string & file_path,
+  const std::chrono::milliseconds flush_period)
+: file_(std::fopen(file_path.c_str(), "ab")),
+  flush_period_(flush_period),
+  head_(0),
+  tail_(0),
+  dropped_(0),
+  running_(true)
+{
+  for (uint32_t i = 0; i < CAPACITY; i++) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  if (file_ == nullptr) {
+    return;
+  }
+  std::fseek(file_, 0, SEEK_END);
+  if (std::ftell(file_) == 0) {
+    std::fwrite(BT_LOG_MAGIC, 1, sizeof(BT_LOG_MAGIC) - 1, file_);
+  }
+  write_thread_ = std::thread(&BtLogWriter::write_spin, this);
+}
+
+BtLogWriter::~BtLogWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cv_.notify_all();
+  if (write_thread_.joinable()) {
+    write_thread_.join();
+  }
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+}
+
+void BtLogWriter::add_tree(const BT::Tree & tree)
+{
+  std::vector<uint8_t> table;
+  append(table, BT_LOG_TABLE);
+  append(table, static_cast<uint16_t>(tree.nodes.size()));
+  for (const auto & node : tree.nodes) {
+    append(table, node->UID());
+    append_string(table, node->name());
+    append_string(table, node->registrationName());
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_tables_.insert(pending_tables_.end(), table.begin(), table.end());
+}
+
+void BtLogWriter::push(
+  const int64_t stamp_ns, const uint16_t uid,
+  const uint8_t prev, const uint8_t status)
+{
+  auto head = head_.load(std::memory_order_relaxed);
+  Slot * slot;
+  while (true) {
+    slot = &slots_[head & (CAPACITY - 1)];
+    auto diff = static_cast<int32_t>(slot->sequence.load(std::memory_order_acquire) - head);
+    if (diff == 0) {
+      if (head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      head = head_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->entry = Entry{stamp_ns, uid, prev, status};
+  slot->sequence.store(head + 1, std::memory_order_release);
+}
+
+bool BtLogWriter::pop(Entry & entry)
+{
+  auto & slot = slots_[tail_ & (CAPACITY - 1)];
+  if (static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) - (tail_ + 1)) < 0) {
+    return false;
+  }
+  entry = slot.entry;
+  slot.sequence.store(tail_ + CAPACITY, std::memory_order_release);
+  tail_++;
+  return true;
+}
+
+void BtLogWriter::write_spin()
+{
+  std::vector<Entry> entries;
+  entries.reserve(CAPACITY);
+  std::vector<uint8_t> tables;
+  bool running(true);
+  while (running) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait_for(lock, flush_period_, [this]() {return !running_;});
+      running = running_;
+      tables.swap(pending_tables_);
+    }
+    // Tables go first, changes of a new tree are only pushed after its table
+    if (!tables.empty()) {
+      std::fwrite(tables.data(), 1, tables.size(), file_);
+      tables.clear();
+    }
+    Entry entry;
+    while (pop(entry)) {
+      entries.push_back(entry);
+    }
+    auto dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (!entries.empty() || dropped != 0) {
+      write_batch(entries, dropped);
+      entries.clear();
+    }
+    std::fflush(file_);
+  }
+}
+
+void BtLogWriter::write_batch(const std::vector<Entry> & entries, const uint32_t dropped)
+{
+  int64_t base_ns = entries.empty() ? 0 : entries.front().stamp_ns;
+  for (const auto & entry : entries) {
+    base_ns = std::min(base_ns, entry.stamp_ns);
+  }
+  std::vector<uint8_t> batch;
+  batch.reserve(1 + sizeof(int64_t) + 2 * sizeof(uint32_t) + entries.size() * sizeof(BtLogRecord));
+  append(batch, BT_LOG_BATCH);
+  append(batch, base_ns);
+  append(batch, dropped);
+  append(batch, static_cast<uint32_t>(entries.size()));
+  for (const auto & entry : entries) {
+    BtLogRecord record{
+      static_cast<uint32_t>((entry.stamp_ns - base_ns) / 1000),
+      entry.uid, entry.prev_status, entry.status};
+    append(batch, record);
+  }
+  std::fwrite(batch.data(), 1, batch.size(), file_);
+}
+
+bool decode_bt_log(std::istream & in, std::ostream & out)
+{
+  char magic[sizeof(BT_LOG_MAGIC) - 1];
+  if (!in.read(magic, sizeof(magic)) ||
+    std::memcmp(magic, BT_LOG_MAGIC, sizeof(magic)) != 0)
+  {
+    return false;
+  }
+
+  std::unordered_map<uint16_t, std::string> names;
+  char line[256];
+  uint8_t tag;
+  while (read(in, tag)) {
+    if (tag == BT_LOG_TABLE) {
+      uint16_t count;
+      if (!read(in, count)) {
+        return false;
+      }
+      for (uint16_t i = 0; i < count; i++) {
+        uint16_t uid;
+        std::string name, registration;
+        if (!read(in, uid) || !read_string(in, name) || !read_string(in, registration)) {
+          return false;
+        }
+        names[uid] = name;
+      }
+    } else if (tag == BT_LOG_BATCH) {
+      int64_t base_ns;
+      uint32_t dropped, count;
+      if (!read(in, base_ns) || !read(in, dropped) || !read(in, count)) {
+        return false;
+      }
+      if (dropped != 0) {
+        out << "(" << dropped << " changes dropped)\n";
+      }
+      for (uint32_t i = 0; i < count; i++) {
+        BtLogRecord record;
+        if (!read(in, record)) {
+          return false;
+        }
+        auto name = names.find(record.uid);
+        std::snprintf(
+          line, sizeof(line), "[%.3f]: %25s %s -> %s\n",
+          (base_ns + int64_t(record.delta_us) * 1000) * 1e-9,
+          name == names.end() ? ("uid " + std::to_string(record.uid)).c_str() :
+          name->second.c_str(),
+          status_str(record.prev_status), status_str(record.status));
+        out << line;
+      }
+    } else {
+      return false;
+    }
+  }
+  return in.eof();
+}
+}  // namespace bt_engine
+}  // namespace cyberdog
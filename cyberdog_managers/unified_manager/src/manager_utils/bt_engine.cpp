@@ -14,6 +14,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <vector>
@@ -71,6 +75,47 @@ BehaviorTreeEngine::run(
   return (result == BT::NodeStatus::SUCCESS) ? BtStatus::SUCCEEDED : BtStatus::FAILED;
 }
 
+BtStatus
+BehaviorTreeEngine::run(
+  BT::Tree * tree,
+  std::function<void()> onLoop,
+  std::function<bool()> cancelRequested,
+  std::shared_ptr<BtWakeup> wakeup,
+  std::chrono::milliseconds maxPeriod)
+{
+  if (!wakeup) {
+    return run(tree, onLoop, cancelRequested, maxPeriod);
+  }
+  BT::NodeStatus result = BT::NodeStatus::RUNNING;
+
+  // Tick once at start, then only when a wakeup source fires or maxPeriod passes
+  try {
+    while (rclcpp::ok() && result == BT::NodeStatus::RUNNING) {
+      if (cancelRequested()) {
+        tree->rootNode()->halt();
+        return BtStatus::CANCELED;
+      }
+
+      // Notifications during tick are kept and wake the next wait immediately
+      auto seen = wakeup->sequence();
+      result = tree->tickRoot();
+
+      onLoop();
+
+      if (result == BT::NodeStatus::RUNNING) {
+        wakeup->wait(seen, maxPeriod);
+      }
+    }
+  } catch (const std::exception & ex) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("BehaviorTreeEngine"),
+      "Behavior tree threw exception: %s. Exiting with failure.", ex.what());
+    return BtStatus::FAILED;
+  }
+
+  return (result == BT::NodeStatus::SUCCESS) ? BtStatus::SUCCEEDED : BtStatus::FAILED;
+}
+
 BT::Tree
 BehaviorTreeEngine::createTreeFromText(
   const std::string & xml_string,
@@ -87,6 +132,68 @@ BehaviorTreeEngine::createTreeFromFile(
   return factory_.createTreeFromFile(file_path, blackboard);
 }
 
+uint64_t
+BehaviorTreeEngine::loadTreeModel(const std::string & file_path)
+{
+  struct stat file_stat;
+  if (stat(file_path.c_str(), &file_stat) != 0) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("BehaviorTreeEngine"), "Couldn't open input XML file: %s",
+      file_path.c_str());
+    return 0;
+  }
+  auto mtime_ns = int64_t(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+
+  std::lock_guard<std::mutex> lock(models_mutex_);
+  auto cached = models_.find(file_path);
+  if (cached != models_.end() && cached->second.mtime_ns == mtime_ns &&
+    cached->second.size == file_stat.st_size)
+  {
+    return cached->second.generation;
+  }
+
+  std::ifstream xml_file(file_path);
+  if (!xml_file.good()) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("BehaviorTreeEngine"), "Couldn't open input XML file: %s",
+      file_path.c_str());
+    return 0;
+  }
+  auto xml_string = std::string(
+    std::istreambuf_iterator<char>(xml_file),
+    std::istreambuf_iterator<char>());
+
+  // Parsing verifies the XML and that every node type is registered by plugins
+  auto parser = std::make_shared<BT::XMLParser>(factory_);
+  try {
+    parser->loadFromText(xml_string);
+  } catch (const std::exception & ex) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("BehaviorTreeEngine"), "Invalid XML file %s: %s",
+      file_path.c_str(), ex.what());
+    return 0;
+  }
+  models_[file_path] = TreeModel{mtime_ns, file_stat.st_size, ++model_generation_, parser};
+  return model_generation_;
+}
+
+BT::Tree
+BehaviorTreeEngine::createTreeFromModel(
+  const std::string & file_path,
+  BT::Blackboard::Ptr blackboard)
+{
+  std::shared_ptr<BT::XMLParser> parser;
+  {
+    std::lock_guard<std::mutex> lock(models_mutex_);
+    auto cached = models_.find(file_path);
+    if (cached == models_.end()) {
+      throw std::runtime_error("BT model of " + file_path + " is not loaded");
+    }
+    parser = cached->second.parser;
+  }
+  return parser->instantiateTree(blackboard);
+}
+
 // void
 // BehaviorTreeEngine::addGrootMonitoring(
 //   BT::Tree * tree,
@@ -30,7 +30,9 @@ namespace manager
 
 CascadeManager::CascadeManager(const std::string node_name, const std::string node_list_name)
 : cyberdog_utils::LifecycleNode(node_name),
-  node_list_name_(node_list_name)
+  chainnodes_state_(STATE_NULL),
+  node_list_name_(node_list_name),
+  checking_(false)
 {
   message_info(std::string("Creating ") + this->get_name());
 
@@ -51,47 +53,51 @@ CascadeManager::CascadeManager(const std::string node_name, const std::string no
 }
 
 CascadeManager::~CascadeManager()
-{}
+{
+  stop_checking();
+}
 
 bool CascadeManager::manager_configure(const std::string node_list_name)
 {
   bool rtn_(false);
   if (manager_type != SINGLE_MANAGER) {
-    if (chainnodes_state_ != STATE_NULL) {
-      thread_flag_ = false;
-      sub_node_checking->join();
-    }
+    stop_checking();
     chainnodes_state_ = STATE_NULL;
-    thread_flag_ = false;
-    node_map_.clear();
+    node_states_.reset();
+    node_list_.clear();
+    node_index_.clear();
     this->clear_activation();
     auto node_name_list = manager_type == SINGLE_LIST ?
       this->get_parameter(node_list_name_).as_string_array() :
       this->get_parameter(node_list_name).as_string_array();
 
-    if (node_name_list.size() != 0) {
-      for (auto & node_name : node_name_list) {
-        if (node_map_.find(node_name) == node_map_.end()) {
-          node_map_.insert(
-            std::pair<std::string, uint8_t>(
-              node_name,
-              lifecycle_msgs::msg::State::PRIMARY_STATE_UNKNOWN));
-          message_info(
-            std::string("Add ") +
-            node_name +
-            std::string(" to node chain list of ") +
-            this->get_name());
-        }
+    for (auto & node_name : node_name_list) {
+      if (node_index_.find(node_name) == node_index_.end()) {
+        node_index_.insert(std::pair<std::string, size_t>(node_name, node_list_.size()));
+        node_list_.push_back(node_name);
+        message_info(
+          std::string("Add ") +
+          node_name +
+          std::string(" to node chain list of ") +
+          this->get_name());
       }
-      node_name_set_.clear();
-      node_name_set_.insert(begin(node_name_list), end(node_name_list));
+    }
+    if (!node_tracker_.reset(node_list_.size())) {
+      message_error(
+        std::string("Node chain list of ") +
+        this->get_name() +
+        std::string(" is longer than ") +
+        std::to_string(CompletionTracker::MAX_NODES));
+      node_list_.clear();
+      node_index_.clear();
+      return rtn_;
     }
 
     timeout_manager_ = this->get_parameter("timeout_manager_s").as_int();
 
     node_states_ = this->create_subscription<cascade_lifecycle_msgs::msg::State>(
       "cascade_lifecycle_states",
-      rclcpp::QoS(100),
+      cyberdog_utils::cascade_states_qos(),
       std::bind(&CascadeManager::node_state_callback, this, std::placeholders::_1));
     rtn_ = true;
   }
@@ -102,16 +108,10 @@ bool CascadeManager::manager_activate()
 {
   bool rtn_(false);
   if (manager_type != SINGLE_MANAGER) {
-    for (auto & node : node_map_) {
-      this->add_activation(static_cast<std::string>(node.first));
-    }
-    if (chainnodes_state_ != STATE_NULL) {
-      thread_flag_ = false;
-      sub_node_checking->join();
+    for (auto & node_name : node_list_) {
+      this->add_activation(node_name);
     }
-    thread_flag_ = true;
-    sub_node_checking = std::make_unique<std::thread>(
-      &CascadeManager::node_status_checking, this, IS_ACTIVE);
+    start_checking(IS_ACTIVE);
     rtn_ = true;
   }
   return rtn_;
@@ -121,11 +121,7 @@ bool CascadeManager::manager_deactivate()
 {
   bool rtn_(false);
   if (manager_type != SINGLE_MANAGER) {
-    thread_flag_ = false;
-    sub_node_checking->join();
-    thread_flag_ = true;
-    sub_node_checking = std::make_unique<std::thread>(
-      &CascadeManager::node_status_checking, this, IS_DEACTIVE);
+    start_checking(IS_DEACTIVE);
     rtn_ = true;
   }
   return rtn_;
@@ -134,12 +130,12 @@ bool CascadeManager::manager_deactivate()
 bool CascadeManager::manager_cleanup()
 {
   bool rtn_(false);
-  thread_flag_ = false;
   if (manager_type != SINGLE_MANAGER) {
-    sub_node_checking->join();
-    node_map_.clear();
+    stop_checking();
     node_states_.reset();
-    sub_node_checking.reset();
+    node_list_.clear();
+    node_index_.clear();
+    node_tracker_.reset(0);
     rtn_ = true;
   }
   return rtn_;
@@ -147,97 +143,104 @@ bool CascadeManager::manager_cleanup()
 
 bool CascadeManager::manager_shutdown()
 {
-  bool rtn_(false);
-  thread_flag_ = false;
-  if (manager_type != SINGLE_MANAGER) {
-    sub_node_checking->join();
-    node_map_.clear();
-    node_states_.reset();
-    sub_node_checking.reset();
-    rtn_ = true;
-  }
-  return rtn_;
+  return manager_cleanup();
 }
 
 bool CascadeManager::manager_error()
 {
-  bool rtn_(false);
-  thread_flag_ = false;
-  if (manager_type != SINGLE_MANAGER) {
-    sub_node_checking->join();
-    node_map_.clear();
-    node_states_.reset();
-    sub_node_checking.reset();
-    rtn_ = true;
-  }
-  return rtn_;
+  return manager_cleanup();
 }
 
 void CascadeManager::node_state_callback(const cascade_lifecycle_msgs::msg::State::SharedPtr msg)
 {
-  if (node_name_set_.find(msg->node_name) != node_name_set_.end()) {
-    node_map_[msg->node_name] = msg->state;
+  auto node = node_index_.find(msg->node_name);
+  if (node != node_index_.end()) {
+    node_tracker_.set_state(node->second, msg->state);
   }
 }
 
 void CascadeManager::node_status_checking(const State_Req req_type)
 {
-  auto activations = this->get_activations();
-  rclcpp::WallRate activating_rate(4);
-  rclcpp::Time start_time(this->get_clock()->now());
-  std::set<std::string> active_set;
-  auto timeout_count = (this->get_clock()->now() - start_time).seconds();
+  auto start_time = std::chrono::steady_clock::now();
 
-  while (rclcpp::ok() && thread_flag_ &&
-    (this->get_clock()->now() - start_time <= std::chrono::seconds(timeout_manager_)))
-  {
-    timeout_count = (this->get_clock()->now() - start_time).seconds();
+  // Returns as soon as the slowest node reaches req_type
+  node_tracker_.arm(req_type);
+  auto all_reached = node_tracker_.wait(std::chrono::seconds(timeout_manager_));
+  auto cost_time = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start_time).count();
 
-    if (active_set.size() == node_map_.size()) {
-      break;
+  for (size_t index = 0; index < node_list_.size(); index++) {
+    if (node_tracker_.done(index)) {
+      message_info(
+        std::string("Node [") +
+        node_list_[index] +
+        std::string("] is ") +
+        state_map_[req_type]);
+    } else {
+      message_error(
+        std::string("After ") +
+        std::to_string(cost_time) +
+        std::string(" seconds. Node ") +
+        node_list_[index] +
+        std::string(" is still not ") +
+        state_map_[req_type]);
     }
-    if (node_map_.size() == 0) {
-      break;
-    }
-
-    for (auto & activation : activations) {
-      if (node_map_[activation] == req_type &&
-        active_set.find(activation) == active_set.end())
-      {
-        message_info(
-          std::string("Node [") +
-          activation +
-          std::string("] is ") +
-          state_map_[req_type]);
-        active_set.insert(activation);
-      }
-    }
-    activating_rate.sleep();
   }
-
-  uint8_t unchanged_count_(0);
-  if (activations.size() != 0) {
-    for (auto & activation : activations) {
-      if (node_map_[activation] != req_type) {
-        unchanged_count_ += 1;
-        message_error(
-          std::string("After ") +
-          std::to_string(timeout_count) +
-          std::string(" seconds. Node ") +
-          activation +
-          std::string(" is still not ") +
-          state_map_[req_type]);
-      }
-    }
-  }
-  if (unchanged_count_ == 0) {
+  if (all_reached) {
     chainnodes_state_ = (req_type == IS_ACTIVE) ? ALL_ACTIVE : ALL_DEACTIVE;
     message_info(
       std::string("All node/nodes is/are ") +
-      state_map_[req_type]);
+      state_map_[req_type] +
+      std::string(" in ") +
+      std::to_string(cost_time) +
+      std::string(" seconds"));
   } else {
     chainnodes_state_ = (req_type == IS_ACTIVE) ? PART_ACTIVE : PART_DEACTIVE;
   }
+  {
+    std::lock_guard<std::mutex> lock(checking_mutex_);
+    checking_ = false;
+  }
+  checking_cv_.notify_all();
+}
+
+void CascadeManager::start_checking(const State_Req req_type)
+{
+  stop_checking();
+  {
+    std::lock_guard<std::mutex> lock(checking_mutex_);
+    checking_ = true;
+  }
+  sub_node_checking = std::make_unique<std::thread>(
+    &CascadeManager::node_status_checking, this, req_type);
+}
+
+void CascadeManager::stop_checking()
+{
+  node_tracker_.cancel();
+  if (sub_node_checking && sub_node_checking->joinable()) {
+    sub_node_checking->join();
+  }
+  sub_node_checking.reset();
+}
+
+bool CascadeManager::wait_chain(const std::chrono::nanoseconds timeout)
+{
+  if (manager_type == SINGLE_MANAGER) {
+    return true;
+  }
+  std::unique_lock<std::mutex> lock(checking_mutex_);
+  checking_cv_.wait_for(lock, timeout, [this]() {return !checking_;});
+  return !checking_ && chainnodes_state_ == ALL_ACTIVE;
+}
+
+rclcpp::CallbackGroup::SharedPtr CascadeManager::concern_group(const std::string & concern)
+{
+  auto & group = concern_groups_[concern];
+  if (group == nullptr) {
+    group = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive, false);
+  }
+  return group;
 }
 
 void CascadeManager::message_info(std::string_view log)
@@ -0,0 +1,137 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cerrno>
+
+#include "manager_utils/deadline_loop.hpp"
+
+namespace cyberdog
+{
+namespace manager
+{
+
+static constexpr int64_t NS_PER_S = 1000000000;
+
+DeadlineLoop::DeadlineLoop(std::chrono::nanoseconds period)
+: period_ns_(period.count() > 0 ? period.count() : 1),
+  next_ns_(0),
+  wake_ns_(0),
+  cycles_(0),
+  overruns_(0),
+  missed_(0),
+  jitter_sum_(0),
+  jitter_max_(0),
+  work_max_(0)
+{}
+
+bool DeadlineLoop::set_realtime(const int priority)
+{
+  if (priority <= 0) {
+    return true;
+  }
+  sched_param param;
+  param.sched_priority = priority;
+  return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+bool DeadlineLoop::set_affinity(const int cpu)
+{
+  if (cpu < 0) {
+    return true;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+
+void DeadlineLoop::start()
+{
+  wake_ns_ = now_ns();
+  next_ns_ = wake_ns_ + period_ns_;
+}
+
+bool DeadlineLoop::wait()
+{
+  bool rtn_(true);
+  auto current_ns = now_ns();
+  auto work_ns = current_ns - wake_ns_;
+  if (work_ns > work_max_.load(std::memory_order_relaxed)) {
+    work_max_.store(work_ns, std::memory_order_relaxed);
+  }
+
+  if (current_ns > next_ns_) {
+    // Run late at once, keep the phase and skip only periods which are entirely gone
+    int64_t missed = (current_ns - next_ns_) / period_ns_;
+    next_ns_ += missed * period_ns_;
+    overruns_.fetch_add(1, std::memory_order_relaxed);
+    missed_.fetch_add(missed, std::memory_order_relaxed);
+    rtn_ = false;
+  }
+
+  auto deadline = from_ns(next_ns_);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+
+  wake_ns_ = now_ns();
+  auto jitter_ns = wake_ns_ - next_ns_;
+  jitter_sum_.fetch_add(jitter_ns, std::memory_order_relaxed);
+  if (jitter_ns > jitter_max_.load(std::memory_order_relaxed)) {
+    jitter_max_.store(jitter_ns, std::memory_order_relaxed);
+  }
+  cycles_.fetch_add(1, std::memory_order_relaxed);
+  next_ns_ += period_ns_;
+  return rtn_;
+}
+
+DeadlineStats DeadlineLoop::stats(const bool reset_window)
+{
+  DeadlineStats stats;
+  stats.cycles = cycles_.load(std::memory_order_relaxed);
+  stats.overruns = overruns_.load(std::memory_order_relaxed);
+  stats.missed = missed_.load(std::memory_order_relaxed);
+  stats.jitter_max = reset_window ?
+    jitter_max_.exchange(0, std::memory_order_relaxed) :
+    jitter_max_.load(std::memory_order_relaxed);
+  stats.work_max = reset_window ?
+    work_max_.exchange(0, std::memory_order_relaxed) :
+    work_max_.load(std::memory_order_relaxed);
+  stats.jitter_mean = stats.cycles > 0 ?
+    jitter_sum_.load(std::memory_order_relaxed) / static_cast<int64_t>(stats.cycles) : 0;
+  return stats;
+}
+
+int64_t DeadlineLoop::to_ns(const timespec & ts)
+{
+  return static_cast<int64_t>(ts.tv_sec) * NS_PER_S + ts.tv_nsec;
+}
+
+timespec DeadlineLoop::from_ns(const int64_t ns)
+{
+  timespec ts;
+  ts.tv_sec = ns / NS_PER_S;
+  ts.tv_nsec = ns % NS_PER_S;
+  return ts;
+}
+
+int64_t DeadlineLoop::now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return to_ns(ts);
+}
+}  // namespace manager
+}  // namespace cyberdog
@@ -0,0 +1,172 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ament_index_cpp/get_package_share_directory.hpp"
+#include "manager_utils/deadline_loop.hpp"
+#include "manager_utils/executor_layout.hpp"
+#include "toml11/toml.hpp"
+
+namespace cyberdog
+{
+namespace manager
+{
+
+static const rclcpp::Logger & layout_logger()
+{
+  static const auto logger = rclcpp::get_logger("executor_layout");
+  return logger;
+}
+
+static std::shared_ptr<rclcpp::Executor> make_executor(const size_t threads)
+{
+  if (threads == 1) {
+    return std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+  }
+  return std::make_shared<rclcpp::executors::MultiThreadedExecutor>(
+    rclcpp::ExecutorOptions(), threads);
+}
+
+ExecutorLayout::ExecutorLayout()
+{
+  // Same as one MultiThreadedExecutor for everything
+  ExecutorConfig config;
+  config.name = "default";
+  config.threads = 0;
+  add_executor(config);
+}
+
+ExecutorLayout::~ExecutorLayout()
+{
+  cancel();
+  join();
+}
+
+bool ExecutorLayout::load(const std::string & toml_file)
+{
+  auto file = toml_file;
+  #ifdef PACKAGE_NAME
+  if (file.empty()) {
+    file = ament_index_cpp::get_package_share_directory(PACKAGE_NAME) +
+      std::string("/params/params.toml");
+  }
+  #endif
+
+  try {
+    const auto data = toml::parse(file);
+    if (data.as_table().count("Executors") == 0) {
+      RCLCPP_INFO(layout_logger(), "No executor layout in %s, use default", file.c_str());
+      return true;
+    }
+    for (const auto & executor : toml::find<toml::table>(data, "Executors")) {
+      ExecutorConfig config;
+      config.name = executor.first;
+      config.threads = std::max(0, toml::find_or<int>(executor.second, "threads", 1));
+      config.priority = toml::find_or<int>(executor.second, "priority", 0);
+      config.cpu = toml::find_or<int>(executor.second, "cpu", -1);
+      config.groups = toml::find_or<std::vector<std::string>>(
+        executor.second, "groups", std::vector<std::string>());
+      add_executor(config);
+    }
+  } catch (const std::exception & ex) {
+    RCLCPP_ERROR(
+      layout_logger(), "Executor layout of %s is invalid: %s", file.c_str(), ex.what());
+    return false;
+  }
+  return true;
+}
+
+void ExecutorLayout::add_executor(const ExecutorConfig & config)
+{
+  size_t index(entries_.size());
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (entries_[i]->config.name == config.name) {
+      index = i;
+    }
+  }
+  if (index == entries_.size()) {
+    entries_.push_back(std::make_unique<Entry>());
+  }
+  entries_[index]->config = config;
+  entries_[index]->executor = make_executor(config.threads);
+  for (const auto & group : config.groups) {
+    group_map_[group] = index;
+  }
+  RCLCPP_INFO(
+    layout_logger(), "Executor [%s]: %zu threads, priority %d, cpu %d, %zu groups",
+    config.name.c_str(), config.threads, config.priority, config.cpu, config.groups.size());
+}
+
+void ExecutorLayout::add_node(
+  const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node,
+  const Groups_T & groups)
+{
+  entries_.front()->executor->add_node(node);
+  for (const auto & group : groups) {
+    auto mapped = group_map_.find(group.first);
+    auto index = mapped == group_map_.end() ? 0 : mapped->second;
+    entries_[index]->executor->add_callback_group(group.second, node);
+  }
+}
+
+void ExecutorLayout::spin()
+{
+  for (auto & entry : entries_) {
+    if (!entry->thread.joinable()) {
+      entry->thread = std::thread(&ExecutorLayout::spin_entry, this, std::ref(*entry));
+    }
+  }
+}
+
+void ExecutorLayout::spin_entry(Entry & entry)
+{
+  // Threads of MultiThreadedExecutor inherit name, policy and affinity
+  auto thread_name = std::string("exec_") + entry.config.name;
+  pthread_setname_np(pthread_self(), thread_name.substr(0, 15).c_str());
+  if (!DeadlineLoop::set_realtime(entry.config.priority)) {
+    RCLCPP_WARN(
+      layout_logger(), "Executor [%s] can not set priority %d",
+      entry.config.name.c_str(), entry.config.priority);
+  }
+  if (!DeadlineLoop::set_affinity(entry.config.cpu)) {
+    RCLCPP_WARN(
+      layout_logger(), "Executor [%s] can not pin to cpu %d",
+      entry.config.name.c_str(), entry.config.cpu);
+  }
+  entry.executor->spin();
+}
+
+void ExecutorLayout::join()
+{
+  for (auto & entry : entries_) {
+    if (entry->thread.joinable()) {
+      entry->thread.join();
+    }
+  }
+}
+
+void ExecutorLayout::cancel()
+{
+  for (auto & entry : entries_) {
+    entry->executor->cancel();
+  }
+}
+}  // namespace manager
+}  // namespace cyberdog
@@ -0,0 +1,278 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "manager_utils/startup_orchestrator.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace cyberdog
+{
+namespace manager
+{
+
+static const rclcpp::Logger & startup_logger()
+{
+  static const auto logger = rclcpp::get_logger("startup_orchestrator");
+  return logger;
+}
+
+StartupOrchestrator::StartupOrchestrator(
+  const size_t max_parallel,
+  const std::chrono::milliseconds retry_period,
+  const uint32_t max_attempts)
+: max_parallel_(std::max<size_t>(max_parallel, 1)),
+  retry_period_(retry_period),
+  max_attempts_(max_attempts)
+{}
+
+bool StartupOrchestrator::add_unit(
+  const std::string & name,
+  const std::vector<std::string> & dependencies)
+{
+  for (const auto & unit : units_) {
+    if (unit.name == name) {
+      return false;
+    }
+  }
+  Unit unit;
+  unit.name = name;
+  unit.dependencies = dependencies;
+  units_.push_back(std::move(unit));
+  return true;
+}
+
+bool StartupOrchestrator::add_step(
+  const std::string & unit, const std::string & step, Step_T function,
+  const bool required)
+{
+  for (auto & declared : units_) {
+    if (declared.name == unit) {
+      declared.steps.push_back(Step{step, std::move(function), required});
+      return true;
+    }
+  }
+  return false;
+}
+
+bool StartupOrchestrator::resolve()
+{
+  std::unordered_map<std::string, size_t> index;
+  for (size_t i = 0; i < units_.size(); i++) {
+    index[units_[i].name] = i;
+    units_[i].dependents.clear();
+    units_[i].pending = units_[i].dependencies.size();
+    units_[i].status = UNIT_WAITING;
+  }
+  for (size_t i = 0; i < units_.size(); i++) {
+    for (const auto & dependency : units_[i].dependencies) {
+      auto found = index.find(dependency);
+      if (found == index.end()) {
+        RCLCPP_ERROR(
+          startup_logger(), "Unit [%s] depends on unknown unit [%s]",
+          units_[i].name.c_str(), dependency.c_str());
+        return false;
+      }
+      units_[found->second].dependents.push_back(i);
+    }
+  }
+
+  // Kahn's walk, anything left over is on a cycle
+  std::vector<size_t> pending(units_.size());
+  std::vector<size_t> queue;
+  for (size_t i = 0; i < units_.size(); i++) {
+    pending[i] = units_[i].pending;
+    if (pending[i] == 0) {
+      queue.push_back(i);
+    }
+  }
+  size_t visited(0);
+  while (!queue.empty()) {
+    auto current = queue.back();
+    queue.pop_back();
+    visited++;
+    for (auto dependent : units_[current].dependents) {
+      if (--pending[dependent] == 0) {
+        queue.push_back(dependent);
+      }
+    }
+  }
+  if (visited != units_.size()) {
+    RCLCPP_ERROR(startup_logger(), "Startup units have dependency cycle");
+    return false;
+  }
+  return true;
+}
+
+bool StartupOrchestrator::run()
+{
+  if (!resolve()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.clear();
+    ready_.clear();
+    finished_ = 0;
+    for (size_t i = 0; i < units_.size(); i++) {
+      if (units_[i].pending == 0) {
+        ready_.push_back(i);
+      }
+    }
+  }
+  start_time_ = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  auto worker_count = std::min(max_parallel_, std::max<size_t>(units_.size(), 1));
+  for (size_t i = 0; i < worker_count; i++) {
+    workers.emplace_back(&StartupOrchestrator::worker, this);
+  }
+  for (auto & worker : workers) {
+    worker.join();
+  }
+
+  bool rtn_(true);
+  for (const auto & unit : units_) {
+    rtn_ &= unit.status == UNIT_SUCCEED;
+  }
+  RCLCPP_INFO(
+    startup_logger(), "Startup %s in %.3f s\n%s",
+    rtn_ ? "succeed" : "failed", since_start(), timeline_str().c_str());
+  return rtn_;
+}
+
+void StartupOrchestrator::worker()
+{
+  while (true) {
+    size_t index(0);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(
+        lock, [this]() {
+          return !ready_.empty() || finished_ == units_.size();
+        });
+      if (ready_.empty()) {
+        return;
+      }
+      index = ready_.front();
+      ready_.erase(ready_.begin());
+      units_[index].status = UNIT_RUNNING;
+    }
+
+    auto succeed = run_unit(index);
+
+    std::vector<size_t> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finish_unit(index, succeed, ready);
+      ready_.insert(ready_.end(), ready.begin(), ready.end());
+    }
+    cv_.notify_all();
+  }
+}
+
+bool StartupOrchestrator::run_unit(const size_t index)
+{
+  auto & unit = units_[index];
+  for (auto & step : unit.steps) {
+    StartupRecord record{unit.name, step.name, since_start(), 0.0, 0, false};
+    const uint32_t max_attempts = step.required ? max_attempts_ : 1;
+    while (!record.succeed && rclcpp::ok() &&
+      (max_attempts == 0 || record.attempts < max_attempts))
+    {
+      if (record.attempts > 0) {
+        std::this_thread::sleep_for(retry_period_);
+      }
+      record.attempts++;
+      record.succeed = step.function();
+    }
+    record.end_s = since_start();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      records_.push_back(record);
+    }
+    if (!record.succeed && !step.required) {
+      RCLCPP_WARN(
+        startup_logger(), "Unit [%s] optional step [%s] failed, continue",
+        unit.name.c_str(), step.name.c_str());
+    } else if (!record.succeed) {
+      RCLCPP_ERROR(
+        startup_logger(), "Unit [%s] step [%s] failed after %u attempts",
+        unit.name.c_str(), step.name.c_str(), record.attempts);
+      return false;
+    }
+  }
+  return true;
+}
+
+void StartupOrchestrator::finish_unit(
+  const size_t index, const bool succeed,
+  std::vector<size_t> & ready)
+{
+  auto & unit = units_[index];
+  unit.status = succeed ? UNIT_SUCCEED : UNIT_FAILED;
+  finished_++;
+  for (auto dependent : unit.dependents) {
+    auto & next = units_[dependent];
+    if (next.status != UNIT_WAITING) {
+      continue;
+    }
+    if (!succeed) {
+      RCLCPP_WARN(
+        startup_logger(), "Unit [%s] skipped, dependency [%s] failed",
+        next.name.c_str(), unit.name.c_str());
+      finish_unit(dependent, false, ready);
+      next.status = UNIT_SKIPPED;
+    } else if (--next.pending == 0) {
+      ready.push_back(dependent);
+    }
+  }
+}
+
+std::vector<StartupRecord> StartupOrchestrator::timeline() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return records_;
+}
+
+std::string StartupOrchestrator::timeline_str() const
+{
+  auto records = timeline();
+  std::sort(
+    records.begin(), records.end(),
+    [](const StartupRecord & a, const StartupRecord & b) {return a.start_s < b.start_s;});
+  std::string timeline;
+  char line[160];
+  for (const auto & record : records) {
+    std::snprintf(
+      line, sizeof(line), "  %-24s %-10s %8.3f -> %8.3f s (%6.3f s, %u attempts)%s\n",
+      record.unit.c_str(), record.step.c_str(), record.start_s, record.end_s,
+      record.end_s - record.start_s, record.attempts, record.succeed ? "" : " FAILED");
+    timeline += line;
+  }
+  return timeline;
+}
+
+double StartupOrchestrator::since_start() const
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+}
+}  // namespace manager
+}  // namespace cyberdog
@@ -32,6 +32,10 @@ CeptionManager::CeptionManager()
   this->declare_parameter("rate_tik_hz", 2);
   this->declare_parameter("soc_limit_perc", 10);
 
+  // Spun by executors of params.toml [Executors], before configuring
+  concern_group("perception");
+  concern_group("interaction");
+
   // Get package share dir
   #ifdef PACKAGE_NAME
   auto local_share_dir = ament_index_cpp::get_package_share_directory(PACKAGE_NAME);
@@ -72,14 +76,22 @@ CallbackReturn_T CeptionManager::on_configure(const rclcpp_lifecycle::State &)
     message_info(std::string("Manager internal configured."));
   }
 
+  rclcpp::SubscriptionOptions perception_options;
+  perception_options.callback_group = concern_group("perception");
   bms_sub_ = this->create_subscription<BMS_T>(
     "bms_recv", rclcpp::SystemDefaultsQoS(),
-    std::bind(&CeptionManager::bms_callback, this, std::placeholders::_1));
+    std::bind(&CeptionManager::bms_callback, this, std::placeholders::_1),
+    perception_options);
 
+  // Motion manager in the same process takes guard from state bus or intra-process
+  rclcpp::PublisherOptions guard_options;
+  guard_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Enable;
   guard_pub_ = this->create_publisher<Safety_T>(
-    "safe_guard", rclcpp::SystemDefaultsQoS());
+    "safe_guard", intra_process_qos(), guard_options);
+  guard_state_ = StateBus::instance().channel<Safety_T>("safe_guard");
 
-  audio_play_client_ = rclcpp_action::create_client<AudioPlay_T>(this, "audio_play");
+  audio_play_client_ = rclcpp_action::create_client<AudioPlay_T>(
+    this, "audio_play", concern_group("interaction"));
 
   message_info(get_name() + std::string(" configured."));
   return CallbackReturn_T::SUCCESS;
@@ -181,7 +193,25 @@ void CeptionManager::bms_callback(const BMS_T::SharedPtr msg)
   }
 
   // TBD: bit check before assignment
+  auto changed = guard_info_ != *guard_temp;
   guard_info_ = *guard_temp;
+  // Bus holds the change for consumers in process until their next poll, the daemon
+  // keeps the tik for the topic
+  if (changed && guard_state_ != nullptr && guard_pub_->is_activated()) {
+    guard_state_->publish(guard_info_);
+  }
+}
+
+void CeptionManager::publish_guard(const Safety_T & msg)
+{
+  // Bus follows the lifecycle of the topic publisher, nothing is published while inactive
+  if (!guard_pub_->is_activated()) {
+    return;
+  }
+  if (guard_state_ != nullptr) {
+    guard_state_->publish(msg);
+  }
+  guard_pub_->publish(std::make_unique<Safety_T>(msg));
 }
 
 void CeptionManager::safe_guard_daemon()
@@ -189,7 +219,7 @@ void CeptionManager::safe_guard_daemon()
   rclcpp::WallRate rate_hold_(rate_tik_);
 
   while (rclcpp::ok() && thread_flag_) {
-    guard_pub_->publish(guard_info_);
+    publish_guard(guard_info_);
 
     rate_hold_.sleep();
   }
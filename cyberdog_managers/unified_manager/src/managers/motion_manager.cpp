@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <pthread.h>
+
 #include <algorithm>
 #include <condition_variable>
 #include <cmath>
@@ -55,11 +57,14 @@ MotionManager::MotionManager()
   this->declare_parameter("rate_wait_loop_hz", 2);
   this->declare_parameter("rate_odom_hz", 50);
   this->declare_parameter("rate_lcm_const_hz", 500);
+  this->declare_parameter("rt_priority_control", 0);
+  this->declare_parameter("rt_cpu_control", -1);
   this->declare_parameter("timeout_manager_s", 10);
   this->declare_parameter("timeout_motion_ms", 300);
   this->declare_parameter("timeout_gait_s", 12);
   this->declare_parameter("timeout_order_ms", 500);
   this->declare_parameter("timeout_lcm_ms", 200);
+  this->declare_parameter("use_state_bus", true);
   this->declare_parameter("cons_abs_lin_x_mps", 1.6);
   this->declare_parameter("cons_abs_lin_y_mps", 0.8);
   this->declare_parameter("cons_abs_ang_r_rps", 0.5);
@@ -79,6 +84,10 @@ MotionManager::MotionManager()
   this->declare_parameter("port_recv_from_motion", 7670);
   this->declare_parameter("port_send_to_motion", 7671);
   this->declare_parameter("port_from_odom", 7669);
+
+  // Spun by executors of params.toml [Executors], before configuring
+  concern_group("control");
+  concern_group("perception");
   message_info(this->get_name() + std::string(" created"));
 }
 
@@ -107,11 +116,14 @@ CallbackReturn_T MotionManager::on_configure(const rclcpp_lifecycle::State &)
   rate_wait_loop_ = get_parameter("rate_wait_loop_hz").as_int();
   rate_odom_ = get_parameter("rate_odom_hz").as_int();
   rate_lcm_const_ = get_parameter("rate_lcm_const_hz").as_int();
+  rt_priority_control_ = get_parameter("rt_priority_control").as_int();
+  rt_cpu_control_ = get_parameter("rt_cpu_control").as_int();
   timeout_manager_ = get_parameter("timeout_manager_s").as_int();
   timeout_motion_ = get_parameter("timeout_motion_ms").as_int();
   timeout_gait_ = get_parameter("timeout_gait_s").as_int();
   timeout_order_ = get_parameter("timeout_order_ms").as_int();
   timeout_lcm_ = get_parameter("timeout_lcm_ms").as_int();
+  use_state_bus_ = get_parameter("use_state_bus").as_bool();
   cons_abs_lin_x_ = get_parameter("cons_abs_lin_x_mps").as_double();
   cons_abs_lin_y_ = get_parameter("cons_abs_lin_y_mps").as_double();
   cons_abs_ang_r_ = get_parameter("cons_abs_ang_r_rps").as_double();
@@ -164,8 +176,11 @@ CallbackReturn_T MotionManager::on_configure(const rclcpp_lifecycle::State &)
   gait_pub_ = this->create_publisher<Gait_T>(
     "gait_out", rclcpp::SystemDefaultsQoS());
 
+  // State loops back to this node, intra-process keeps it off the middleware
+  rclcpp::PublisherOptions state_options;
+  state_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Enable;
   control_state_pub_ = this->create_publisher<ControlState_T>(
-    "status_out", rclcpp::SystemDefaultsQoS());
+    "status_out", intra_process_qos(), state_options);
 
   odom_pub_ = this->create_publisher<nav_msgs::msg::Odometry>(
     "odom_out", rclcpp::SystemDefaultsQoS());
@@ -179,40 +194,67 @@ CallbackReturn_T MotionManager::on_configure(const rclcpp_lifecycle::State &)
   ob_detect_client_ =
     this->create_client<ception_msgs::srv::SensorDetectionNode>("obstacle_detection");
 
+  // Commands and states of robot are isolated from action and service traffic
+  rclcpp::SubscriptionOptions control_options;
+  control_options.callback_group = concern_group("control");
+  rclcpp::SubscriptionOptions perception_options;
+  perception_options.callback_group = concern_group("perception");
+
   velocity_sub_ = this->create_subscription<SE3VelocityCMD_T>(
     topic_name_map_["rc_topic"], rclcpp::SystemDefaultsQoS(),
     std::bind(
       &MotionManager::velocity_cmd_callback, this,
-      std::placeholders::_1));
+      std::placeholders::_1), control_options);
 
   ob_detect_sub_ = this->create_subscription<Around_T>(
     "ObstacleDetection", rclcpp::SystemDefaultsQoS(),
     std::bind(
       &MotionManager::ob_detection_callback, this,
-      std::placeholders::_1));
+      std::placeholders::_1), perception_options);
 
   paras_sub_ = this->create_subscription<Parameters_T>(
     "para_change", rclcpp::SensorDataQoS(),
-    std::bind(&MotionManager::paras_callback, this, std::placeholders::_1));
+    std::bind(&MotionManager::paras_callback, this, std::placeholders::_1), control_options);
 
   cau_sub_ = this->create_subscription<NavCaution_T>(
     "nav_status", rclcpp::SystemDefaultsQoS(),
     std::bind(
       &MotionManager::caution_callback, this,
-      std::placeholders::_1));
+      std::placeholders::_1), perception_options);
 
+  control_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Enable;
   control_state_sub_ = this->create_subscription<ControlState_T>(
-    "status_out", rclcpp::SystemDefaultsQoS(),
+    "status_out", intra_process_qos(),
     std::bind(
       &MotionManager::control_state_callback, this,
-      std::placeholders::_1));
+      std::placeholders::_1), control_options);
+
+  // Ception manager in this process publishes guard to state bus too, polled in control
+  // group at the common rate. Topic still carries guard of a ception manager in another
+  // process, local publications are left to the bus as the process shares one participant.
+  guard_state_ = use_state_bus_ ?
+    StateBus::instance().channel<Safety_T>("safe_guard") : nullptr;
+  if (guard_state_ != nullptr) {
+    guard_cursor_ = 0;
+    guard_timer_ = this->create_wall_timer(
+      std::chrono::nanoseconds(1000000000 / rate_common_),
+      std::bind(&MotionManager::take_guard, this), concern_group("control"));
+    rclcpp::SubscriptionOptions remote_options = control_options;
+    remote_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
+    remote_options.ignore_local_publications = true;
+    guard_sub_ = this->create_subscription<Safety_T>(
+      "safe_guard", intra_process_qos(),
+      std::bind(&MotionManager::guard_callback, this, std::placeholders::_1), remote_options);
+  } else {
+    guard_sub_ = this->create_subscription<Safety_T>(
+      "safe_guard", intra_process_qos(),
+      std::bind(&MotionManager::guard_callback, this, std::placeholders::_1), control_options);
+  }
 
-  guard_sub_ = this->create_subscription<Safety_T>(
-    "safe_guard", rclcpp::SystemDefaultsQoS(),
-    std::bind(&MotionManager::guard_callback, this, std::placeholders::_1));
+  tf_pub_ = this->create_publisher<TFMessage_T>(
+    "/tf", rclcpp::SystemDefaultsQoS());
 
-  tf_broadcaster = std::make_unique<tf2_ros::TransformBroadcaster>(
-    this, rclcpp::SystemDefaultsQoS());
+  odom_graph_event_ = this->get_node_graph_interface()->get_graph_event();
 
   motion_in_ =
     std::make_unique<lcm::LCM>(
@@ -248,6 +290,7 @@ CallbackReturn_T MotionManager::on_activate(const rclcpp_lifecycle::State &)
   control_state_pub_->on_activate();
   gait_pub_->on_activate();
   odom_pub_->on_activate();
+  tf_pub_->on_activate();
 
   init();
 
@@ -274,12 +317,14 @@ CallbackReturn_T MotionManager::on_deactivate(const rclcpp_lifecycle::State &)
   control_state_pub_->on_deactivate();
   gait_pub_->on_deactivate();
   odom_pub_->on_deactivate();
+  tf_pub_->on_deactivate();
   cmd_pub_->on_deactivate();
 
   automation_node_thread_->join();
   lcm_control_res_handle_thread_->join();
   lcm_statees_res_handle_thread_->join();
   control_cmd_thread_->join();
+  control_log_thread_->join();
 
   message_info(get_name() + std::string(" deactivated"));
   return CallbackReturn_T::SUCCESS;
@@ -292,10 +337,14 @@ CallbackReturn_T MotionManager::on_cleanup(const rclcpp_lifecycle::State &)
   velocity_sub_.reset();
   ob_detect_sub_.reset();
   guard_sub_.reset();
+  guard_timer_.reset();
+  guard_state_.reset();
   gait_pub_.reset();
   control_state_pub_.reset();
   odom_pub_.reset();
   cmd_pub_.reset();
+  tf_pub_.reset();
+  odom_graph_event_.reset();
 
   casual_service_client_.reset();
   ob_detect_client_.reset();
@@ -318,6 +367,8 @@ CallbackReturn_T MotionManager::on_cleanup(const rclcpp_lifecycle::State &)
   lcm_control_res_handle_thread_.reset();
   lcm_statees_res_handle_thread_.reset();
   control_cmd_thread_.reset();
+  control_log_thread_.reset();
+  control_loop_.reset();
 
   message_info(get_name() + std::string(" completely cleaned up"));
   return CallbackReturn_T::SUCCESS;
@@ -343,9 +394,12 @@ CallbackReturn_T MotionManager::on_error(const rclcpp_lifecycle::State &)
   lcm_control_res_handle_thread_->join();
   lcm_statees_res_handle_thread_->join();
   control_cmd_thread_->join();
+  control_log_thread_->join();
 
   velocity_sub_.reset();
   ob_detect_sub_.reset();
+  guard_timer_.reset();
+  guard_state_.reset();
   gait_pub_.reset();
   control_state_pub_.reset();
 
@@ -354,6 +408,8 @@ CallbackReturn_T MotionManager::on_error(const rclcpp_lifecycle::State &)
 
   odom_pub_.reset();
   cmd_pub_.reset();
+  tf_pub_.reset();
+  odom_graph_event_.reset();
 
   // Reset service servers
   mode_server_.reset();
@@ -371,6 +427,8 @@ CallbackReturn_T MotionManager::on_error(const rclcpp_lifecycle::State &)
   lcm_control_res_handle_thread_.reset();
   lcm_statees_res_handle_thread_.reset();
   control_cmd_thread_.reset();
+  control_log_thread_.reset();
+  control_loop_.reset();
 
   message_info(get_name() + std::string(" error processed"));
   return CallbackReturn_T::SUCCESS;
@@ -751,7 +809,7 @@ void MotionManager::checkout_mode()
           }
       }
     }
-    looprate.sleep();
+    mode_server_->wait_for_event(looprate.period());
   }
   if (result->err_code == ModeRes_T::NORMAL) {
     message_info(
@@ -817,14 +875,14 @@ void MotionManager::checkout_gait()
     gait_str +
     std::string("] ");
 
-  auto goal_gait_t = 9;
-  auto current_gait_t = 3;
-  std::vector<cyberdog::bridge::GaitMono> gait_to_run_t;
-
-  gait_interface_.get_bridges_list(goal_gait_t, current_gait_t, gait_to_run_t);
-  while (gait_to_run_t.size() > 0) {
-    message_info(std::string("gait to run is ") + gait_to_run_t.back().get_gait_name());
-    gait_to_run_t.pop_back();
+  uint8_t bridges_length(0);
+  auto bridges_path = gait_interface_.get_bridges_path(
+    goal_gait.gait, robot_control_state_.gaitstamped.gait, bridges_length);
+  for (auto i = bridges_length; bridges_path != nullptr && i > 0; i--) {
+    message_info(
+      TAG_GAIT +
+      std::string("Gait to run is ") +
+      gait_interface_.get_gait_name(bridges_path[i - 1]));
   }
 
   message_info(
@@ -973,7 +1031,7 @@ void MotionManager::checkout_gait()
       current_gait = (goal_gait.gait >= Gait_T::GAIT_STAND_B) ?
         gait_cached_.gait : robot_control_state_.gaitstamped.gait;
       gait_to_pub.gait = Gait_T::GAIT_DEFAULT;
-      auto current_sending_ = ros_to_lcm_data_.pattern;
+      int8_t current_sending_ = cmd_pattern_;
 
       if (current_gait != Gait_T::GAIT_TRANS || gait_cached_.gait != current_sending_) {
         if (gait_cached_.gait != current_sending_ && current_sending_ != Gait_T::GAIT_TRANS) {
@@ -1193,7 +1251,7 @@ void MotionManager::checkout_gait()
         }
         feedback->current_checking = gait_to_pub;
         gait_server_->publish_feedback(feedback);
-        looprate.sleep();
+        gait_server_->wait_for_event(looprate.period());
       }  // end of int while
     }  // end of ext while
   }  // end of new_request
@@ -1476,18 +1534,18 @@ void MotionManager::mon_order_exec()
             new_request = false;
             break;
           } else {  // remain_time < running_time
-            auto velocity_order = std::make_unique<SE3VelocityCMD_T>();
-            velocity_order->sourceid = SE3VelocityCMD_T::INTERNAL;
-            velocity_order->velocity.frameid.id = FrameID_T::BODY_FRAME;
-            velocity_order->velocity.timestamp = this->get_clock()->now();
-            velocity_order->velocity.linear_x =
+            SE3VelocityCMD_T velocity_order;
+            velocity_order.sourceid = SE3VelocityCMD_T::INTERNAL;
+            velocity_order.velocity.frameid.id = FrameID_T::BODY_FRAME;
+            velocity_order.velocity.timestamp = this->get_clock()->now();
+            velocity_order.velocity.linear_x =
               (goal_order.id == MonOrder_T::MONO_ORDER_STEP_BACK) ?
               -cons_speed_l_normal_ : 0;
-            velocity_order->velocity.angular_z =
+            velocity_order.velocity.angular_z =
               (goal_order.id == MonOrder_T::MONO_ORDER_TURN_AROUND) ?
               cons_speed_a_normal_ : 0;
 
-            publish_velocity(std::move(velocity_order));
+            publish_velocity(velocity_order);
             feedback->current_pose = robot_control_state_.posestamped;
             feedback->order_executing = goal_order;
             auto cost_time_mili = cost_time.to_chrono<std::chrono::milliseconds>().count();
@@ -1522,7 +1580,7 @@ void MotionManager::mon_order_exec()
         }
       }
       if (order_steps.size() == 0) {
-        rate_order.sleep();
+        monorder_server_->wait_for_event(rate_order.period());
       }
     }
   }
@@ -1579,7 +1637,7 @@ void MotionManager::velocity_cmd_callback(
     case Mode_T::MODE_MANUAL:
       {
         if (condition_remotec || condition_internal) {
-          publish_velocity(msg);
+          publish_velocity(*msg);
           ext_velocity_cmd_ = *msg;
         }
         break;
@@ -1587,7 +1645,7 @@ void MotionManager::velocity_cmd_callback(
     case Mode_T::MODE_EXPLOR:
       {
         if (condition_remotec | condition_navigator | condition_internal) {
-          publish_velocity(msg);
+          publish_velocity(*msg);
           ext_velocity_cmd_ = *msg;
         }
         break;
@@ -1595,7 +1653,7 @@ void MotionManager::velocity_cmd_callback(
     case Mode_T::MODE_TRACK:
       {
         if (condition_navigator | condition_internal) {
-          publish_velocity(msg);
+          publish_velocity(*msg);
           ext_velocity_cmd_ = *msg;
         }
         break;
@@ -1668,11 +1726,25 @@ void MotionManager::control_state_callback(const ControlState_T::SharedPtr msg)
 }
 
 void MotionManager::guard_callback(const Safety_T::SharedPtr msg)
+{
+  update_guard(*msg);
+}
+
+void MotionManager::take_guard()
+{
+  Safety_T guard;
+  if (guard_state_->take(guard, guard_cursor_)) {
+    update_guard(guard);
+  }
+}
+
+void MotionManager::update_guard(const Safety_T & guard)
 {
   auto TAG_GUARD = std::string("[Guard_Detection] ");
+  std::lock_guard<std::mutex> lock(guard_mutex_);
 
-  if (robot_control_state_.safety != *msg) {
-    if (msg->status == Safety_T::LOW_BTR) {
+  if (robot_control_state_.safety != guard) {
+    if (guard.status == Safety_T::LOW_BTR) {
       cons_abs_lin_x_ *= scale_low_btr_;
       cons_abs_lin_y_ *= scale_low_btr_;
       cons_abs_ang_p_ *= scale_low_btr_;
@@ -1682,7 +1754,7 @@ void MotionManager::guard_callback(const Safety_T::SharedPtr msg)
         TAG_GUARD +
         std::string("Battery low, reset max velocity"));
     }
-    if (msg->status == Safety_T::NORMAL) {
+    if (guard.status == Safety_T::NORMAL) {
       cons_abs_lin_x_ /= scale_low_btr_;
       cons_abs_lin_y_ /= scale_low_btr_;
       cons_abs_ang_p_ /= scale_low_btr_;
@@ -1694,7 +1766,7 @@ void MotionManager::guard_callback(const Safety_T::SharedPtr msg)
     }
   }
 
-  robot_control_state_.safety = *msg;
+  robot_control_state_.safety = guard;
 
   auto condition_timeout = this->get_clock()->now() - last_motion_time_ >=
     std::chrono::milliseconds(timeout_motion_);
@@ -1770,37 +1842,14 @@ void MotionManager::statees_lcm_collection(
   if (odom_count_ >= std::ceil(rate_lcm_const_ / rate_odom_) - 1 &&
     rclcpp::ok() && thread_flag_)
   {
-    robot_body_tf_.header.stamp = odom_stamp;
-    robot_body_tf_.transform.rotation.w = lcm_data->quat[0];
-    robot_body_tf_.transform.rotation.x = lcm_data->quat[1];
-    robot_body_tf_.transform.rotation.y = lcm_data->quat[2];
-    robot_body_tf_.transform.rotation.z = lcm_data->quat[3];
-    robot_body_tf_.transform.translation.x = lcm_data->p[0];
-    robot_body_tf_.transform.translation.y = lcm_data->p[1];
-    robot_body_tf_.transform.translation.z = lcm_data->p[2];
-
-    odom_.header.stamp = odom_stamp;
-    odom_.twist.twist.linear.x = lcm_data->vBody[0];
-    odom_.twist.twist.linear.y = lcm_data->vBody[1];
-    odom_.twist.twist.linear.z = lcm_data->vBody[2];
-    odom_.twist.twist.angular.x = lcm_data->omegaBody[0];
-    odom_.twist.twist.angular.y = lcm_data->omegaBody[1];
-    odom_.twist.twist.angular.z = lcm_data->omegaBody[2];
-    odom_.pose.pose.position.x = lcm_data->p[0];
-    odom_.pose.pose.position.y = lcm_data->p[1];
-    odom_.pose.pose.position.z = lcm_data->p[2];
-    odom_.pose.pose.orientation.w = lcm_data->quat[0];
-    odom_.pose.pose.orientation.x = lcm_data->quat[1];
-    odom_.pose.pose.orientation.y = lcm_data->quat[2];
-    odom_.pose.pose.orientation.z = lcm_data->quat[3];
-    tf_broadcaster->sendTransform(robot_body_tf_);
-    publish_odom(odom_);
+    publish_odom_sample(lcm_data, odom_stamp);
     odom_count_ = 0;
   }
 }
 
 void MotionManager::recv_lcm_control_handle()
 {
+  pthread_setname_np(pthread_self(), "motion_lcm_res");
   rclcpp::WallRate r_wait(rate_wait_loop_);
 
   while (rclcpp::ok() && thread_flag_) {
@@ -1825,6 +1874,7 @@ void MotionManager::recv_lcm_control_handle()
 
 void MotionManager::recv_lcm_statees_handle()
 {
+  pthread_setname_np(pthread_self(), "motion_lcm_odom");
   rclcpp::WallRate r_wait(rate_wait_loop_);
 
   while (rclcpp::ok() && thread_flag_) {
@@ -1849,22 +1899,22 @@ void MotionManager::recv_lcm_statees_handle()
 }
 
 void MotionManager::publish_velocity(
-  const SE3VelocityCMD_T::SharedPtr velocity_out,
+  const SE3VelocityCMD_T & velocity_out,
   const int8_t ORDER_TYPE)
 {
   auto TAG_VCMD = std::string("[VCMD_Publish]");
-  if (source_id_map_.find(velocity_out->sourceid) == source_id_map_.end()) {
+  if (source_id_map_.find(velocity_out.sourceid) == source_id_map_.end()) {
     message_warn(
       TAG_VCMD +
       std::string("Source id [") +
-      std::to_string(velocity_out->sourceid) +
+      std::to_string(velocity_out.sourceid) +
       std::string("] unknown. Ignore it"));
     return;
   }
 
   #ifndef DEBUG_ALL
-  if (check_time_update(velocity_out->velocity.timestamp, last_motion_time_)) {
-    last_motion_time_ = velocity_out->velocity.timestamp;
+  if (check_time_update(velocity_out.velocity.timestamp, last_motion_time_)) {
+    last_motion_time_ = velocity_out.velocity.timestamp;
   } else {
     message_warn(
       TAG_VCMD +
@@ -1882,7 +1932,7 @@ void MotionManager::publish_velocity(
       mode_label_[robot_control_state_.modestamped.control_mode]);
     return;
   }
-  if (velocity_out->velocity.frameid.id != FrameID_T::BODY_FRAME) {
+  if (velocity_out.velocity.frameid.id != FrameID_T::BODY_FRAME) {
     message_warn(
       TAG_VCMD +
       std::string("Frame ID is not [BODY_FRAME], Ignore it"));
@@ -1892,46 +1942,49 @@ void MotionManager::publish_velocity(
   if (cmd_pub_->is_activated() &&
     this->count_subscribers(cmd_pub_->get_topic_name()) > 0)
   {
-    cmd_pub_->publish(*velocity_out);
+    cmd_pub_->publish(velocity_out);
   }
 
-  ros_to_lcm_data_.linear[0] =
+  std::unique_lock<std::mutex> guard_lock(guard_mutex_);
+  VelocitySetpoint setpoint;
+  setpoint.linear[0] =
     limit_data(
-    velocity_out->velocity.linear_x, 0 - cons_abs_lin_x_,
+    velocity_out.velocity.linear_x, 0 - cons_abs_lin_x_,
     cons_abs_lin_x_);
-  ros_to_lcm_data_.linear[1] =
+  setpoint.linear[1] =
     limit_data(
-    velocity_out->velocity.linear_y, 0 - cons_abs_lin_y_,
+    velocity_out.velocity.linear_y, 0 - cons_abs_lin_y_,
     cons_abs_lin_y_);
-  ros_to_lcm_data_.linear[2] =
+  setpoint.linear[2] =
     limit_data(
-    velocity_out->velocity.linear_z, 0 - cons_abs_lin_x_,
+    velocity_out.velocity.linear_z, 0 - cons_abs_lin_x_,
     cons_abs_lin_x_);
 
-  ros_to_lcm_data_.angular[0] =
+  setpoint.angular[0] =
     limit_data(
-    velocity_out->velocity.angular_x, 0 - cons_abs_ang_r_,
+    velocity_out.velocity.angular_x, 0 - cons_abs_ang_r_,
     cons_abs_ang_r_);
-  ros_to_lcm_data_.angular[1] =
+  setpoint.angular[1] =
     limit_data(
-    velocity_out->velocity.angular_y, 0 - cons_abs_ang_p_,
+    velocity_out.velocity.angular_y, 0 - cons_abs_ang_p_,
     cons_abs_ang_p_);
-  ros_to_lcm_data_.angular[2] =
+  setpoint.angular[2] =
     limit_data(
-    velocity_out->velocity.angular_z, 0 - cons_abs_ang_y_,
+    velocity_out.velocity.angular_z, 0 - cons_abs_ang_y_,
     cons_abs_ang_y_);
+  guard_lock.unlock();
 
-  ros_to_lcm_data_.order = ORDER_TYPE;
+  cmd_order_ = ORDER_TYPE;
+  // Source id is checked above, INTERNAL/REMOTEC/NAVIGATOR map to slots in priority order
+  velocity_channel_.push(velocity_out.sourceid - SE3VelocityCMD_T::INTERNAL, setpoint);
 }
 
 void MotionManager::publish_gait(const Gait_T & gait_out, const bool order_req)
 {
-  ros_to_lcm_data_.pattern = gait_out.gait;
+  cmd_pattern_ = gait_out.gait;
   gait_cached_ = gait_out;
 
-  ros_to_lcm_data_.angular[0] = 0;
-  ros_to_lcm_data_.angular[1] = 0;
-  ros_to_lcm_data_.angular[2] = 0;
+  velocity_channel_.clear_angular();
 
   auto condition_mode_avai = robot_control_state_.modestamped.control_mode >= Mode_T::MODE_MANUAL;
   if (condition_mode_avai && !order_req) {
@@ -1948,14 +2001,14 @@ void MotionManager::publish_control_state(const ControlState_T & control_state_o
   if (control_state_pub_->is_activated() &&
     this->count_subscribers(control_state_pub_->get_topic_name()) > 0)
   {
-    control_state_pub_->publish(control_state_out);
+    control_state_pub_->publish(std::make_unique<ControlState_T>(control_state_out));
   }
 }
 
 void MotionManager::publish_paras(const Parameters_T paras_out)
 {
-  ros_to_lcm_data_.body_height = paras_out.body_height;
-  ros_to_lcm_data_.gait_height = paras_out.gait_height;
+  cmd_body_height_ = paras_out.body_height;
+  cmd_gait_height_ = paras_out.gait_height;
 }
 
 void MotionManager::init()
@@ -1967,6 +2020,13 @@ void MotionManager::init()
   response_count_ = 0;
   odom_count_ = 0;
   last_motion_time_ = this->get_clock()->now();
+  ros_to_lcm_data_ = motion_control_request_lcmt();
+  cmd_pattern_ = Gait_T::GAIT_TRANS;
+  cmd_order_ = MonOrder_T::MONO_ORDER_NULL;
+  cmd_body_height_ = cons_default_body_;
+  cmd_gait_height_ = cons_default_gait_;
+  velocity_channel_.set_expiry(std::chrono::milliseconds(timeout_motion_));
+  velocity_channel_.clear(false);
 
   robot_control_state_ = ControlState_T();
   robot_control_state_.orderstamped.timestamp = this->get_clock()->now();
@@ -1975,11 +2035,14 @@ void MotionManager::init()
   robot_control_state_.gaitstamped.gait = Gait_T::GAIT_DEFAULT;
   robot_control_state_.velocitystamped.frameid.id = FrameID_T::ODOM_FRAME;
   robot_control_state_.posestamped.frameid.id = FrameID_T::ODOM_FRAME;
-  robot_body_tf_.header.frame_id = std::string("odom");
-  robot_body_tf_.child_frame_id = "base_footprint";
+  robot_body_tf_ = TFMessage_T();
+  robot_body_tf_.transforms.resize(1);
+  robot_body_tf_.transforms.front().header.frame_id = std::string("odom");
+  robot_body_tf_.transforms.front().child_frame_id = std::string("base_footprint");
   odom_ = nav_msgs::msg::Odometry();
   odom_.header.frame_id = std::string("odom");
   odom_.child_frame_id = std::string("base_footprint");
+  update_odom_subscribers(true);
 
   automation_manager_node_ =
     std::make_shared<manager::AutomationManager>("multi");
@@ -1989,8 +2052,12 @@ void MotionManager::init()
     &MotionManager::recv_lcm_control_handle, this);
   lcm_statees_res_handle_thread_ = std::make_unique<std::thread>(
     &MotionManager::recv_lcm_statees_handle, this);
+  control_loop_ = std::make_unique<DeadlineLoop>(
+    std::chrono::nanoseconds(1000000000 / rate_control_));
   control_cmd_thread_ = std::make_unique<std::thread>(
     &MotionManager::control_cmd_spin, this);
+  control_log_thread_ = std::make_unique<std::thread>(
+    &MotionManager::control_log_spin, this);
 
   // Parameter initialization
   Parameters_T default_para;
@@ -2004,19 +2071,6 @@ void MotionManager::init()
   gait_init.gait = Gait_T::GAIT_PASSIVE;
   gait_init.timestamp = this->get_clock()->now();
   publish_gait(gait_init);
-  auto goal_gait_t = 9;
-  auto current_gait_t = 3;
-  std::vector<cyberdog::bridge::GaitMono> gait_to_run_t;
-
-  auto time_a = get_clock()->now();
-  gait_interface_.get_bridges_list(goal_gait_t, current_gait_t, gait_to_run_t);
-  while (gait_to_run_t.size() > 0) {
-    message_info(std::string("gait to run is ") + gait_to_run_t.back().get_gait_name());
-    gait_to_run_t.pop_back();
-  }
-  auto time_b = get_clock()->now();
-  auto time_diff = time_b - time_a;
-  message_info(std::string("time diff is ") + std::to_string(time_diff.seconds()));
 }
 
 std_msgs::msg::Header MotionManager::return_custom_header(std::string frame_id)
@@ -2069,15 +2123,91 @@ bool MotionManager::inter_check_gait_sync(
 
 void MotionManager::publish_odom(const nav_msgs::msg::Odometry & odom_out)
 {
-  if (odom_pub_->is_activated() &&
-    this->count_subscribers(odom_pub_->get_topic_name()) > 0)
-  {
+  if (odom_pub_->is_activated() && odom_subscribed_) {
     odom_pub_->publish(odom_out);
   }
 }
 
+void MotionManager::publish_odom_sample(
+  const state_estimator_lcmt * lcm_data, const Time_T & odom_stamp)
+{
+  update_odom_subscribers();
+  if (!odom_subscribed_ && !tf_subscribed_) {
+    return;
+  }
+
+  // Pose is written once into the odom sample, body TF is derived from the same sample
+  if (odom_subscribed_ && odom_pub_->is_activated() && odom_pub_->can_loan_messages()) {
+    auto loaned_odom = odom_pub_->borrow_loaned_message();
+    auto & odom_sample = loaned_odom.get();
+    odom_sample.header.frame_id = odom_.header.frame_id;
+    odom_sample.child_frame_id = odom_.child_frame_id;
+    fill_odom_sample(lcm_data, odom_stamp, odom_sample);
+    publish_body_tf(odom_sample);
+    // LifecyclePublisher hides the loaned overload, activation is checked above
+    static_cast<rclcpp::Publisher<Odometry_T> &>(*odom_pub_).publish(std::move(loaned_odom));
+  } else {
+    fill_odom_sample(lcm_data, odom_stamp, odom_);
+    publish_body_tf(odom_);
+    publish_odom(odom_);
+  }
+}
+
+void MotionManager::publish_body_tf(const Odometry_T & odom_sample)
+{
+  if (!tf_subscribed_) {
+    return;
+  }
+  auto & body_tf = robot_body_tf_.transforms.front();
+  body_tf.header.stamp = odom_sample.header.stamp;
+  body_tf.transform.translation.x = odom_sample.pose.pose.position.x;
+  body_tf.transform.translation.y = odom_sample.pose.pose.position.y;
+  body_tf.transform.translation.z = odom_sample.pose.pose.position.z;
+  body_tf.transform.rotation = odom_sample.pose.pose.orientation;
+  tf_pub_->publish(robot_body_tf_);
+}
+
+void MotionManager::fill_odom_sample(
+  const state_estimator_lcmt * lcm_data, const Time_T & odom_stamp,
+  Odometry_T & odom_sample)
+{
+  odom_sample.header.stamp = odom_stamp;
+  odom_sample.twist.twist.linear.x = lcm_data->vBody[0];
+  odom_sample.twist.twist.linear.y = lcm_data->vBody[1];
+  odom_sample.twist.twist.linear.z = lcm_data->vBody[2];
+  odom_sample.twist.twist.angular.x = lcm_data->omegaBody[0];
+  odom_sample.twist.twist.angular.y = lcm_data->omegaBody[1];
+  odom_sample.twist.twist.angular.z = lcm_data->omegaBody[2];
+  odom_sample.pose.pose.position.x = lcm_data->p[0];
+  odom_sample.pose.pose.position.y = lcm_data->p[1];
+  odom_sample.pose.pose.position.z = lcm_data->p[2];
+  odom_sample.pose.pose.orientation.w = lcm_data->quat[0];
+  odom_sample.pose.pose.orientation.x = lcm_data->quat[1];
+  odom_sample.pose.pose.orientation.y = lcm_data->quat[2];
+  odom_sample.pose.pose.orientation.z = lcm_data->quat[3];
+}
+
+void MotionManager::update_odom_subscribers(const bool force)
+{
+  // Graph event is raised on any match change, so the counts are only queried then
+  if (!force && (!odom_graph_event_ || !odom_graph_event_->check_and_clear())) {
+    return;
+  }
+  odom_subscribed_ = odom_pub_->get_subscription_count() > 0;
+  // A TF listener of this node subscribes to /tf too, only other nodes count
+  bool tf_subscribed = false;
+  for (const auto & info : this->get_subscriptions_info_by_topic(tf_pub_->get_topic_name())) {
+    if (info.node_name() != this->get_name() || info.node_namespace() != this->get_namespace()) {
+      tf_subscribed = true;
+      break;
+    }
+  }
+  tf_subscribed_ = tf_subscribed;
+}
+
 void MotionManager::automation_node_spin()
 {
+  pthread_setname_np(pthread_self(), "motion_auto");
   node_exec_.add_node(automation_manager_node_->get_node_base_interface());
   node_exec_.spin();
   node_exec_.remove_node(automation_manager_node_->get_node_base_interface());
@@ -2085,23 +2215,41 @@ void MotionManager::automation_node_spin()
 
 void MotionManager::control_cmd_spin()
 {
-  // Send LCM message
-  rclcpp::WallRate control_rate_(rate_control_);
+  pthread_setname_np(pthread_self(), "motion_control");
+  // Send LCM message at absolute deadlines
+  if (!DeadlineLoop::set_realtime(rt_priority_control_)) {
+    control_log_.push(LOG_WARN, "[Control_Loop] Set SCHED_FIFO %d failed", rt_priority_control_);
+  }
+  if (!DeadlineLoop::set_affinity(rt_cpu_control_)) {
+    control_log_.push(LOG_WARN, "[Control_Loop] Pin to cpu %d failed", rt_cpu_control_);
+  }
   bool is_zeros;
+  bool is_fresh;
+  uint8_t velocity_source;
+  VelocitySetpoint setpoint;
   auto current_gait = robot_control_state_.gaitstamped;
-  auto current_motion_time = last_motion_time_;
-  auto TAG_MOVEMENT = std::string("[Movement_Detection] ");
+  const char * TAG_MOVEMENT = "[Movement_Detection] ";
   Gait_T gait_out;
 
+  control_loop_->start();
   while (rclcpp::ok() && thread_flag_) {
+    // Collect latest commands, the only writer of ros_to_lcm_data_
+    is_fresh = velocity_channel_.consume(setpoint, velocity_source);
+    for (uint8_t i = 0; i < 3; i++) {
+      ros_to_lcm_data_.linear[i] = setpoint.linear[i];
+      ros_to_lcm_data_.angular[i] = setpoint.angular[i];
+    }
+    ros_to_lcm_data_.pattern = cmd_pattern_;
+    ros_to_lcm_data_.order = cmd_order_;
+    ros_to_lcm_data_.body_height = cmd_body_height_;
+    ros_to_lcm_data_.gait_height = cmd_gait_height_;
+
     /*
     Movement detection. QP stand when velocity command is zeros.
   */
     current_gait = robot_control_state_.gaitstamped;
     auto cmd_gait = ros_to_lcm_data_.pattern;
-    if (robot_control_state_.modestamped.control_mode >= Mode_T::MODE_MANUAL &&
-      current_motion_time != last_motion_time_)
-    {
+    if (robot_control_state_.modestamped.control_mode >= Mode_T::MODE_MANUAL && is_fresh) {
       // Check output value is zero
       is_zeros = true;
       for (const auto & value : ros_to_lcm_data_.linear) {
@@ -2114,32 +2262,23 @@ void MotionManager::control_cmd_spin()
         (current_gait.gait > Gait_T::GAIT_STAND_B || cmd_gait > Gait_T::GAIT_STAND_B))
       {
         ros_to_lcm_data_.pattern = Gait_T::GAIT_STAND_B;
+        cmd_pattern_ = ros_to_lcm_data_.pattern;
         gait_out.timestamp = this->get_clock()->now();
         gait_out.gait = ros_to_lcm_data_.pattern;
         gait_pub_->publish(gait_out);
-        message_info(
-          TAG_MOVEMENT +
-          std::string("Stop when zero"));
-        for (auto & value : ros_to_lcm_data_.linear) {
-          value = static_cast<double>(0.0);
-        }
-        for (auto & value : ros_to_lcm_data_.angular) {
-          value = static_cast<double>(0.0);
-        }
-        message_info(
-          TAG_MOVEMENT +
-          std::string("Clear velocity cache"));
+        control_log_.push(LOG_INFO, "%sStop when zero", TAG_MOVEMENT);
+        velocity_channel_.clear(false);
+        control_log_.push(LOG_INFO, "%sClear velocity cache", TAG_MOVEMENT);
       } else if (!is_zeros) {
-        message_info(
-          TAG_MOVEMENT +
-          std::string("Run with cached gait ") +
-          gait_label_[gait_cached_.gait]);
+        control_log_.push(
+          LOG_INFO, "%sRun with cached gait %s", TAG_MOVEMENT,
+          gait_label_[gait_cached_.gait].c_str());
         ros_to_lcm_data_.pattern = gait_cached_.gait;
+        cmd_pattern_ = ros_to_lcm_data_.pattern;
         gait_out.timestamp = this->get_clock()->now();
         gait_out.gait = ros_to_lcm_data_.pattern;
         gait_pub_->publish(gait_out);
       }
-      current_motion_time = last_motion_time_;
     }
 
     #ifdef DEBUG_ALL
@@ -2167,15 +2306,72 @@ void MotionManager::control_cmd_spin()
     #ifdef DEBUG_MOTION
     // [Log] Output current gait
     if (ros_to_lcm_data_.pattern > Gait_T::GAIT_TRANS) {
-      message_info(std::string("Current gait is ") + gait_label_[ros_to_lcm_data_.pattern]);
+      control_log_.push(
+        LOG_INFO, "Current gait is %s",
+        gait_label_[ros_to_lcm_data_.pattern].c_str());
     }
     #endif
     #endif
 
     motion_out_->publish("exec_request", &ros_to_lcm_data_);
 
-    control_rate_.sleep();
+    control_loop_->wait();
+  }
+}
+
+void MotionManager::control_log_spin()
+{
+  pthread_setname_np(pthread_self(), "motion_log");
+  // Drain control thread logs, report loop timing periodically
+  rclcpp::WallRate log_rate_(rate_output_);
+  auto TAG_LOOP = std::string("[Control_Loop] ");
+  auto report_cycles = std::max<uint64_t>(static_cast<uint64_t>(rate_output_) * 30, 1);
+  uint64_t loop_count(0);
+  uint64_t last_overruns(0);
+  LogEntry entry;
+
+  auto report = [&]() {
+      auto stats = control_loop_->stats(true);
+      auto report_str = TAG_LOOP +
+        std::string("Cycles ") + std::to_string(stats.cycles) +
+        std::string(", overruns ") + std::to_string(stats.overruns) +
+        std::string(" (missed ") + std::to_string(stats.missed) +
+        std::string("), jitter max/mean ") + std::to_string(stats.jitter_max / 1000) +
+        std::string("/") + std::to_string(stats.jitter_mean / 1000) +
+        std::string(" us, work max ") + std::to_string(stats.work_max / 1000) +
+        std::string(" us");
+      if (stats.overruns != last_overruns) {
+        message_warn(report_str);
+      } else {
+        message_info(report_str);
+      }
+      last_overruns = stats.overruns;
+    };
+
+  while (rclcpp::ok() && thread_flag_) {
+    while (control_log_.pop(entry)) {
+      switch (entry.level) {
+        case LOG_WARN:
+          message_warn(entry.text);
+          break;
+        case LOG_ERROR:
+          message_error(entry.text);
+          break;
+        default:
+          message_info(entry.text);
+          break;
+      }
+    }
+    auto dropped = control_log_.take_dropped();
+    if (dropped > 0) {
+      message_warn(TAG_LOOP + std::to_string(dropped) + std::string(" log lines dropped"));
+    }
+    if (++loop_count % report_cycles == 0) {
+      report();
+    }
+    log_rate_.sleep();
   }
+  report();
 }
 
 template<typename T>
@@ -2197,11 +2393,24 @@ void MotionManager::parameter_check(
 
 void MotionManager::reset_velocity(const uint8_t & order_id)
 {
-  auto velocity_zero = std::make_unique<SE3VelocityCMD_T>();
-  velocity_zero->sourceid = SE3VelocityCMD_T::INTERNAL;
-  velocity_zero->velocity.frameid.id = FrameID_T::BODY_FRAME;
-  velocity_zero->velocity.timestamp = this->get_clock()->now();
-  publish_velocity(std::move(velocity_zero), order_id);
+  if (robot_control_state_.modestamped.control_mode < Mode_T::MODE_MANUAL) {
+    return;
+  }
+  last_motion_time_ = this->get_clock()->now();
+
+  if (cmd_pub_->is_activated() &&
+    this->count_subscribers(cmd_pub_->get_topic_name()) > 0)
+  {
+    SE3VelocityCMD_T velocity_zero;
+    velocity_zero.sourceid = SE3VelocityCMD_T::INTERNAL;
+    velocity_zero.velocity.frameid.id = FrameID_T::BODY_FRAME;
+    velocity_zero.velocity.timestamp = last_motion_time_;
+    cmd_pub_->publish(velocity_zero);
+  }
+
+  // Zero every source instead of pushing internal zeros, which would shadow other sources
+  cmd_order_ = order_id;
+  velocity_channel_.clear();
 }
 
 bool MotionManager::check_motor_errflag(bool show_all)
@@ -0,0 +1,247 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Fixed rate against event driven BehaviorTreeEngine::run.
+// A leaf waits for a topic, a source node publishes it at random intervals.
+// Reaction latency is publish -> tree returns SUCCESS, idle cost is CPU of
+// the engine thread while the tree runs without any event.
+//
+// Usage: bt_tick_bench [events] [idle_seconds] [loop_ms] [max_period_ms]
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "behaviortree_cpp_v3/action_node.h"
+#include "manager_utils/bt_engine.hpp"
+#include "manager_utils/bt_wakeup.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "std_msgs/msg/header.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using Header_T = std_msgs::msg::Header;
+
+const char TOPIC[] = "bt_tick_bench_event";
+const char TREE[] =
+  "<root main_tree_to_execute=\"Bench\">"
+  "<BehaviorTree ID=\"Bench\"><WaitTopic/></BehaviorTree>"
+  "</root>";
+
+int64_t steady_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+double thread_cpu_seconds()
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+std::vector<double> latency_ms;
+std::atomic<uint64_t> tick_count{0};
+
+/**
+ * @brief Leaf waiting for one message, registered the same way as BtActionNode
+ */
+class WaitTopic : public BT::ActionNodeBase
+{
+public:
+  WaitTopic(const std::string & name, const BT::NodeConfiguration & conf)
+  : BT::ActionNodeBase(name, conf), stamp_ns_(0)
+  {
+    auto node = config().blackboard->get<rclcpp::Node::SharedPtr>("node");
+    callback_group_ = node->create_callback_group(
+      rclcpp::CallbackGroupType::MutuallyExclusive, false);
+    config().blackboard->get<std::shared_ptr<cyberdog::bt_engine::BtWakeup>>(
+      "bt_wakeup", wakeup_);
+    executor_ = wakeup_ ?
+      wakeup_->executor() :
+      std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+    executor_->add_callback_group(callback_group_, node->get_node_base_interface());
+
+    rclcpp::SubscriptionOptions options;
+    options.callback_group = callback_group_;
+    sub_ = node->create_subscription<Header_T>(
+      TOPIC, rclcpp::QoS(10).reliable(),
+      [this](const Header_T::SharedPtr msg) {
+        stamp_ns_ = int64_t(msg->stamp.sec) * 1000000000 + msg->stamp.nanosec;
+        if (wakeup_) {
+          wakeup_->notify();
+        }
+      }, options);
+  }
+
+  ~WaitTopic()
+  {
+    executor_->remove_callback_group(callback_group_);
+  }
+
+  static BT::PortsList providedPorts() {return {};}
+
+  BT::NodeStatus tick() override
+  {
+    tick_count++;
+    if (!wakeup_) {
+      executor_->spin_some();
+    }
+    if (stamp_ns_ == 0) {
+      return BT::NodeStatus::RUNNING;
+    }
+    latency_ms.push_back((steady_ns() - stamp_ns_) * 1e-6);
+    stamp_ns_ = 0;
+    return BT::NodeStatus::SUCCESS;
+  }
+
+  void halt() override
+  {
+    setStatus(BT::NodeStatus::IDLE);
+  }
+
+private:
+  rclcpp::CallbackGroup::SharedPtr callback_group_;
+  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> executor_;
+  std::shared_ptr<cyberdog::bt_engine::BtWakeup> wakeup_;
+  rclcpp::Subscription<Header_T>::SharedPtr sub_;
+  int64_t stamp_ns_;
+};
+
+class BenchEngine : public cyberdog::bt_engine::BehaviorTreeEngine
+{
+public:
+  BenchEngine()
+  : BehaviorTreeEngine({})
+  {
+    factory_.registerNodeType<WaitTopic>("WaitTopic");
+  }
+};
+
+struct ModeResult
+{
+  std::vector<double> latency;
+  double idle_cpu;
+  double idle_tick_hz;
+};
+
+ModeResult run_mode(
+  const bool event_driven, const int events, const int idle_seconds,
+  const std::chrono::milliseconds loop, const std::chrono::milliseconds max_period,
+  const rclcpp::Node::SharedPtr & tree_node, const rclcpp::Node::SharedPtr & source_node)
+{
+  BenchEngine engine;
+  auto blackboard = BT::Blackboard::create();
+  blackboard->set<rclcpp::Node::SharedPtr>("node", tree_node);
+  std::shared_ptr<cyberdog::bt_engine::BtWakeup> wakeup;
+  if (event_driven) {
+    wakeup = std::make_shared<cyberdog::bt_engine::BtWakeup>();
+    blackboard->set<std::shared_ptr<cyberdog::bt_engine::BtWakeup>>("bt_wakeup", wakeup);
+  }
+  auto tree = engine.createTreeFromText(TREE, blackboard);
+  auto run = [&](std::function<bool()> cancel) {
+      return event_driven ?
+             engine.run(&tree, []() {}, cancel, wakeup, max_period) :
+             engine.run(&tree, []() {}, cancel, loop);
+    };
+
+  auto pub = source_node->create_publisher<Header_T>(TOPIC, rclcpp::QoS(10).reliable());
+  while (pub->get_subscription_count() == 0 && rclcpp::ok()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Reaction latency, the source fires at random phase against the tick period
+  latency_ms.clear();
+  std::atomic_bool done(false);
+  std::thread source([&]() {
+      std::mt19937 random(42);
+      std::uniform_int_distribution<int> gap_us(5000, 25000);
+      while (!done && rclcpp::ok()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(gap_us(random)));
+        Header_T msg;
+        auto now = steady_ns();
+        msg.stamp.sec = now / 1000000000;
+        msg.stamp.nanosec = now % 1000000000;
+        pub->publish(msg);
+      }
+    });
+  for (int i = 0; i < events && rclcpp::ok(); i++) {
+    run([]() {return false;});
+  }
+  done = true;
+  source.join();
+  ModeResult result;
+  result.latency = latency_ms;
+
+  // Idle cost, nothing is published, cancel after idle_seconds
+  auto idle_end = Clock::now() + std::chrono::seconds(idle_seconds);
+  auto ticks = tick_count.load();
+  auto cpu = thread_cpu_seconds();
+  run([&idle_end]() {return Clock::now() >= idle_end;});
+  result.idle_cpu = (thread_cpu_seconds() - cpu) / idle_seconds * 100;
+  result.idle_tick_hz = double(tick_count.load() - ticks) / idle_seconds;
+  return result;
+}
+
+void report(const std::string & mode, ModeResult result)
+{
+  auto & latency = result.latency;
+  std::printf("== %s\n", mode.c_str());
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    auto pick = [&latency](double q) {
+        return latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+      };
+    std::printf(
+      "  latency publish -> SUCCESS ms: n %zu p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+      latency.size(), pick(0.5), pick(0.9), pick(0.99), latency.back());
+  }
+  std::printf("  idle cpu %.2f %%, ticks %.1f Hz\n", result.idle_cpu, result.idle_tick_hz);
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  int events = argc > 1 ? std::max(1, std::atoi(argv[1])) : 500;
+  int idle_seconds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+  auto loop = std::chrono::milliseconds(argc > 3 ? std::max(1, std::atoi(argv[3])) : 10);
+  auto max_period = std::chrono::milliseconds(argc > 4 ? std::max(1, std::atoi(argv[4])) : 100);
+
+  rclcpp::init(argc, argv);
+  auto tree_node = std::make_shared<rclcpp::Node>("bt_tick_bench_tree");
+  auto source_node = std::make_shared<rclcpp::Node>("bt_tick_bench_source");
+
+  std::printf(
+    "%d events, %d s idle, loop %ld ms, max period %ld ms\n", events, idle_seconds,
+    static_cast<long>(loop.count()), static_cast<long>(max_period.count()));  // NOLINT
+  report(
+    "fixed rate",
+    run_mode(false, events, idle_seconds, loop, max_period, tree_node, source_node));
+  report(
+    "event driven",
+    run_mode(true, events, idle_seconds, loop, max_period, tree_node, source_node));
+
+  rclcpp::shutdown();
+  return 0;
+}
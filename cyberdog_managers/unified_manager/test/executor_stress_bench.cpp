@@ -0,0 +1,225 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Velocity callback latency under concurrent service load, for the single
+// MultiThreadedExecutor layout against a dedicated control executor.
+// A manager node has a velocity subscription and a slow service, client
+// threads keep calling the service while velocity is published at fixed rate.
+// Latency is publish -> velocity callback entered.
+//
+// Usage: executor_stress_bench [seconds] [clients] [service_ms] [rate_hz] [control_priority]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "automation_msgs/srv/nav_mode.hpp"
+#include "manager_utils/executor_layout.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "std_msgs/msg/header.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using Header_T = std_msgs::msg::Header;
+using NavMode_T = automation_msgs::srv::NavMode;
+
+const char VELOCITY[] = "executor_stress_velocity";
+const char SERVICE[] = "executor_stress_service";
+
+int64_t steady_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+struct Options
+{
+  int seconds;
+  int clients;
+  std::chrono::milliseconds service_time;
+  int rate_hz;
+  int control_priority;
+};
+
+struct ModeResult
+{
+  std::vector<double> latency;
+  uint64_t calls;
+};
+
+/**
+ * @brief Node shaped like MotionManager, velocity and services share a node
+ */
+class StressManager : public rclcpp::Node
+{
+public:
+  StressManager(const bool isolated, const std::chrono::milliseconds service_time)
+  : rclcpp::Node("executor_stress_manager")
+  {
+    rclcpp::SubscriptionOptions options;
+    if (isolated) {
+      groups_["control"] = create_callback_group(
+        rclcpp::CallbackGroupType::MutuallyExclusive, false);
+      options.callback_group = groups_["control"];
+    }
+    velocity_sub_ = create_subscription<Header_T>(
+      VELOCITY, rclcpp::SystemDefaultsQoS(),
+      [this](const Header_T::SharedPtr msg) {
+        auto stamp_ns = int64_t(msg->stamp.sec) * 1000000000 + msg->stamp.nanosec;
+        std::lock_guard<std::mutex> lock(mutex_);
+        latency_ms_.push_back((steady_ns() - stamp_ns) * 1e-6);
+      }, options);
+    service_ = create_service<NavMode_T>(
+      SERVICE,
+      [service_time](
+        const std::shared_ptr<NavMode_T::Request>,
+        std::shared_ptr<NavMode_T::Response> response) {
+        std::this_thread::sleep_for(service_time);
+        response->success = true;
+      });
+  }
+
+  const cyberdog::manager::ExecutorLayout::Groups_T & groups() const {return groups_;}
+
+  std::vector<double> latency()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latency_ms_;
+  }
+
+private:
+  cyberdog::manager::ExecutorLayout::Groups_T groups_;
+  rclcpp::Subscription<Header_T>::SharedPtr velocity_sub_;
+  rclcpp::Service<NavMode_T>::SharedPtr service_;
+  std::mutex mutex_;
+  std::vector<double> latency_ms_;
+};
+
+ModeResult run_mode(const bool isolated, const Options & options)
+{
+  auto manager = std::make_shared<StressManager>(isolated, options.service_time);
+  cyberdog::manager::ExecutorLayout layout;
+  if (isolated) {
+    cyberdog::manager::ExecutorConfig control;
+    control.name = "control";
+    control.threads = 1;
+    control.priority = options.control_priority;
+    control.groups = {"control"};
+    layout.add_executor(control);
+  }
+  layout.add_node(manager->get_node_base_interface(), manager->groups());
+  layout.spin();
+
+  // Clients and publisher live in another process-local node and executor
+  auto source = std::make_shared<rclcpp::Node>("executor_stress_source");
+  rclcpp::executors::MultiThreadedExecutor source_exec;
+  source_exec.add_node(source);
+  std::thread source_spin([&source_exec]() {source_exec.spin();});
+
+  auto pub = source->create_publisher<Header_T>(VELOCITY, rclcpp::SystemDefaultsQoS());
+  while (pub->get_subscription_count() == 0 && rclcpp::ok()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::atomic_bool done(false);
+  std::atomic<uint64_t> calls(0);
+  std::vector<std::thread> clients;
+  for (int i = 0; i < options.clients; i++) {
+    clients.emplace_back(
+      [&]() {
+        auto client = source->create_client<NavMode_T>(SERVICE);
+        client->wait_for_service(std::chrono::seconds(5));
+        while (!done && rclcpp::ok()) {
+          auto future = client->async_send_request(std::make_shared<NavMode_T::Request>());
+          if (future.wait_for(std::chrono::seconds(5)) == std::future_status::ready) {
+            calls++;
+          }
+        }
+      });
+  }
+
+  auto period = std::chrono::nanoseconds(1000000000 / std::max(1, options.rate_hz));
+  auto next = Clock::now();
+  auto end = next + std::chrono::seconds(options.seconds);
+  while (Clock::now() < end && rclcpp::ok()) {
+    next += period;
+    std::this_thread::sleep_until(next);
+    Header_T msg;
+    auto now = steady_ns();
+    msg.stamp.sec = now / 1000000000;
+    msg.stamp.nanosec = now % 1000000000;
+    pub->publish(msg);
+  }
+  // Let queued velocity drain before collecting
+  std::this_thread::sleep_for(options.service_time * 2);
+  done = true;
+  for (auto & client : clients) {
+    client.join();
+  }
+  source_exec.cancel();
+  source_spin.join();
+  layout.cancel();
+  layout.join();
+
+  return ModeResult{manager->latency(), calls.load()};
+}
+
+void report(const std::string & mode, ModeResult result, const Options & options)
+{
+  auto & latency = result.latency;
+  std::printf("== %s\n", mode.c_str());
+  std::printf(
+    "  service calls %.1f /s, velocity received %zu of %d\n",
+    double(result.calls) / options.seconds, latency.size(), options.seconds * options.rate_hz);
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    auto pick = [&latency](double q) {
+        return latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+      };
+    std::printf(
+      "  latency publish -> callback ms: p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+      pick(0.5), pick(0.9), pick(0.99), latency.back());
+  }
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  options.seconds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+  options.clients = argc > 2 ? std::max(0, std::atoi(argv[2])) : 4;
+  options.service_time =
+    std::chrono::milliseconds(argc > 3 ? std::max(0, std::atoi(argv[3])) : 50);
+  options.rate_hz = argc > 4 ? std::max(1, std::atoi(argv[4])) : 100;
+  options.control_priority = argc > 5 ? std::max(0, std::atoi(argv[5])) : 0;
+
+  rclcpp::init(argc, argv);
+  std::printf(
+    "%d s, %d clients, service %ld ms, velocity %d Hz, control priority %d\n",
+    options.seconds, options.clients, static_cast<long>(options.service_time.count()),  // NOLINT
+    options.rate_hz, options.control_priority);
+  report("single executor, default group", run_mode(false, options), options);
+  report("control group on own executor", run_mode(true, options), options);
+
+  rclcpp::shutdown();
+  return 0;
+}
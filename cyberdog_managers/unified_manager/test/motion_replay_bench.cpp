@@ -0,0 +1,460 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Offline replay benchmark for MotionManager.
+// A fake motion controller talks LCM to the manager on host-local multicast
+// (ttl 0, private ports), state estimator / control response streams are
+// synthetic or replayed from an LCM log. Mode, gait, velocity and order
+// requests are driven through the real topics and actions.
+//
+// Usage: motion_replay_bench [seconds_per_phase] [lcm_log_file]
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lcm/lcm-cpp.hpp"
+#include "managers/motion_manager.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_action/rclcpp_action.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using ChangeMode_T = motion_msgs::action::ChangeMode;
+using ChangeGait_T = motion_msgs::action::ChangeGait;
+using ExtMonOrder_T = motion_msgs::action::ExtMonOrder;
+
+const char LCM_GROUP[] = "239.255.76.67";
+const int PORT_RESPONSE = 27670;
+const int PORT_REQUEST = 27671;
+const int PORT_ESTIMATOR = 27669;
+const int RATE_CONTROLLER_HZ = 500;
+const int RATE_VELOCITY_HZ = 50;
+// Velocity command carries its sequence in linear_x, inside every speed limit
+const double SEQ_BASE = 0.2;
+const double SEQ_STEP = 1e-4;
+const uint32_t SEQ_WINDOW = 1000;
+
+std::string lcm_url(const int port)
+{
+  return std::string("udpm://") + LCM_GROUP + ":" + std::to_string(port) + "?ttl=0";
+}
+
+/**
+ * @brief Stand-in for the motion controller, echoes gait and order back
+ */
+class FakeController
+{
+public:
+  explicit FakeController(const std::string & log_file)
+  : request_in_(lcm_url(PORT_REQUEST)),
+    response_out_(lcm_url(PORT_RESPONSE)),
+    estimator_out_(lcm_url(PORT_ESTIMATOR)),
+    log_file_(log_file),
+    running_(true),
+    requests_(0),
+    last_seq_(SEQ_WINDOW)
+  {
+    response_.pattern = motion_msgs::msg::Gait::GAIT_PASSIVE;
+    request_in_.subscribe("exec_request", &FakeController::request_callback, this);
+    recv_thread_ = std::thread(&FakeController::recv_spin, this);
+    send_thread_ = std::thread(&FakeController::send_spin, this);
+  }
+
+  ~FakeController()
+  {
+    running_ = false;
+    recv_thread_.join();
+    send_thread_.join();
+  }
+
+  void mark_sent(const uint32_t seq)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sent_[seq % SEQ_WINDOW] = Clock::now();
+  }
+
+  std::vector<double> take_latency()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<double> latency;
+    latency.swap(latency_ms_);
+    return latency;
+  }
+
+  uint64_t requests() const {return requests_;}
+
+private:
+  void request_callback(
+    const lcm::ReceiveBuffer *, const std::string &,
+    const motion_control_request_lcmt * request)
+  {
+    auto now = Clock::now();
+    requests_++;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (request->pattern != motion_msgs::msg::Gait::GAIT_TRANS) {
+      response_.pattern = request->pattern;
+    }
+    response_.order = request->order;
+    response_.order_process_bar = request->order == 0 ? 0 : 100;
+
+    auto seq_real = (request->linear[0] - SEQ_BASE) / SEQ_STEP;
+    if (seq_real < -0.5 || seq_real > SEQ_WINDOW - 0.5) {
+      return;
+    }
+    auto seq = static_cast<uint32_t>(std::lround(seq_real));
+    if (seq != last_seq_ && sent_[seq].time_since_epoch().count() != 0) {
+      latency_ms_.push_back(
+        std::chrono::duration<double, std::milli>(now - sent_[seq]).count());
+      sent_[seq] = Clock::time_point();
+      last_seq_ = seq;
+    }
+  }
+
+  void recv_spin()
+  {
+    while (running_) {
+      request_in_.handleTimeout(100);
+    }
+  }
+
+  void send_spin()
+  {
+    lcm::LogFile * log = nullptr;
+    std::unique_ptr<lcm::LogFile> log_holder;
+    if (!log_file_.empty()) {
+      log_holder = std::make_unique<lcm::LogFile>(log_file_, "r");
+      if (log_holder->good()) {
+        log = log_holder.get();
+      } else {
+        std::printf("LCM log %s can not be opened, use synthetic streams\n", log_file_.c_str());
+      }
+    }
+
+    auto period = std::chrono::nanoseconds(1000000000 / RATE_CONTROLLER_HZ);
+    auto next = Clock::now();
+    int64_t log_origin(-1);
+    auto wall_origin = Clock::now();
+    state_estimator_lcmt estimator{};
+    estimator.quat[0] = 1.0;
+    uint64_t tick(0);
+
+    while (running_) {
+      if (log != nullptr) {
+        auto event = log->readNextEvent();
+        if (event == nullptr) {
+          log->seekToTimestamp(0);
+          log_origin = -1;
+          continue;
+        }
+        if (log_origin < 0) {
+          log_origin = event->timestamp;
+          wall_origin = Clock::now();
+        }
+        std::this_thread::sleep_until(
+          wall_origin + std::chrono::microseconds(event->timestamp - log_origin));
+        if (event->channel == "state_estimator") {
+          estimator_out_.publish(event->channel, event->data, event->datalen);
+        } else if (event->channel == "exec_response") {
+          response_out_.publish(event->channel, event->data, event->datalen);
+        }
+        continue;
+      }
+
+      // Synthetic: slow forward drift and yaw, gait / order echoed from requests
+      auto t = static_cast<float>(tick++) / RATE_CONTROLLER_HZ;
+      estimator.p[0] = 0.1f * t;
+      estimator.vBody[0] = 0.1f;
+      estimator.rpy[2] = 0.05f * t;
+      estimator.quat[0] = std::cos(estimator.rpy[2] / 2);
+      estimator.quat[3] = std::sin(estimator.rpy[2] / 2);
+      estimator.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+      estimator_out_.publish("state_estimator", &estimator);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        response_out_.publish("exec_response", &response_);
+      }
+      next += period;
+      std::this_thread::sleep_until(next);
+    }
+  }
+
+  lcm::LCM request_in_;
+  lcm::LCM response_out_;
+  lcm::LCM estimator_out_;
+  std::string log_file_;
+  std::atomic_bool running_;
+  std::atomic<uint64_t> requests_;
+  std::mutex mutex_;
+  motion_control_response_lcmt response_{};
+  std::array<Clock::time_point, SEQ_WINDOW> sent_{};
+  std::vector<double> latency_ms_;
+  uint32_t last_seq_;
+  std::thread recv_thread_;
+  std::thread send_thread_;
+};
+
+/**
+ * @brief Per thread cpu time of this process, from /proc/self/task
+ */
+std::map<std::string, double> thread_cpu_seconds()
+{
+  std::map<std::string, double> cpu;
+  auto ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+  auto dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return cpu;
+  }
+  while (auto entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    std::ifstream stat_file(std::string("/proc/self/task/") + entry->d_name + "/stat");
+    std::string line;
+    std::getline(stat_file, line);
+    auto name_begin = line.find('(');
+    auto name_end = line.rfind(')');
+    if (name_begin == std::string::npos || name_end == std::string::npos) {
+      continue;
+    }
+    auto name = line.substr(name_begin + 1, name_end - name_begin - 1);
+    std::istringstream fields(line.substr(name_end + 2));
+    std::string field;
+    uint64_t utime(0), stime(0);
+    // Field 3 (state) is first after the name, utime/stime are fields 14/15
+    for (int i = 3; i <= 15 && fields >> field; i++) {
+      if (i == 14) {utime = std::stoull(field);}
+      if (i == 15) {stime = std::stoull(field);}
+    }
+    cpu[name] += (utime + stime) / ticks;
+  }
+  closedir(dir);
+  return cpu;
+}
+
+class BenchNode : public rclcpp::Node
+{
+public:
+  BenchNode()
+  : Node("motion_replay_bench"), odom_count_(0), status_count_(0)
+  {
+    velocity_pub_ = create_publisher<motion_msgs::msg::SE3VelocityCMD>(
+      "body_cmd", rclcpp::SystemDefaultsQoS());
+    odom_sub_ = create_subscription<nav_msgs::msg::Odometry>(
+      "odom_out", rclcpp::SystemDefaultsQoS(),
+      [this](const nav_msgs::msg::Odometry::SharedPtr) {odom_count_++;});
+    status_sub_ = create_subscription<motion_msgs::msg::ControlState>(
+      "status_out", rclcpp::SystemDefaultsQoS(),
+      [this](const motion_msgs::msg::ControlState::SharedPtr) {status_count_++;});
+    mode_client_ = rclcpp_action::create_client<ChangeMode_T>(this, "checkout_mode");
+    gait_client_ = rclcpp_action::create_client<ChangeGait_T>(this, "checkout_gait");
+    order_client_ = rclcpp_action::create_client<ExtMonOrder_T>(this, "exe_monorder");
+  }
+
+  template<typename ActionT>
+  bool send_and_wait(
+    typename rclcpp_action::Client<ActionT>::SharedPtr client,
+    const typename ActionT::Goal & goal, const std::chrono::seconds timeout)
+  {
+    if (!client->wait_for_action_server(timeout)) {
+      return false;
+    }
+    auto goal_handle = client->async_send_goal(goal).get();
+    if (!goal_handle) {
+      return false;
+    }
+    auto result = client->async_get_result(goal_handle);
+    if (result.wait_for(timeout) != std::future_status::ready) {
+      return false;
+    }
+    return result.get().result->succeed;
+  }
+
+  bool change_mode(const uint8_t mode)
+  {
+    ChangeMode_T::Goal goal;
+    goal.modestamped.timestamp = now();
+    goal.modestamped.control_mode = mode;
+    return send_and_wait<ChangeMode_T>(mode_client_, goal, std::chrono::seconds(20));
+  }
+
+  bool change_gait(const uint8_t gait)
+  {
+    ChangeGait_T::Goal goal;
+    goal.motivation = cyberdog_utils::GAIT_TRIG;
+    goal.gaitstamped.timestamp = now();
+    goal.gaitstamped.gait = gait;
+    return send_and_wait<ChangeGait_T>(gait_client_, goal, std::chrono::seconds(20));
+  }
+
+  bool run_order(const uint8_t order)
+  {
+    ExtMonOrder_T::Goal goal;
+    goal.orderstamped.timestamp = now();
+    goal.orderstamped.id = order;
+    return send_and_wait<ExtMonOrder_T>(order_client_, goal, std::chrono::seconds(30));
+  }
+
+  void send_velocity(const uint32_t seq)
+  {
+    motion_msgs::msg::SE3VelocityCMD cmd;
+    cmd.sourceid = motion_msgs::msg::SE3VelocityCMD::REMOTEC;
+    cmd.velocity.frameid.id = motion_msgs::msg::FrameID::BODY_FRAME;
+    cmd.velocity.timestamp = now();
+    cmd.velocity.linear_x = SEQ_BASE + (seq % SEQ_WINDOW) * SEQ_STEP;
+    velocity_pub_->publish(cmd);
+  }
+
+  std::atomic<uint64_t> odom_count_;
+  std::atomic<uint64_t> status_count_;
+
+private:
+  rclcpp::Publisher<motion_msgs::msg::SE3VelocityCMD>::SharedPtr velocity_pub_;
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
+  rclcpp::Subscription<motion_msgs::msg::ControlState>::SharedPtr status_sub_;
+  rclcpp_action::Client<ChangeMode_T>::SharedPtr mode_client_;
+  rclcpp_action::Client<ChangeGait_T>::SharedPtr gait_client_;
+  rclcpp_action::Client<ExtMonOrder_T>::SharedPtr order_client_;
+};
+
+struct PhaseCounters
+{
+  Clock::time_point start;
+  uint64_t requests;
+  uint64_t odom;
+  uint64_t status;
+  std::map<std::string, double> cpu;
+};
+
+PhaseCounters snapshot(const FakeController & controller, const BenchNode & bench)
+{
+  return PhaseCounters{Clock::now(), controller.requests(), bench.odom_count_,
+    bench.status_count_, thread_cpu_seconds()};
+}
+
+void report(
+  const std::string & phase, const PhaseCounters & begin, const PhaseCounters & end,
+  std::vector<double> latency)
+{
+  auto seconds = std::chrono::duration<double>(end.start - begin.start).count();
+  std::printf("== %s (%.1f s)\n", phase.c_str(), seconds);
+  std::printf(
+    "  rate exec_request %.1f Hz, odom_out %.1f Hz, status_out %.1f Hz\n",
+    (end.requests - begin.requests) / seconds,
+    (end.odom - begin.odom) / seconds,
+    (end.status - begin.status) / seconds);
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    auto pick = [&latency](double q) {
+        return latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+      };
+    std::printf(
+      "  latency body_cmd -> exec_request ms: n %zu p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+      latency.size(), pick(0.5), pick(0.9), pick(0.99), latency.back());
+  }
+  for (const auto & thread : end.cpu) {
+    auto before = begin.cpu.find(thread.first);
+    auto used = thread.second - (before == begin.cpu.end() ? 0.0 : before->second);
+    if (used > 0.0) {
+      std::printf("  cpu %-16s %5.1f %%\n", thread.first.c_str(), used / seconds * 100);
+    }
+  }
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  int phase_seconds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+  std::string log_file = argc > 2 ? argv[2] : "";
+
+  // Point the manager at host-local LCM ports so a real robot is never reached
+  std::vector<std::string> args{argv[0], "--ros-args",
+    "-p", "port_recv_from_motion:=" + std::to_string(PORT_RESPONSE),
+    "-p", "port_send_to_motion:=" + std::to_string(PORT_REQUEST),
+    "-p", "port_from_odom:=" + std::to_string(PORT_ESTIMATOR),
+    "-p", "ttl_recv_from_motion:=0",
+    "-p", "ttl_send_to_motion:=0",
+    "-p", "ttl_from_odom:=0"};
+  std::vector<const char *> args_c;
+  for (const auto & arg : args) {
+    args_c.push_back(arg.c_str());
+  }
+  rclcpp::init(static_cast<int>(args_c.size()), args_c.data());
+
+  FakeController controller(log_file);
+  auto node_motion = std::make_shared<cyberdog::manager::MotionManager>();
+  auto node_bench = std::make_shared<BenchNode>();
+  while (rclcpp::ok() && !node_motion->auto_check(cyberdog_utils::CHECK_TO_START)) {}
+
+  rclcpp::executors::MultiThreadedExecutor exec_;
+  exec_.add_node(node_motion->get_node_base_interface());
+  exec_.add_node(node_bench->get_node_base_interface());
+  std::thread spin_thread([&exec_]() {exec_.spin();});
+
+  // Idle: only controller streams
+  auto begin = snapshot(controller, *node_bench);
+  std::this_thread::sleep_for(std::chrono::seconds(phase_seconds));
+  auto end = snapshot(controller, *node_bench);
+  report("idle", begin, end, controller.take_latency());
+
+  // Mode & gait through actions
+  begin = snapshot(controller, *node_bench);
+  auto mode_ok = node_bench->change_mode(motion_msgs::msg::Mode::MODE_MANUAL);
+  auto gait_ok = mode_ok && node_bench->change_gait(motion_msgs::msg::Gait::GAIT_WALK);
+  end = snapshot(controller, *node_bench);
+  std::printf("mode MANUAL %s, gait WALK %s\n", mode_ok ? "ok" : "failed", gait_ok ? "ok" : "failed");
+  report("mode & gait", begin, end, controller.take_latency());
+
+  // Velocity stream
+  begin = snapshot(controller, *node_bench);
+  auto period = std::chrono::nanoseconds(1000000000 / RATE_VELOCITY_HZ);
+  auto next = Clock::now();
+  for (uint32_t seq = 0; seq < static_cast<uint32_t>(phase_seconds * RATE_VELOCITY_HZ); seq++) {
+    controller.mark_sent(seq);
+    node_bench->send_velocity(seq);
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+  end = snapshot(controller, *node_bench);
+  report("velocity", begin, end, controller.take_latency());
+
+  // Order
+  begin = snapshot(controller, *node_bench);
+  auto order_ok = node_bench->run_order(motion_msgs::msg::MonOrder::MONO_ORDER_STEP_BACK);
+  end = snapshot(controller, *node_bench);
+  std::printf("order STEP_BACK %s\n", order_ok ? "ok" : "failed");
+  report("order", begin, end, controller.take_latency());
+
+  node_motion->auto_check(cyberdog_utils::CHECK_TO_PAUSE);
+  exec_.cancel();
+  spin_thread.join();
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,207 @@
+// Copyright (c) 2021 Beijing Xiaomi Mobile Software Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Per message latency and CPU of state between managers of one process.
+// Control state goes from one node to another through the middleware,
+// through intra-process with unique_ptr, and through the state bus.
+// State bus is polled with a cursor by a timer of the receiving node at
+// BENCH_POLL_FACTOR times the rate, as managers take it in their own loop.
+// Latency is publish -> callback entered or state taken, CPU is user +
+// system time of the whole process divided by messages delivered.
+//
+// Usage: state_bus_bench [messages] [rate_hz]
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "manager_utils/state_bus.hpp"
+#include "motion_msgs/msg/control_state.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using ControlState_T = motion_msgs::msg::ControlState;
+
+const char TOPIC[] = "state_bus_bench";
+#define BENCH_POLL_FACTOR 4
+
+int64_t steady_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+double cpu_seconds()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+enum Path
+{
+  MIDDLEWARE = 0,
+  INTRA_PROCESS = 1,
+  STATE_BUS = 2
+};
+
+/**
+ * @brief Collects latency of received states, any thread
+ */
+class Receiver
+{
+public:
+  void on_state(const ControlState_T & state)
+  {
+    auto stamp_ns = int64_t(state.timestamp.sec) * 1000000000 + state.timestamp.nanosec;
+    std::lock_guard<std::mutex> lock(mutex_);
+    latency_us_.push_back((steady_ns() - stamp_ns) * 1e-3);
+  }
+
+  std::vector<double> latency()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latency_us_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<double> latency_us_;
+};
+
+struct PathResult
+{
+  std::vector<double> latency;
+  double cpu_us;
+};
+
+PathResult run_path(const Path path, const int messages, const int rate_hz)
+{
+  Receiver receiver;
+  auto intra = path == INTRA_PROCESS ?
+    rclcpp::IntraProcessSetting::Enable : rclcpp::IntraProcessSetting::Disable;
+
+  auto source = std::make_shared<rclcpp::Node>("state_bus_bench_source");
+  auto sink = std::make_shared<rclcpp::Node>("state_bus_bench_sink");
+  rclcpp::executors::SingleThreadedExecutor exec;
+  exec.add_node(sink);
+
+  rclcpp::Publisher<ControlState_T>::SharedPtr pub;
+  rclcpp::Subscription<ControlState_T>::SharedPtr sub;
+  cyberdog::manager::StateChannel<ControlState_T>::SharedPtr channel;
+  rclcpp::TimerBase::SharedPtr poll_timer;
+  uint64_t cursor(0);
+  if (path == STATE_BUS) {
+    channel = cyberdog::manager::StateBus::instance().channel<ControlState_T>(TOPIC);
+    cursor = channel->sequence();
+    poll_timer = sink->create_wall_timer(
+      std::chrono::nanoseconds(1000000000 / (std::max(1, rate_hz) * BENCH_POLL_FACTOR)),
+      [&receiver, &channel, &cursor]() {
+        ControlState_T state;
+        if (channel->take(state, cursor)) {
+          receiver.on_state(state);
+        }
+      });
+  } else {
+    rclcpp::SubscriptionOptions sub_options;
+    sub_options.use_intra_process_comm = intra;
+    sub = sink->create_subscription<ControlState_T>(
+      TOPIC, cyberdog::manager::intra_process_qos(messages),
+      [&receiver](const ControlState_T::SharedPtr msg) {receiver.on_state(*msg);}, sub_options);
+    rclcpp::PublisherOptions pub_options;
+    pub_options.use_intra_process_comm = intra;
+    pub = source->create_publisher<ControlState_T>(
+      TOPIC, cyberdog::manager::intra_process_qos(messages), pub_options);
+    while (pub->get_subscription_count() == 0 && rclcpp::ok()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  std::thread spin([&exec]() {exec.spin();});
+
+  ControlState_T state;
+  auto period = std::chrono::nanoseconds(1000000000 / std::max(1, rate_hz));
+  auto cpu_start = cpu_seconds();
+  auto next = Clock::now();
+  for (int i = 0; i < messages && rclcpp::ok(); i++) {
+    next += period;
+    std::this_thread::sleep_until(next);
+    auto now = steady_ns();
+    state.timestamp.sec = now / 1000000000;
+    state.timestamp.nanosec = now % 1000000000;
+    switch (path) {
+      case MIDDLEWARE:
+        pub->publish(state);
+        break;
+      case INTRA_PROCESS:
+        pub->publish(std::make_unique<ControlState_T>(state));
+        break;
+      case STATE_BUS:
+        channel->publish(state);
+        break;
+    }
+  }
+  // Let queued states drain before collecting
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  auto cpu_used = cpu_seconds() - cpu_start;
+
+  exec.cancel();
+  spin.join();
+
+  auto latency = receiver.latency();
+  return PathResult{latency, cpu_used * 1e6 / std::max<size_t>(1, latency.size())};
+}
+
+void report(const std::string & path, PathResult result, const int messages)
+{
+  auto & latency = result.latency;
+  std::printf("== %s\n", path.c_str());
+  std::printf(
+    "  received %zu of %d, cpu %.2f us/msg\n", latency.size(), messages, result.cpu_us);
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    auto pick = [&latency](double q) {
+        return latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+      };
+    std::printf(
+      "  latency publish -> callback us: p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+      pick(0.5), pick(0.9), pick(0.99), latency.back());
+  }
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  auto messages = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5000;
+  auto rate_hz = argc > 2 ? std::max(1, std::atoi(argv[2])) : 500;
+
+  rclcpp::init(argc, argv);
+  std::printf("%d control states at %d Hz\n", messages, rate_hz);
+  report("middleware", run_path(MIDDLEWARE, messages, rate_hz), messages);
+  report("intra-process, unique_ptr", run_path(INTRA_PROCESS, messages, rate_hz), messages);
+  report("state bus", run_path(STATE_BUS, messages, rate_hz), messages);
+
+  rclcpp::shutdown();
+  return 0;
+}